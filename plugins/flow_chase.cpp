@@ -0,0 +1,89 @@
+// Example ghost strategy: one BFS from Pacman per tick, shared by every
+// ghost. Chasing ghosts step to the neighbour nearest Pacman; while they are
+// edible they step to the one furthest away. Build with the game (CMake
+// target ghost_flow_chase, `make plugins`) and run
+//   ./Pacman --strategy ./libghost_flow_chase.so
+
+#include "ghost_strategy_abi.hpp"
+#include <vector>
+
+namespace {
+
+struct FlowChase {
+    std::vector<int> distance;
+    std::vector<int> queue;
+};
+
+// Ghosts don't walk through portals
+bool walkable(const PacmanGameView* view, int y, int x) {
+    char c = view->rows[y][x];
+    return c != '#' && c != '[' && c != ']';
+}
+
+void* create() {
+    return new FlowChase();
+}
+
+void destroy(void* state) {
+    delete static_cast<FlowChase*>(state);
+}
+
+void decide(void* state, const PacmanGameView* view, uint8_t* directions) {
+    FlowChase& self = *static_cast<FlowChase*>(state);
+    const int w = view->width;
+    const int cells = w * view->height;
+    self.distance.assign(cells, -1);
+    self.queue.resize(cells);
+
+    int head = 0, tail = 0;
+    int start = view->pacmanY * w + view->pacmanX;
+    self.distance[start] = 0;
+    self.queue[tail++] = start;
+    while (head < tail) {
+        int cell = self.queue[head++];
+        uint8_t nav = view->nav[cell];
+        int around[4] = {nav & PACMAN_NAV_UP ? cell - w : -1, nav & PACMAN_NAV_DOWN ? cell + w : -1,
+                         nav & PACMAN_NAV_LEFT ? cell - 1 : -1, nav & PACMAN_NAV_RIGHT ? cell + 1 : -1};
+        for (int next : around) {
+            if (next < 0 || self.distance[next] >= 0 || !walkable(view, next / w, next % w)) continue;
+            self.distance[next] = self.distance[cell] + 1;
+            self.queue[tail++] = next;
+        }
+    }
+
+    static const uint8_t DIRS[4] = {PACMAN_DIR_UP, PACMAN_DIR_DOWN, PACMAN_DIR_RIGHT, PACMAN_DIR_LEFT};
+    for (uint32_t i = 0; i < view->ghostCount; ++i) {
+        const PacmanGhostView& ghost = view->ghosts[i];
+        int cell = ghost.y * w + ghost.x;
+        uint8_t nav = view->nav[cell];
+        int around[4] = {nav & PACMAN_NAV_UP ? cell - w : -1, nav & PACMAN_NAV_DOWN ? cell + w : -1,
+                         nav & PACMAN_NAV_RIGHT ? cell + 1 : -1, nav & PACMAN_NAV_LEFT ? cell - 1 : -1};
+        uint8_t best = PACMAN_DIR_NONE;
+        int bestDistance = 0;
+        for (int d = 0; d < 4; ++d) {
+            int next = around[d];
+            if (next < 0 || self.distance[next] < 0) continue;
+            int dist = self.distance[next];
+            bool better = best == PACMAN_DIR_NONE || (view->superMode ? dist > bestDistance : dist < bestDistance);
+            if (better) {
+                best = DIRS[d];
+                bestDistance = dist;
+            }
+        }
+        directions[i] = best;
+    }
+}
+
+const PacmanGhostStrategy STRATEGY = {
+    PACMAN_STRATEGY_ABI_VERSION,
+    "flow-chase",
+    create,
+    destroy,
+    decide
+};
+
+}
+
+extern "C" const PacmanGhostStrategy* pacman_ghost_strategy(void) {
+    return &STRATEGY;
+}
@@ -0,0 +1,210 @@
+#include "alloc_tracker.hpp"
+#include "game.hpp"
+#include "rng.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+atomic<uint64_t> totalAllocations(0);
+thread_local uint64_t threadAllocations = 0;
+
+void* countedAlloc(size_t size) {
+    ++threadAllocations;
+    totalAllocations.fetch_add(1, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+
+uint64_t allocationsOnThisThread() {
+    return threadAllocations;
+}
+
+uint64_t allocationsTotal() {
+    return totalAllocations.load(memory_order_relaxed);
+}
+
+// A spectator that reads and discards the broadcast until the game hangs up
+static void drainSpectator(int fd, atomic<bool>& receiving) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        receiving = true;
+    }
+}
+
+static int connectSpectator(const string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+int runAllocationCheck(int ticks, uint64_t seed) {
+    static const char KEYS[] = {'w', 'a', 's', 'd'};
+    const int GHOST_PERIOD = Game::GHOST_STEP_MS;
+
+    // The live loop's output path runs too: frames go through the terminal
+    // writer to /dev/null and out to one connected spectator
+    cout.flush();
+    int terminalFd = dup(STDOUT_FILENO);
+    int nullFd = open("/dev/null", O_WRONLY);
+    if (terminalFd < 0 || nullFd < 0) {
+        cerr << "Error: cannot open /dev/null" << endl;
+        return 1;
+    }
+    dup2(nullFd, STDOUT_FILENO);
+    close(nullFd);
+    string socketPath = "/tmp/pacman-alloc-check-" + to_string(getpid()) + ".sock";
+
+    int levelStarts = 0;
+    int failures = 0;
+    int worstTick = -1;
+    uint64_t worst = 0;
+    uint64_t otherThreads = 0;
+    bool spectating = false;
+    {
+        Game game;
+        game.setReplayDirectory("");
+        game.setSavePath(socketPath + ".sav");   // never written; keeps the per-tick save image in the check
+        game.enableRewind();
+        Rng bot;
+        bot.seed(seed ^ 0x9e3779b97f4a7c15ULL);
+        vector<string> frame;
+        GameSnapshot snapshot;
+
+        atomic<bool> receiving(false);
+        int spectatorFd = -1;
+        thread spectator;
+        if (game.startBroadcast(socketPath)) {
+            spectatorFd = connectSpectator(socketPath);
+        }
+        if (spectatorFd >= 0) {
+            spectator = thread(drainSpectator, spectatorFd, ref(receiving));
+        }
+
+        long elapsedMs = 0;
+        long nextGhostMs = 0;
+        bool warm = false;
+
+        for (int tick = 0; tick < ticks; ++tick) {
+            if (tick == 0 || game.isOver()) {
+                // Level start may allocate; the first tick after it sizes the reused buffers
+                game.newGame(1 + levelStarts % 2, seed + levelStarts);
+                ++levelStarts;
+                warm = false;
+            }
+            if (tick == 1 && spectatorFd >= 0) {
+                // Let the server accept the spectator and send it a keyframe
+                for (int wait = 0; wait < 200 && !receiving; ++wait) {
+                    this_thread::sleep_for(chrono::milliseconds(5));
+                }
+                spectating = receiving;
+                game.flushOutput();
+            }
+
+            uint64_t before = allocationsOnThisThread();
+            uint64_t beforeTotal = allocationsTotal();
+            game.playTick();
+            elapsedMs += Game::TICK_MS;
+            while (nextGhostMs <= elapsedMs && !game.isOver()) {
+                for (size_t g = 0; g < game.getGhostCount(); ++g) game.stepGhost(g);
+                nextGhostMs += GHOST_PERIOD;
+            }
+            if (bot.nextInt(4) == 0) {
+                game.applyInput(KEYS[bot.nextInt(4)]);
+            }
+            game.buildFrame(frame);
+            game.captureSnapshot(snapshot);
+            uint64_t allocated = allocationsOnThisThread() - before;
+
+            if (warm && allocated > 0) {
+                ++failures;
+                if (allocated > worst) {
+                    worst = allocated;
+                    worstTick = tick;
+                }
+            }
+            if (warm && tick > 1) {
+                // The writer and spectator threads work on their own time, so
+                // their allocations are summed rather than pinned to a tick
+                otherThreads += allocationsTotal() - beforeTotal - allocated;
+            }
+            warm = true;
+        }
+
+        game.flushOutput();
+        game.stop();
+        if (spectatorFd >= 0) {
+            shutdown(spectatorFd, SHUT_RDWR);
+            spectator.join();
+            close(spectatorFd);
+        }
+    }
+    dup2(terminalFd, STDOUT_FILENO);
+    close(terminalFd);
+
+    cout << "  Allocation check: " << ticks << " ticks over " << levelStarts << " level starts, "
+         << failures << " ticks allocated";
+    if (failures > 0) {
+        cout << " (worst: " << worst << " allocations at tick " << worstTick << ")";
+    }
+    cout << endl;
+    cout << "  Output path: terminal writer to /dev/null, "
+         << (spectating ? "1 spectator" : "no spectator (socket unavailable)") << ", "
+         << otherThreads << " allocations on other threads" << endl;
+    bool passed = failures == 0 && otherThreads == 0;
+    cout << (passed ? "  PASS" : "  FAIL") << endl;
+    return passed ? 0 : 1;
+}
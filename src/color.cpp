@@ -1,5 +1,6 @@
 #include "color.hpp"
 #include <iostream>
+#include <string>
 
 using namespace std;
 
@@ -10,3 +11,12 @@ void setTextColor(TextColor color) {
 void resetTextColor() {
     cout << "\033[0m";
 }
+
+void appendTextColor(string& out, TextColor color) {
+    // Codes are at most two digits; append them directly so frames never allocate
+    int code = static_cast<int>(color);
+    out += "\033[";
+    if (code >= 10) out += static_cast<char>('0' + code / 10);
+    out += static_cast<char>('0' + code % 10);
+    out += 'm';
+}
@@ -1,10 +1,18 @@
 #include "cursor_input.hpp"
+#include <cerrno>
+#include <poll.h>
 
 
 static struct termios original_termios;
 static int original_flags;
+static int wakePipe[2] = {-1, -1};
 
 void setTerminalNonBlocking() {
+    if (wakePipe[0] < 0 && pipe(wakePipe) == 0) {
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+
     tcgetattr(STDIN_FILENO, &original_termios);
     original_flags = fcntl(STDIN_FILENO, F_GETFL, 0);
 
@@ -21,6 +29,57 @@ void restoreTerminalBlocking() {
 }
 
 
+int readKey() {
+    unsigned char ch;
+    pollfd p;
+    p.fd = STDIN_FILENO;
+    p.events = POLLIN;
+    // poll first so this never blocks, even if stdin was left blocking
+    if (poll(&p, 1, 0) == 1 && (p.revents & POLLIN) && read(STDIN_FILENO, &ch, 1) == 1) {
+        return ch;
+    }
+    return NO_KEY;
+}
+
+int waitKey() {
+    pollfd fds[2];
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakePipe[0];
+    fds[1].events = POLLIN;
+    int count = wakePipe[0] >= 0 ? 2 : 1;
+
+    while (true) {
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) return NO_KEY;
+            return INPUT_CLOSED;
+        }
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            char drain[32];
+            while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+            }
+            return NO_KEY;
+        }
+        if (fds[0].revents & POLLIN) {
+            unsigned char ch;
+            ssize_t n = read(STDIN_FILENO, &ch, 1);
+            if (n == 1) return ch;
+            if (n == 0) return INPUT_CLOSED;
+        } else if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            return INPUT_CLOSED;
+        }
+    }
+}
+
+void wakeInputWait() {
+    if (wakePipe[1] >= 0) {
+        char byte = 1;
+        ssize_t ignored = write(wakePipe[1], &byte, 1);
+        (void)ignored;
+    }
+}
+
 InputKey getInputKey() {
     // termios oldt{}, newt{};
     // tcgetattr(STDIN_FILENO, &oldt);
@@ -0,0 +1,72 @@
+#include "event_bus.hpp"
+
+using namespace std;
+
+const size_t EventBus::CAPACITY;
+
+uint64_t GameEvent::pack() const {
+    return static_cast<uint64_t>(type) |
+           static_cast<uint64_t>(static_cast<uint8_t>(entity)) << 8 |
+           static_cast<uint64_t>(y) << 16 |
+           static_cast<uint64_t>(x) << 24 |
+           static_cast<uint64_t>(tick) << 32;
+}
+
+GameEvent GameEvent::unpack(uint64_t bits) {
+    GameEvent e;
+    e.type = static_cast<GameEventType>(bits & 0xff);
+    e.entity = static_cast<char>((bits >> 8) & 0xff);
+    e.y = static_cast<uint8_t>((bits >> 16) & 0xff);
+    e.x = static_cast<uint8_t>((bits >> 24) & 0xff);
+    e.tick = static_cast<uint32_t>(bits >> 32);
+    return e;
+}
+
+const char* eventTypeName(GameEventType type) {
+    switch (type) {
+        case GameEventType::DOT_EATEN: return "DotEaten";
+        case GameEventType::PELLET_EATEN: return "PelletEaten";
+        case GameEventType::GHOST_EATEN: return "GhostEaten";
+        case GameEventType::PACMAN_DIED: return "PacmanDied";
+        case GameEventType::LEVEL_CLEARED: return "LevelCleared";
+        default: return "Unknown";
+    }
+}
+
+EventBus::EventBus() : head(0) {
+    for (size_t i = 0; i < CAPACITY; ++i) slots[i] = 0;
+}
+
+void EventBus::publish(const GameEvent& event) {
+    uint64_t seq = head.load(memory_order_relaxed);
+    slots[seq & (CAPACITY - 1)].store(event.pack(), memory_order_release);
+    head.store(seq + 1, memory_order_release);
+}
+
+EventBus::Cursor EventBus::subscribe() const {
+    Cursor cursor;
+    cursor.next = head.load(memory_order_acquire);
+    return cursor;
+}
+
+size_t EventBus::drain(Cursor& cursor, GameEvent* out, size_t max) const {
+    uint64_t end = head.load(memory_order_acquire);
+    if (end - cursor.next > CAPACITY) {
+        cursor.dropped += end - cursor.next - CAPACITY;
+        cursor.next = end - CAPACITY;
+    }
+
+    size_t count = 0;
+    while (cursor.next < end && count < max) {
+        uint64_t bits = slots[cursor.next & (CAPACITY - 1)].load(memory_order_acquire);
+        // The producer may have lapped us while we read; then the slot holds a newer event
+        if (head.load(memory_order_acquire) - cursor.next >= CAPACITY) {
+            ++cursor.dropped;
+            ++cursor.next;
+            continue;
+        }
+        out[count++] = GameEvent::unpack(bits);
+        ++cursor.next;
+    }
+    return count;
+}
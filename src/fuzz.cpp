@@ -0,0 +1,405 @@
+#include "fuzz.hpp"
+#include "level.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const char KEYS[] = {'w', 'a', 's', 'd'};
+const size_t CASE_TICKS = 2000;         // longest input sequence a case can have
+const size_t CORPUS_LIMIT = 256;
+const size_t COVERAGE_BITS = 1 << 16;
+const uint64_t SEED_TRIES = 32;         // small seeds tried while minimising
+
+bool isPacmanGlyph(char cell) {
+    return cell == '<' || cell == '>' || cell == '^' || cell == 'v';
+}
+
+// Positions and events seen, hashed into a bitmap. A case that sets a new bit
+// reached somewhere the corpus hadn't, so it is kept and mutated later.
+class Coverage {
+public:
+    Coverage() : bits(COVERAGE_BITS / 64, 0), set(0) {}
+
+    bool add(uint64_t feature) {
+        feature *= 0x9E3779B97F4A7C15ULL;
+        size_t bit = static_cast<size_t>(feature >> 48) % COVERAGE_BITS;
+        uint64_t mask = uint64_t(1) << (bit % 64);
+        if (bits[bit / 64] & mask) return false;
+        bits[bit / 64] |= mask;
+        ++set;
+        return true;
+    }
+    size_t getSet() const { return set; }
+
+private:
+    vector<uint64_t> bits;
+    size_t set;
+};
+
+uint64_t tickFeature(const Game& game) {
+    const Pacman& pacman = game.getPacman();
+    return (static_cast<uint64_t>(game.getLevel()) << 40) | (static_cast<uint64_t>(pacman.getY()) << 24) |
+           (static_cast<uint64_t>(pacman.getX()) << 12) | (static_cast<uint64_t>(pacman.getDirection()) << 4) |
+           (game.isSuperMode() ? 8u : 0u) | static_cast<uint64_t>(game.getLives() & 7);
+}
+
+uint64_t eventFeature(int level, const GameEvent& event) {
+    return (uint64_t(1) << 63) | (static_cast<uint64_t>(level) << 40) |
+           (static_cast<uint64_t>(event.type) << 32) | (static_cast<uint64_t>(event.y) << 16) | event.x;
+}
+
+// Plays 'fuzzCase' the way runAllocationCheck drives the engine and checks the
+// invariants after every step. Returns true on the first broken rule.
+bool playCase(Game& game, InvariantChecker& checker, const FuzzCase& fuzzCase, InvariantFailure& failure,
+              int& ticks, Coverage* coverage, bool& newCoverage) {
+    TRACE_SCOPE("fuzz.case");
+    game.newGame(fuzzCase.level, fuzzCase.seed);
+    ticks = 0;
+    newCoverage = false;
+    failure.tick = 0;
+    if (!checker.begin(game, failure)) return true;
+
+    EventBus::Cursor cursor = game.getEventBus().subscribe();
+    GameEvent batch[16];
+    long elapsedMs = 0;
+    long nextGhostMs = 0;
+    for (size_t t = 0; t < fuzzCase.keys.size() && !game.isOver(); ++t) {
+        if (fuzzCase.keys[t]) game.applyInput(fuzzCase.keys[t]);
+        game.tickPacman();
+        failure.tick = ++ticks;
+        if (!checker.check(game, failure)) return true;
+        elapsedMs += Game::TICK_MS;
+        while (nextGhostMs <= elapsedMs && !game.isOver()) {
+            for (size_t g = 0; g < game.getGhostCount(); ++g) {
+                game.stepGhost(g);
+                if (!checker.check(game, failure)) return true;
+            }
+            nextGhostMs += Game::GHOST_STEP_MS;
+        }
+
+        if (coverage) {
+            newCoverage |= coverage->add(tickFeature(game));
+            size_t n;
+            while ((n = game.getEventBus().drain(cursor, batch, 16)) > 0) {
+                for (size_t i = 0; i < n; ++i) newCoverage |= coverage->add(eventFeature(fuzzCase.level, batch[i]));
+            }
+        }
+    }
+    return false;
+}
+
+void randomCase(Rng& rng, FuzzCase& fuzzCase) {
+    fuzzCase.level = 1 + rng.nextInt(2);
+    fuzzCase.seed = rng.next();
+    fuzzCase.keys.assign(CASE_TICKS, 0);
+    for (size_t t = 0; t < CASE_TICKS; ++t) {
+        if (rng.nextInt(4) == 0) fuzzCase.keys[t] = KEYS[rng.nextInt(4)];
+    }
+}
+
+void mutateCase(Rng& rng, FuzzCase& fuzzCase) {
+    size_t size = fuzzCase.keys.size();
+    switch (rng.nextInt(4)) {
+        case 0: {   // rewrite a span of input
+            size_t begin = rng.nextInt(static_cast<int>(size));
+            size_t end = min(size, begin + 1 + rng.nextInt(64));
+            for (size_t t = begin; t < end; ++t) {
+                fuzzCase.keys[t] = rng.nextInt(2) ? KEYS[rng.nextInt(4)] : 0;
+            }
+            break;
+        }
+        case 1: {   // delay everything after a point, so later turns happen elsewhere
+            size_t at = rng.nextInt(static_cast<int>(size));
+            fuzzCase.keys.insert(fuzzCase.keys.begin() + at, 1 + rng.nextInt(8), 0);
+            fuzzCase.keys.resize(size);
+            break;
+        }
+        case 2:     // same input against different ghost decisions
+            fuzzCase.seed = rng.next();
+            break;
+        default:    // one turn changed
+            fuzzCase.keys[rng.nextInt(static_cast<int>(size))] = KEYS[rng.nextInt(4)];
+            break;
+    }
+}
+
+bool reproduces(Game& game, InvariantChecker& checker, const FuzzCase& fuzzCase, const char* rule,
+                InvariantFailure& failure) {
+    int ticks;
+    bool newCoverage;
+    return playCase(game, checker, fuzzCase, failure, ticks, nullptr, newCoverage) && failure.rule == rule;
+}
+
+// Shrinks a failing case: tries small seeds, then clears ever smaller spans of
+// keys, keeping each change that still breaks the same rule. The input is cut
+// after the failing tick whenever that moves earlier.
+void minimise(Game& game, InvariantChecker& checker, FuzzCase& fuzzCase, InvariantFailure& failure) {
+    TRACE_SCOPE("fuzz.minimise");
+    InvariantFailure trial;
+    fuzzCase.keys.resize(failure.tick);
+
+    FuzzCase candidate = fuzzCase;
+    for (uint64_t seed = 1; seed <= SEED_TRIES; ++seed) {
+        candidate.seed = seed;
+        if (reproduces(game, checker, candidate, failure.rule, trial) && trial.tick <= failure.tick) {
+            fuzzCase.seed = seed;
+            fuzzCase.keys.resize(trial.tick);
+            failure = trial;
+            break;
+        }
+    }
+
+    for (size_t chunk = max<size_t>(1, fuzzCase.keys.size() / 2); chunk >= 1; chunk /= 2) {
+        for (size_t begin = 0; begin < fuzzCase.keys.size(); begin += chunk) {
+            size_t end = min(fuzzCase.keys.size(), begin + chunk);
+            if (count(fuzzCase.keys.begin() + begin, fuzzCase.keys.begin() + end, 0) ==
+                static_cast<ptrdiff_t>(end - begin)) {
+                continue;
+            }
+            candidate = fuzzCase;
+            fill(candidate.keys.begin() + begin, candidate.keys.begin() + end, 0);
+            if (reproduces(game, checker, candidate, failure.rule, trial)) {
+                candidate.keys.resize(trial.tick);
+                fuzzCase = candidate;
+                failure = trial;
+            }
+        }
+        if (chunk == 1) break;
+    }
+}
+
+} // namespace
+
+size_t FuzzCase::keyCount() const {
+    return keys.size() - static_cast<size_t>(count(keys.begin(), keys.end(), 0));
+}
+
+// ---------------------------------------------------------------------------
+// Invariants
+// ---------------------------------------------------------------------------
+
+InvariantChecker::InvariantChecker() : dotsOnGrid(0) {
+}
+
+// One pass over the grid for the dot and Pacman glyph counts; dots a ghost is
+// standing on still count
+static void countCells(const Game& game, int& dots, int& pacmen) {
+    const Map& map = game.getMap();
+    dots = 0;
+    pacmen = 0;
+    for (size_t i = 0; i < game.getGhostCount(); ++i) {
+        char under = game.getGhost(i).getUnder();
+        if (under == '.' || under == 'O') ++dots;
+    }
+    for (int y = 0; y < map.getHeight(); ++y) {
+        const char* row = map.getRow(y);
+        for (int x = 0; x < map.getWidth(); ++x) {
+            char cell = row[x];
+            if (cell == '.' || cell == 'O') {
+                ++dots;
+            } else if (isPacmanGlyph(cell)) {
+                ++pacmen;
+            }
+        }
+    }
+}
+
+static bool checkActor(const LevelData& level, const char* name, int y, int x, InvariantFailure& failure) {
+    const char* problem;
+    if (!level.contains(y, x)) {
+        failure.rule = "bounds";
+        problem = " is off the grid";
+    } else if (level.terrainAt(y, x) == LevelData::WALL) {
+        failure.rule = "walls";
+        problem = " is inside a wall";
+    } else {
+        return true;
+    }
+    ostringstream detail;
+    detail << name << " at (" << y << "," << x << ")" << problem;
+    failure.detail = detail.str();
+    return false;
+}
+
+bool InvariantChecker::begin(const Game& game, InvariantFailure& failure) {
+    const LevelData& level = game.getMap().getLevelData();
+    for (int y = 0; y < level.getHeight(); ++y) {
+        for (int x = 0; x < level.getWidth(); ++x) {
+            if (level.terrainAt(y, x) != LevelData::PORTAL) continue;
+            int exitY, exitX;
+            if (!level.portalExit(y, x, exitY, exitX) || !level.contains(exitY, exitX) ||
+                level.terrainAt(exitY, exitX) == LevelData::WALL) {
+                ostringstream detail;
+                detail << "portal at (" << y << "," << x << ") has no usable exit";
+                failure.rule = "bounds";
+                failure.detail = detail.str();
+                return false;
+            }
+        }
+    }
+    int pacmen;
+    countCells(game, dotsOnGrid, pacmen);
+    return check(game, failure);
+}
+
+bool InvariantChecker::check(const Game& game, InvariantFailure& failure) {
+    const Map& map = game.getMap();
+    int dots, pacmen;
+    countCells(game, dots, pacmen);
+    if (dots > dotsOnGrid) {
+        ostringstream detail;
+        detail << "dots on the grid went up from " << dotsOnGrid << " to " << dots;
+        failure.rule = "dots";
+        failure.detail = detail.str();
+        return false;
+    }
+    dotsOnGrid = dots;
+
+    if (game.getDotsEaten() > game.getMaxDots()) {
+        ostringstream detail;
+        detail << "dotsEaten " << game.getDotsEaten() << " > maxDots " << game.getMaxDots();
+        failure.rule = "score";
+        failure.detail = detail.str();
+        return false;
+    }
+
+    const LevelData& level = map.getLevelData();
+    const Pacman& pacman = game.getPacman();
+    if (!checkActor(level, "Pacman", pacman.getY(), pacman.getX(), failure)) return false;
+    for (size_t i = 0; i < game.getGhostCount(); ++i) {
+        const Ghost& ghost = game.getGhost(i);
+        if (!ghost.isAlive()) continue;
+        char name[] = "ghost ?";
+        name[6] = ghost.getCharacter();
+        if (!checkActor(level, name, ghost.getY(), ghost.getX(), failure)) return false;
+    }
+
+    if (pacmen != 1) {
+        ostringstream detail;
+        detail << pacmen << " Pacman glyphs on the grid";
+        failure.rule = "pacman";
+        failure.detail = detail.str();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Driver
+// ---------------------------------------------------------------------------
+
+int runFuzzer(uint64_t ticks, size_t threads, const string& reproPath) {
+    size_t threadCount = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+    cout << "Fuzzing " << ticks << " ticks on " << threadCount << " threads" << endl;
+
+    // Each worker owns its Game, corpus and coverage map: games never share
+    // state, so workers only meet on the tick budget and the first failure
+    atomic<uint64_t> ticksRun(0);
+    atomic<uint64_t> casesRun(0);
+    atomic<bool> failed(false);
+    atomic<size_t> coverageBits(0);
+    atomic<size_t> corpusCases(0);
+    mutex failureMutex;
+    FuzzCase failingCase;
+    InvariantFailure failure;
+
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t w = 0; w < threadCount; ++w) {
+        workers.push_back(thread([&, w]() {
+            TRACE_THREAD_NAME("fuzz");
+            Game game;
+            game.setHeadless(true);
+            game.setReplayDirectory("");
+            InvariantChecker checker;
+            Rng rng(0x5eed0000 + w);
+            Coverage coverage;
+            vector<FuzzCase> corpus;
+            FuzzCase fuzzCase;
+            InvariantFailure found;
+            while (!failed && ticksRun < ticks) {
+                // Half fresh random input, half mutations of cases that found new coverage
+                if (corpus.empty() || rng.nextInt(2) == 0) {
+                    randomCase(rng, fuzzCase);
+                } else {
+                    fuzzCase = corpus[rng.nextInt(static_cast<int>(corpus.size()))];
+                    mutateCase(rng, fuzzCase);
+                }
+                int played;
+                bool newCoverage;
+                bool broken = playCase(game, checker, fuzzCase, found, played, &coverage, newCoverage);
+                ticksRun += static_cast<uint64_t>(played);
+                ++casesRun;
+                if (broken) {
+                    lock_guard<mutex> lock(failureMutex);
+                    if (!failed) {
+                        failed = true;
+                        failingCase = fuzzCase;
+                        failure = found;
+                    }
+                } else if (newCoverage) {
+                    if (corpus.size() < CORPUS_LIMIT) {
+                        corpus.push_back(fuzzCase);
+                    } else {
+                        corpus[rng.nextInt(static_cast<int>(CORPUS_LIMIT))] = fuzzCase;
+                    }
+                }
+            }
+            coverageBits += coverage.getSet();
+            corpusCases += corpus.size();
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); ++w) workers[w].join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    cout << "  " << ticksRun.load() << " ticks in " << casesRun.load() << " cases, " << fixed << setprecision(2)
+         << seconds << " s: " << setprecision(0) << (seconds > 0 ? ticksRun.load() / seconds : 0.0)
+         << " ticks/s; corpus " << corpusCases.load() << " cases, " << coverageBits.load() << " coverage bits"
+         << endl;
+    if (!failed) {
+        cout << "  PASS: every invariant held" << endl;
+        return 0;
+    }
+
+    cout << "  FAIL [" << failure.rule << "] tick " << failure.tick << ": " << failure.detail << endl;
+    Game game;
+    game.setHeadless(true);
+    game.setReplayDirectory("");
+    InvariantChecker checker;
+    minimise(game, checker, failingCase, failure);
+
+    cout << "  Minimised: level " << failingCase.level << ", seed " << failingCase.seed << ", "
+         << failingCase.keys.size() << " ticks, " << failingCase.keyCount() << " keys" << endl;
+    cout << "  [" << failure.rule << "] tick " << failure.tick << ": " << failure.detail << endl;
+    cout << "  Input (tick:key):";
+    for (size_t t = 0; t < failingCase.keys.size(); ++t) {
+        if (failingCase.keys[t]) cout << " " << t + 1 << ":" << failingCase.keys[t];
+    }
+    cout << endl;
+
+    // Re-run it with the recorder on so the failure can be watched with --replay.
+    // playCase starts the same game again, so the opening keyframe still holds.
+    Game recorded;
+    recorded.setHeadless(true);
+    recorded.setReplayDirectory("");
+    recorded.newGame(failingCase.level, failingCase.seed);
+    if (recorded.recordTo(reproPath)) {
+        InvariantFailure replayed;
+        int played;
+        bool newCoverage;
+        playCase(recorded, checker, failingCase, replayed, played, nullptr, newCoverage);
+        cout << "  Replay: " << reproPath << " (watch it with --replay " << reproPath << ")" << endl;
+    } else {
+        cerr << "Error: cannot write " << reproPath << endl;
+    }
+    return 1;
+}
@@ -4,19 +4,64 @@
 #include "ghost.hpp"
 #include "ultils.hpp"
 #include "color.hpp"
+#include "trace.hpp"
+#include "cursor_input.hpp"
+#include "thread_pool.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cctype>
+#include <climits>
+#include <algorithm>
+#include <sys/stat.h>
 
 using namespace std;
 
+const int Game::TICK_MS;
+const int Game::GHOST_STEP_MS;
+const int Game::FLOW_SLOTS;
+
+static const int REWIND_SECONDS = 10;
+static const char REWIND_KEY = 'b';
+static const char HUD_KEY = 'h';
+static const char PAUSE_KEY = 'p';
+static const char SAVE_KEY = 'k';
+
+// Classic scatter/chase waves in ticks (7s scatter, 20s chase, 7s, 20s, 5s,
+// 20s, 5s), counted from the start of the level; after the last the ghosts
+// chase for good. Derived from 'time' alone, so snapshots need no new state.
+static const int MODE_WAVES[] = {47, 133, 47, 133, 33, 133, 33};
+static const int SUPER_MODE_TICKS = 40;
+static const int ROUTE_PATCH_LIMIT = 32;   // cells a reload may re-wall before routes are rebuilt
+
+// Blocks in poll() until a key arrives. Signal wakeups only service pending
+// trace exports; a closed stdin reads as 'q'.
+static int nextMenuKey() {
+    cout.flush();
+    while (true) {
+        int key = waitKey();
+        if (key == INPUT_CLOSED) return 'q';
+        if (key != NO_KEY) return key;
+        TRACE_SERVICE_REQUESTS(PACMAN_TRACE_FILE);
+    }
+}
+
 Game::Game() : score(0), lives(3), time(0), SMtime(0), dotsEaten(0), maxDots(0), 
-               superMode(false), message("Round start!"), gameRunning(false) {
+               superMode(false), message(MessageId::ROUND_START), headless(false), seed(1),
+               replayDirectory("replays"), frameReserve(0), screenGeneration(0), lastFrameLines(0), repaintPending(true),
+               hudVisible(false), strategyTick(-1), swarm(false), flowPool(nullptr), flowTick(-1), flowBuilds(0),
+               flowTime(0), publishedSave(-1),
+               resumePending(false), gameRunning(false), rewinding(false), paused(false),
+               gameMutex("gameMutex") {
     // Initialize ghosts
     ghosts.push_back(Ghost(GhostType::BLINKY, 9, 12, 250));
     ghosts.push_back(Ghost(GhostType::PINKY, 9, 14, 250));
     ghosts.push_back(Ghost(GhostType::INKY, 10, 12, 450));
     ghosts.push_back(Ghost(GhostType::CLYDE, 10, 14, 150));
+    screen.rows = screen.cols = 0;
+    terminal.setOnFrameWritten([this]() { perf.frameShown(); });
 }
 
 Game::~Game() {
@@ -24,16 +69,27 @@ Game::~Game() {
 }
 
 void Game::start() {
+    // Only interactive games can rewind, so hosted/headless games skip this memory
+    enableRewind();
+
     clearTerminal();
     hideCursor();
     
     char input = 'r';
     while (input == 'r') {
-        int level = showTitleScreen();
+        int level = resumePending ? resumeState.level : showTitleScreen();
         clearScreen();
         
-        initializeGame(level);
+        uint64_t gameSeed = static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+        initializeGame(level, gameSeed);
+        if (resumePending) {
+            restoreSnapshot(resumeState);   // the replay's opening keyframe carries it
+            resumePending = false;
+        }
+        startRecording();
         runGameLoop();
+        stopRecording();
+        publishedSave = -1;   // a finished game is not worth resuming
         handleGameEnd();
         
           // after handleGameEnd():
@@ -41,8 +97,7 @@ void Game::start() {
         cout << "(Press 'r' to play again, any other key to exit.)" << endl;
 
         // wait for a single keypress and use it
-        while (!kbhit()) std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        input = getch();
+        input = static_cast<char>(nextMenuKey());
         clearScreen();
     }
     
@@ -51,7 +106,11 @@ void Game::start() {
 }
 
 void Game::stop() {
-    gameRunning = false;
+    {
+        lock_guard<mutex> lock(pauseMutex);
+        gameRunning = false;
+    }
+    pauseSignal.notify_all();
     if (pacmanThread.joinable()) {
         pacmanThread.join();
     }
@@ -61,15 +120,27 @@ void Game::stop() {
         }
     }
     ghostThreads.clear();
+    terminal.drain();   // nothing may land on top of what is printed next
 }
 
 bool Game::isRunning() const {
     return gameRunning;
 }
 
-void Game::initializeGame(int level) {
+void Game::newGame(int level, uint64_t gameSeed) {
+    initializeGame(level, gameSeed);
+}
+
+void Game::initializeGame(int level, uint64_t gameSeed) {
+    seed = gameSeed;
+    rng.seed(gameSeed);
+    gameMutex.resetSites();   // the lock report covers one game
     gameMap.loadLevel(level);
+    terrain.build(gameMap.shareLevelData());
+    buildRoutes();
     maxDots = gameMap.getMaxDots();
+    strategyTick = -1;
+    flowTick = -1;
     
     // Reset game state
     score = 0;
@@ -78,12 +149,21 @@ void Game::initializeGame(int level) {
     SMtime = 0;
     dotsEaten = 0;
     superMode = false;
-    message = "Round start!";
+    message = MessageId::ROUND_START;
+    rewinding = false;
+    paused = false;
+    rewindBuffer.clear();
+    scoringCursor = events.subscribe();
     
     // Reset characters
-    pacman.reset();
-    for (auto& ghost : ghosts) {
-        ghost.reset();
+    resetActors();
+
+    // Size both save images for this level (and encode its layout), so the
+    // per-tick encode never grows one
+    if (!savePath.empty()) {
+        captureSnapshot(snapshotScratch);
+        saveImages[0].encode(snapshotScratch);
+        saveImages[1].encode(snapshotScratch);
     }
     
     gameRunning = true;
@@ -93,37 +173,47 @@ void Game::runGameLoop() {
     // Start threads
     // pacman thread
     pacmanThread = thread([this]() {
+        TRACE_THREAD_NAME("pacman");
+        LockSite& tickSite = gameMutex.site("pacman tick");
+        LockSite& inputSite = gameMutex.site("input");
+        int idlePolls = 0;
         while (gameRunning && lives > 0 && dotsEaten < maxDots) {
-            {
-                lock_guard<mutex> lock(gameMutex); // protect everything below
-                resetCursor();
-                ++time;
-
-                if (superMode && (time - SMtime >= 40)) {
-                    superMode = false;
-                    message = "Super mode is now over.";
-                }
-
-                pacman.update(gameMap, *this);   // map + state changes protected
-                displayGame();                   // read map + other state while locked
-
-                // If Pacman died but lives remain, respawn characters
-                if (!pacman.isAlive() && lives > 0) {
-                    superMode = false;
-                    pacman.reset();
-                    for (auto& ghost : ghosts) ghost.reset();
-                }
+            TRACE_SERVICE_REQUESTS(PACMAN_TRACE_FILE);
+            if (!rewinding) {
+                InstrumentedLock lock(gameMutex, tickSite); // protect everything below
+                playTick();
             } // unlock here before sleeping / waiting for input
 
             // Handle input (doesn't need map lock)
-            if (kbhit()) {
-                char input = getch();
+            int key = readKey();
+            if (key == PAUSE_KEY) {
+                pauseGame();
+            } else if (key != NO_KEY) {
+                TRACE_SCOPE("input");
+                char input = static_cast<char>(key);
+                perf.inputReceived();
                 // move modifies pacman and might need lock depending on your implementation
-                lock_guard<std::mutex> lock(gameMutex);
-                pacman.move(input, gameMap, *this);
+                InstrumentedLock lock(gameMutex, inputSite);
+                if (input == HUD_KEY) {
+                    toggleHud();
+                } else if (input == SAVE_KEY) {
+                    saveGame();
+                } else if (input == REWIND_KEY) {
+                    // Holding the key auto-repeats it: one tick back per repeat
+                    rewinding = true;
+                    idlePolls = 0;
+                    rewindStep();
+                } else {
+                    if (rewinding) resumeFromRewind();
+                    applyInput(input);
+                }
+            } else if (rewinding && ++idlePolls * 40 >= 600) {
+                // Key released (no repeat for longer than the usual repeat delay)
+                InstrumentedLock lock(gameMutex, inputSite);
+                resumeFromRewind();
             }
 
-            this_thread::sleep_for(chrono::milliseconds(150));
+            this_thread::sleep_for(chrono::milliseconds(rewinding ? 40 : TICK_MS));
         }
     });
     
@@ -133,13 +223,21 @@ void Game::runGameLoop() {
     // spawn one thread per ghost — capture the index, not the loop variable reference
     for (size_t i = 0; i < ghosts.size(); ++i) {
         ghostThreads.emplace_back([this, i]() {
+#ifdef PACMAN_TRACE
+            static const char* const names[] = {"ghost 0", "ghost 1", "ghost 2", "ghost 3"};
+            TRACE_THREAD_NAME(i < 4 ? names[i] : "ghost");
+#endif
+            LockSite& site = gameMutex.site("ghost " + to_string(i));
             while (gameRunning && lives > 0 && dotsEaten < maxDots) {
-                {
-                    lock_guard<mutex> lock(gameMutex);
-                    Ghost &ghost = ghosts[i];
-                    ghost.update(pacman.getY(), pacman.getX(), gameMap, *this);
+                if (!rewinding) {
+                    InstrumentedLock lock(gameMutex, site);
+                    stepGhost(i);
                 } // unlock quickly
-                this_thread::sleep_for(chrono::milliseconds(250));
+                this_thread::sleep_for(chrono::milliseconds(GHOST_STEP_MS));
+                if (paused) {
+                    unique_lock<mutex> pauseLock(pauseMutex);
+                    pauseSignal.wait(pauseLock, [this]() { return !paused || !gameRunning; });
+                }
             }
         });
     }
@@ -152,106 +250,974 @@ void Game::runGameLoop() {
     ghostThreads.clear();
 }
 
+// Swarm mode's extra ghosts start spread evenly over the floor, off Pacman's
+// and the ghosts' spawns
+static vector<int32_t> scatterCells(const LevelData& level, size_t count) {
+    vector<int32_t> floor;
+    const vector<LevelData::Spawn>& spawns = level.getGhostSpawns();
+    for (int y = 0; y < level.getHeight(); ++y) {
+        for (int x = 0; x < level.getWidth(); ++x) {
+            bool spawn = y == level.getPacmanSpawn().y && x == level.getPacmanSpawn().x;
+            for (const auto& ghost : spawns) spawn = spawn || (y == ghost.y && x == ghost.x);
+            if (!spawn && level.terrainAt(y, x) == LevelData::FLOOR) floor.push_back(y * level.getWidth() + x);
+        }
+    }
+    vector<int32_t> cells;
+    if (floor.empty()) return cells;
+    for (size_t i = 0; i < count; ++i) {
+        cells.push_back(floor[i * floor.size() / count]);
+    }
+    return cells;
+}
 
-void Game::displayGame() {
-    // Score + Lives (hearts)
-    setTextColor(BRIGHT_RED);
-    cout << "  Score: " << score;
+void Game::resetActors() {
+    // Start positions come from the shared level data
+    const LevelData& level = gameMap.getLevelData();
+    pacman.reset();
+    pacman.setPosition(level.getPacmanSpawn().y, level.getPacmanSpawn().x);
 
-    setTextColor(BRIGHT_YELLOW);
-    cout << "  Lives: ";
+    const vector<LevelData::Spawn>& spawns = level.getGhostSpawns();
+    vector<int32_t> scattered;
+    if (swarm && ghosts.size() > spawns.size()) scattered = scatterCells(level, ghosts.size() - spawns.size());
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        ghosts[i].reset();
+        if (i >= spawns.size() && !scattered.empty()) {
+            // Drawn at once, keeping the dot it stands on for when it moves off
+            int y = scattered[i - spawns.size()] / level.getWidth();
+            int x = scattered[i - spawns.size()] % level.getWidth();
+            ghosts[i].setPosition(y, x);
+            ghosts[i].setUnder(gameMap.getCell(y, x));
+            gameMap.setCell(y, x, ghosts[i].getCharacter());
+        } else if (!spawns.empty()) {
+            const LevelData::Spawn& spawn = spawns[i % spawns.size()];
+            ghosts[i].setPosition(spawn.y, spawn.x);
+        }
+    }
+}
 
-    // print 3 hearts (solid if present, empty if lost)
-    const int MAX_LIVES = 3;
-    for (int i = 0; i < MAX_LIVES; ++i) {
-        if (i < lives) {
-            cout << HEART_SOLID << " ";
-        } else {
-            cout << HEART_EMPTY << " ";
+void Game::enableRewind() {
+    if (rewindBuffer.capacity() == 0) {
+        rewindBuffer.allocate(REWIND_SECONDS * 1000 / TICK_MS, ghosts.size());
+    }
+}
+
+void Game::playTick() {
+    if (levelWatcher.changed()) reloadLevelFile();
+    tickPacman();
+    captureSnapshot(snapshotScratch);
+    rewindBuffer.capture(snapshotScratch);
+    if (!savePath.empty()) publishSave();
+}
+
+void Game::tickPacman() {
+    TRACE_SCOPE("tickPacman");
+    ++time;
+    perf.tick();
+
+    {
+        TRACE_SCOPE("superModeTimer");
+        if (superMode && (time - SMtime >= SUPER_MODE_TICKS)) {
+            superMode = false;
+            message = MessageId::SUPER_MODE_OVER;
         }
     }
-    cout << endl;
 
-    // Build a local char buffer copy of the map (so we can overlay dynamic characters)
-    int h = gameMap.getHeight();
-    int w = gameMap.getWidth();
-    vector<string> buffer;
-    buffer.assign(h, std::string(w, ' '));
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            buffer[y][x] = gameMap.getCell(y, x);
+    {
+        TRACE_SCOPE("Pacman::update");
+        pacman.update(gameMap, *this);   // map + state changes protected
+    }
+    applyEvents();
+    if (!headless || spectators.isRunning()) {
+        displayGame();               // read map + other state while locked
+    }
+
+    // If Pacman died but lives remain, respawn characters
+    if (!pacman.isAlive() && lives > 0) {
+        superMode = false;
+        // Lift the actors off the grid first, or their glyphs stay behind
+        // (a second Pacman, ghosts that block the way), and put Pacman back
+        // on his spawn the way a new level shows him
+        gameMap.setCell(pacman.getY(), pacman.getX(), ' ');
+        for (size_t i = 0; i < ghosts.size(); ++i) {
+            gameMap.setCell(ghosts[i].getY(), ghosts[i].getX(), ghosts[i].getUnder());
         }
+        resetActors();
+        gameMap.setCell(pacman.getY(), pacman.getX(), pacman.getCharacter());
     }
 
-    // overlay pacman
-    int py = pacman.getY();
-    int px = pacman.getX();
-    if (py >= 0 && py < h && px >= 0 && px < w) {
-        buffer[py][px] = pacman.getChar(); // e.g. '<' or whatever pacman uses
+    if (recorder.isOpen()) {
+        recorder.recordTick();
+        if (recorder.getTicksRecorded() % ReplayRecorder::KEYFRAME_INTERVAL == 0) {
+            captureSnapshot(snapshotScratch);
+            recorder.recordKeyframe(snapshotScratch, true);
+        }
     }
+}
 
-    // overlay ghosts (use their char code: 'M','Y','W','U' or whatever your Ghost::getChar() returns)
-    for (auto &g : ghosts) {
-        int gy = g.getY();
-        int gx = g.getX();
-        if (gy >= 0 && gy < h && gx >= 0 && gx < w) {
-            buffer[gy][gx] = g.getChar();
+// An eaten ghost starts over from its spawn, so it can't be eaten again on
+// the next tick or keep blocking the cell
+void Game::sendGhostHome(int y, int x) {
+    const vector<LevelData::Spawn>& spawns = gameMap.getLevelData().getGhostSpawns();
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        if (ghosts[i].getY() != y || ghosts[i].getX() != x) continue;
+        gameMap.setCell(y, x, ghosts[i].getUnder());
+        ghosts[i].reset();
+        if (!spawns.empty()) {
+            const LevelData::Spawn& spawn = spawns[i % spawns.size()];
+            ghosts[i].setPosition(spawn.y, spawn.x);
         }
+        gameMap.setCell(ghosts[i].getY(), ghosts[i].getX(), ghosts[i].getCharacter());
+        return;
     }
+}
 
-    // Now render the buffer row-by-row. Use BLOCK_FULL string for walls, otherwise print the single char.
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            char cellChar = buffer[y][x];
+void Game::emit(GameEventType type, int y, int x, char entity) {
+    GameEvent event;
+    event.type = type;
+    event.entity = entity;
+    event.y = static_cast<uint8_t>(y);
+    event.x = static_cast<uint8_t>(x);
+    event.tick = static_cast<uint32_t>(time);
+    events.publish(event);
+}
 
-            // choose color based on character
-            switch(cellChar) {
-                case '#':
-                    setTextColor(BLUE);
-                    break;
-                case '<': case '^': case '>': case 'v': // pacman glyphs
-                    setTextColor(BRIGHT_YELLOW);
+// Scoring subscriber. Runs inside the step that produced the events, so game
+// state (and therefore replays) stays deterministic.
+void Game::applyEvents() {
+    GameEvent batch[16];
+    size_t n;
+    while ((n = events.drain(scoringCursor, batch, 16)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            const GameEvent& e = batch[i];
+            switch (e.type) {
+                case GameEventType::DOT_EATEN:
+                    ++dotsEaten;
+                    ++score;
+                    if (dotsEaten == maxDots) {
+                        emit(GameEventType::LEVEL_CLEARED, e.y, e.x);
+                    }
                     break;
-                case 'M':
-                    setTextColor(superMode ? WHITE : BRIGHT_RED);
+                case GameEventType::PELLET_EATEN:
+                    ++dotsEaten;
+                    superMode = true;
+                    SMtime = time;
+                    message = MessageId::SUPER_MODE_ON;
+                    if (dotsEaten == maxDots) {
+                        emit(GameEventType::LEVEL_CLEARED, e.y, e.x);
+                    }
                     break;
-                case 'Y':
-                    setTextColor(superMode ? WHITE : BRIGHT_GREEN);
+                case GameEventType::GHOST_EATEN:
+                    score += 100;
+                    message = MessageId::GHOST_EATEN;
+                    sendGhostHome(e.y, e.x);
                     break;
-                case 'W':
-                    setTextColor(superMode ? WHITE : BRIGHT_MAGENTA);
-                    break;
-                case 'U':
-                    setTextColor(superMode ? WHITE : BRIGHT_CYAN);
-                    break;
-                case '.':
-                    setTextColor(YELLOW);
-                    break;
-                case 'O':
-                    setTextColor(BRIGHT_WHITE);
-                    break;
-                case '[': case ']':
-                    setTextColor(CYAN);
+                case GameEventType::PACMAN_DIED:
+                    --lives;
+                    message = MessageId::PACMAN_EATEN;
                     break;
                 default:
-                    setTextColor(WHITE);
                     break;
             }
 
-            // print glyph; walls use BLOCK_FULL (multi-byte), others print the char
-            if (cellChar == '#') {
-                cout << BLOCK_FULL;
+            if (log.isOpen()) {
+                LogRecord record;
+                record.tick = e.tick;
+                record.score = score;
+                record.type = static_cast<uint8_t>(e.type);
+                record.entity = e.entity;
+                record.y = e.y;
+                record.x = e.x;
+                record.lives = static_cast<uint8_t>(lives < 0 ? 0 : lives);
+                record.level = static_cast<uint8_t>(gameMap.getCurrentLevel());
+                record.reserved = 0;
+                log.append(record);
+            }
+        }
+    }
+}
+
+void Game::applyInput(char input) {
+    pacman.move(input, gameMap, *this);
+    if (recorder.isOpen()) {
+        recorder.recordInput(input);
+    }
+}
+
+void Game::setSwarm(size_t count, WorkStealingPool* pool) {
+    static const int SPEEDS[] = {250, 250, 450, 150};   // as Game() gives the classic four
+    ghosts.clear();
+    for (size_t i = 0; i < count; ++i) {
+        ghosts.push_back(Ghost(static_cast<GhostType>(i % 4), 0, 0, SPEEDS[i % 4]));
+    }
+    swarm = true;
+    flowPool = pool;
+    flowFields.clear();
+    flowTick = -1;
+}
+
+// Swarm mode, at the first ghost step of a tick: the target of every rule in
+// the ghosts' current mode. A field already aimed at one of them is kept; the
+// rest are re-aimed and rebuilt, side by side on the pool when there are more
+// than one. Targets hold for the whole tick, as the strategy plugin's moves do.
+void Game::updateFlowFields() {
+    TRACE_SCOPE("swarm.fields");
+    flowTick = time;
+    if (flowFields.empty() || !flowFields[0].isFor(gameMap.getLevelData())) {
+        flowFields.assign(FLOW_SLOTS, FlowField(gameMap.shareLevelData()));
+    }
+
+    GhostTargetKey key;
+    key.pacmanY = pacman.getY();
+    key.pacmanX = pacman.getX();
+    key.pacmanDirection = pacman.getDirection();
+    key.mode = getGhostMode();
+    key.otherY = key.otherX = -1;
+    key.mapHeight = gameMap.getHeight();
+    key.mapWidth = gameMap.getWidth();
+    for (const auto& ghost : ghosts) {
+        if (ghost.getType() == GhostType::BLINKY) {
+            key.otherY = ghost.getY();
+            key.otherX = ghost.getX();
+            break;
+        }
+    }
+    int targets[FLOW_SLOTS];
+    bool taken[FLOW_SLOTS];
+    for (int slot = 0; slot < FLOW_SLOTS; ++slot) {
+        int y, x;
+        key.near = slot == FLOW_SLOTS - 1;
+        Ghost(static_cast<GhostType>(min(slot, 3)), 0, 0, 0).setTarget(y, x, key);
+        targets[slot] = gameMap.getLevelData().nearestFloor(y, x);
+        flowSlots[slot] = -1;
+        taken[slot] = false;
+    }
+    for (int slot = 0; slot < FLOW_SLOTS; ++slot) {
+        for (int i = 0; i < FLOW_SLOTS && targets[slot] >= 0; ++i) {
+            if (flowFields[i].getTarget() == targets[slot]) {
+                flowSlots[slot] = i;
+                taken[i] = true;
+                break;
+            }
+        }
+    }
+
+    FlowField* stale[FLOW_SLOTS];
+    int staleTargets[FLOW_SLOTS];
+    size_t count = 0;
+    int spare = 0;
+    for (int slot = 0; slot < FLOW_SLOTS; ++slot) {
+        if (flowSlots[slot] >= 0 || targets[slot] < 0) continue;
+        for (int other = 0; other < slot; ++other) {
+            if (targets[other] == targets[slot]) flowSlots[slot] = flowSlots[other];
+        }
+        if (flowSlots[slot] >= 0) continue;
+        while (taken[spare]) ++spare;
+        taken[spare] = true;
+        flowSlots[slot] = spare;
+        stale[count] = &flowFields[spare];
+        staleTargets[count++] = targets[slot];
+    }
+    if (count == 0) return;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (count > 1 && flowPool) {
+        // All but the first go to the pool, the first is built here; wait for all of them
+        mutex doneMutex;
+        condition_variable doneCv;
+        size_t remaining = count - 1;
+        for (size_t i = 1; i < count; ++i) {
+            FlowField* field = stale[i];
+            int target = staleTargets[i];
+            flowPool->submit([field, target, &doneMutex, &doneCv, &remaining]() {
+                field->compute(target);
+                lock_guard<mutex> lock(doneMutex);
+                if (--remaining == 0) doneCv.notify_one();
+            });
+        }
+        stale[0]->compute(staleTargets[0]);
+        unique_lock<mutex> lock(doneMutex);
+        doneCv.wait(lock, [&remaining]() { return remaining == 0; });
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            stale[i]->compute(staleTargets[i]);
+        }
+    }
+    flowBuilds += count;
+    flowTime += chrono::steady_clock::now() - start;
+}
+
+// Swarm mode: a ghost's move is one lookup in the field its rule follows.
+// False leaves the ghost to its own update (no field reaches its cell, or it
+// already stands on the target).
+bool Game::chaseAlongFlow(size_t index) {
+    Ghost& ghost = ghosts[index];
+    if (!ghost.isAlive()) return false;
+    if (flowTick != time) updateFlowFields();
+
+    int slot = static_cast<int>(ghost.getType());
+    if (ghost.getType() == GhostType::CLYDE && getGhostMode() == GhostMode::CHASE) {
+        int dY = ghost.getY() - pacman.getY();
+        int dX = ghost.getX() - pacman.getX();
+        if (dY * dY + dX * dX < Ghost::CLYDE_SHY_DISTANCE * Ghost::CLYDE_SHY_DISTANCE) slot = FLOW_SLOTS - 1;
+    }
+    if (flowSlots[slot] < 0) return false;
+    int width = gameMap.getWidth();
+    int cell = ghost.getY() * width + ghost.getX();
+    int next = flowFields[flowSlots[slot]].next(cell);
+    if (next == cell) return false;
+
+    Direction direction = Direction::RIGHT;
+    if (next == cell - width) direction = Direction::UP;
+    else if (next == cell + width) direction = Direction::DOWN;
+    else if (next == cell - 1) direction = Direction::LEFT;
+    ghost.steer(direction, gameMap, *this);
+    return true;
+}
+
+bool Game::loadStrategy(const string& path, string& error) {
+    if (!strategy.load(path, error)) {
+        return false;
+    }
+    strategyGhosts.resize(ghosts.size());
+    strategyMoves.assign(ghosts.size(), PACMAN_DIR_NONE);
+    strategyTick = -1;
+    // A replay would need the same library to play back, so don't record one
+    replayDirectory.clear();
+    return true;
+}
+
+// One plugin call decides for every ghost; ghosts stepping later in the same
+// tick use the answer already made for them
+void Game::decideGhosts() {
+    TRACE_SCOPE("strategy.decide");
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        PacmanGhostView& view = strategyGhosts[i];
+        view.y = ghosts[i].getY();
+        view.x = ghosts[i].getX();
+        view.type = static_cast<uint8_t>(ghosts[i].getType());
+        view.direction = static_cast<uint8_t>(ghosts[i].getDirection());
+        view.alive = ghosts[i].isAlive() ? 1 : 0;
+        view.reserved = 0;
+    }
+
+    PacmanGameView view;
+    view.abiVersion = PACMAN_STRATEGY_ABI_VERSION;
+    view.tick = static_cast<uint32_t>(time);
+    view.width = gameMap.getWidth();
+    view.height = gameMap.getHeight();
+    view.rows = gameMap.getRows();
+    view.nav = gameMap.getLevelData().navData();
+    view.pacmanY = pacman.getY();
+    view.pacmanX = pacman.getX();
+    switch (pacman.getDirection()) {   // the glyph is Pacman's mouth: '<' moves right
+        case '^': view.pacmanDirection = PACMAN_DIR_UP; break;
+        case 'v': view.pacmanDirection = PACMAN_DIR_DOWN; break;
+        case '<': view.pacmanDirection = PACMAN_DIR_RIGHT; break;
+        case '>': view.pacmanDirection = PACMAN_DIR_LEFT; break;
+        default: view.pacmanDirection = PACMAN_DIR_NONE; break;
+    }
+    view.superMode = superMode ? 1 : 0;
+    view.reserved[0] = view.reserved[1] = 0;
+    view.ghostCount = static_cast<uint32_t>(strategyGhosts.size());
+    view.ghosts = strategyGhosts.data();
+
+    strategy.decide(view, strategyMoves.data());
+    strategyTick = time;
+}
+
+void Game::stepGhost(size_t index) {
+    TRACE_SCOPE_ARG("Ghost::update", index);
+    uint8_t move = PACMAN_DIR_NONE;
+    if (strategy.isLoaded()) {
+        if (strategyTick != time) {
+            decideGhosts();
+        }
+        move = strategyMoves[index];
+    }
+    if (move >= PACMAN_DIR_UP && move <= PACMAN_DIR_LEFT) {
+        ghosts[index].steer(static_cast<Direction>(move), gameMap, *this);
+    } else if (!swarm || !chaseAlongFlow(index)) {
+        ghosts[index].update(pacman, gameMap, *this);
+    }
+    if (recorder.isOpen()) {
+        recorder.recordGhost(index);
+    }
+}
+
+GhostMode Game::getGhostMode() const {
+    if (superMode) return GhostMode::FRIGHTENED;
+    int elapsed = time;
+    for (size_t wave = 0; wave < sizeof(MODE_WAVES) / sizeof(MODE_WAVES[0]); ++wave) {
+        if (elapsed < MODE_WAVES[wave]) return wave % 2 == 0 ? GhostMode::SCATTER : GhostMode::CHASE;
+        elapsed -= MODE_WAVES[wave];
+    }
+    return GhostMode::CHASE;
+}
+
+void Game::captureSnapshot(GameSnapshot& snapshot) const {
+    snapshot.level = gameMap.getCurrentLevel();
+    snapshot.time = time;
+    snapshot.SMtime = SMtime;
+    snapshot.score = score;
+    snapshot.lives = lives;
+    snapshot.dotsEaten = dotsEaten;
+    snapshot.maxDots = maxDots;
+    snapshot.superMode = superMode;
+    snapshot.rngState = rng.getState();
+    snapshot.message = message;
+    if (gameMap.getCurrentLevel() == LevelData::FILE_LEVEL) {
+        snapshot.layout = gameMap.shareLevelData();
+    } else {
+        snapshot.layout.reset();
+    }
+
+    snapshot.height = gameMap.getHeight();
+    snapshot.width = gameMap.getWidth();
+    snapshot.cells.resize(static_cast<size_t>(snapshot.height) * snapshot.width);
+    for (int y = 0; y < snapshot.height; ++y) {
+        for (int x = 0; x < snapshot.width; ++x) {
+            snapshot.cells[y * snapshot.width + x] = gameMap.getCell(y, x);
+        }
+    }
+
+    snapshot.pacman.y = pacman.getY();
+    snapshot.pacman.x = pacman.getX();
+    snapshot.pacman.direction = pacman.getDirection();
+    snapshot.pacman.alive = pacman.isAlive();
+
+    snapshot.ghosts.resize(ghosts.size());
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        snapshot.ghosts[i].y = ghosts[i].getY();
+        snapshot.ghosts[i].x = ghosts[i].getX();
+        snapshot.ghosts[i].direction = static_cast<char>(ghosts[i].getDirection());
+        snapshot.ghosts[i].alive = ghosts[i].isAlive();
+        snapshot.ghosts[i].under = ghosts[i].getUnder();
+    }
+}
+
+void Game::restoreSnapshot(const GameSnapshot& snapshot) {
+    scoringCursor = events.subscribe();   // events before the restored state don't apply
+    if (snapshot.layout && snapshot.layout != gameMap.shareLevelData()) {
+        gameMap.loadLevel(snapshot.layout);
+        terrain.build(snapshot.layout);
+        buildRoutes();
+    } else if (snapshot.level != gameMap.getCurrentLevel()) {
+        gameMap.loadLevel(snapshot.level);
+        terrain.build(gameMap.shareLevelData());
+        buildRoutes();
+    }
+    time = snapshot.time;
+    strategyTick = -1;
+    flowTick = -1;
+    SMtime = snapshot.SMtime;
+    score = snapshot.score;
+    lives = snapshot.lives;
+    dotsEaten = snapshot.dotsEaten;
+    maxDots = snapshot.maxDots;
+    superMode = snapshot.superMode;
+    rng.setState(snapshot.rngState);
+    message = snapshot.message;
+
+    for (int y = 0; y < snapshot.height; ++y) {
+        for (int x = 0; x < snapshot.width; ++x) {
+            gameMap.setCell(y, x, snapshot.cells[y * snapshot.width + x]);
+        }
+    }
+
+    pacman.setPosition(snapshot.pacman.y, snapshot.pacman.x);
+    pacman.setDirection(snapshot.pacman.direction);
+    pacman.setAlive(snapshot.pacman.alive);
+
+    for (size_t i = 0; i < ghosts.size() && i < snapshot.ghosts.size(); ++i) {
+        ghosts[i].setPosition(snapshot.ghosts[i].y, snapshot.ghosts[i].x);
+        ghosts[i].setDirection(static_cast<Direction>(snapshot.ghosts[i].direction));
+        ghosts[i].setAlive(snapshot.ghosts[i].alive);
+        ghosts[i].setUnder(snapshot.ghosts[i].under);
+    }
+}
+
+void Game::startRecording() {
+    if (replayDirectory.empty()) return;
+
+    mkdir(replayDirectory.c_str(), 0755);
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    string path = replayDirectory + "/pacman-" + stamp + ".pmr";
+    recordTo(path);
+}
+
+bool Game::recordTo(const string& path) {
+    if (!recorder.open(path, gameMap.getCurrentLevel(), seed, ghosts.size())) return false;
+    captureSnapshot(snapshotScratch);
+    recorder.recordKeyframe(snapshotScratch, true);
+    return true;
+}
+
+// Called with the snapshot of the tick just played. Only the image that is not
+// published is touched, so a signal handler reading the other never sees a
+// half-encoded save.
+void Game::publishSave() {
+    int next = publishedSave.load(memory_order_relaxed) == 0 ? 1 : 0;
+    saveImages[next].encode(snapshotScratch);
+    publishedSave.store(next, memory_order_release);
+}
+
+bool Game::saveGame() {
+    if (savePath.empty()) return false;
+    captureSnapshot(snapshotScratch);
+    publishSave();
+    const SaveImage& image = saveImages[publishedSave.load(memory_order_relaxed)];
+    bool saved = writeSaveFile(savePath.c_str(), image);
+    message = saved ? MessageId::GAME_SAVED : MessageId::SAVE_FAILED;
+    return saved;
+}
+
+bool Game::writeLastSave() const {
+    int index = publishedSave.load(memory_order_acquire);
+    if (index < 0 || savePath.empty()) return false;
+    return writeSaveFile(savePath.c_str(), saveImages[index]);
+}
+
+bool Game::loadSave(const string& path, string& error) {
+    if (!loadSaveFile(path, resumeState, error)) return false;
+    if (resumeState.ghosts.size() != ghosts.size()) {
+        error = "save was written with " + to_string(resumeState.ghosts.size()) + " ghosts";
+        return false;
+    }
+    resumePending = true;
+    return true;
+}
+
+bool Game::watchLevelFile(const string& path, string& error) {
+    LevelData::Region changed;
+    shared_ptr<const LevelData> level = LevelData::fromFile(LevelData::FILE_LEVEL, path, nullptr, changed, error);
+    if (!level) return false;
+    if (level->getGhostSpawns().size() < ghosts.size()) {
+        error = path + " needs " + to_string(ghosts.size()) + " ghost spawns";
+        return false;
+    }
+    LevelData::install(level);
+    levelPath = path;
+    if (!levelWatcher.open(path)) {
+        error = "cannot watch " + path;
+        return false;
+    }
+    return true;
+}
+
+// Large levels route the ghosts; the built-in ones keep the greedy turn
+void Game::buildRoutes() {
+    shared_ptr<const LevelData> level = gameMap.shareLevelData();
+    if (level == routesLevel) return;
+    routesLevel = level;
+    if (HierarchicalPathfinder::suits(*level)) {
+        routes.reset(new HierarchicalPathfinder(*level));
+    } else {
+        routes.reset();
+    }
+}
+
+// Runs between ticks under the game lock. A file that can't be used leaves
+// the level as it was; otherwise the game carries on in the new layout with
+// its score, lives, eaten dots and actors kept wherever they still fit.
+void Game::reloadLevelFile() {
+    TRACE_SCOPE("reloadLevelFile");
+    shared_ptr<const LevelData> current = LevelData::acquire(LevelData::FILE_LEVEL);
+    LevelData::Region changed;
+    string error;
+    shared_ptr<const LevelData> level =
+        LevelData::fromFile(LevelData::FILE_LEVEL, levelPath, current.get(), changed, error);
+    if (!level || level->getGhostSpawns().size() < ghosts.size()) {
+        message = MessageId::LEVEL_RELOAD_FAILED;
+        return;
+    }
+    LevelData::install(level);
+    if (gameMap.getCurrentLevel() != LevelData::FILE_LEVEL || changed.empty()) return;
+
+    gameMap.setCell(pacman.getY(), pacman.getX(), ' ');
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        gameMap.setCell(ghosts[i].getY(), ghosts[i].getX(), ghosts[i].getUnder());
+    }
+    if (level->getHeight() == gameMap.getHeight() && level->getWidth() == gameMap.getWidth()) {
+        maxDots += gameMap.reloadLevel(level, changed);
+        terrain.update(level, changed);
+        if (routes) {
+            // A few walls moved: patch their clusters; more than that, start over
+            int moved = 0;
+            for (int y = changed.top; y <= changed.bottom; ++y) {
+                for (int x = changed.left; x <= changed.right; ++x) {
+                    moved += routes->isWalkable(y * level->getWidth() + x) != (level->terrainAt(y, x) == LevelData::FLOOR);
+                }
+            }
+            if (moved > ROUTE_PATCH_LIMIT) {
+                routes.reset(new HierarchicalPathfinder(*level));
             } else {
-                // print single-char items (pacman, ghosts, dots, fruit)
-                cout << cellChar;
+                for (int y = changed.top; y <= changed.bottom; ++y) {
+                    for (int x = changed.left; x <= changed.right; ++x) {
+                        routes->setWalkable(y, x, level->terrainAt(y, x) == LevelData::FLOOR);
+                    }
+                }
             }
         }
-        cout << endl;
+        routesLevel = level;
+    } else {
+        // A new size starts the level over; score and lives carry on
+        gameMap.loadLevel(LevelData::FILE_LEVEL);
+        terrain.build(level);
+        buildRoutes();
+        maxDots = gameMap.getMaxDots();
+        dotsEaten = 0;
+        repaintPending = true;
+    }
+
+    // Actors stay put unless the edit walled them in or cut them off the grid
+    if (!level->contains(pacman.getY(), pacman.getX()) ||
+        level->terrainAt(pacman.getY(), pacman.getX()) == LevelData::WALL) {
+        pacman.setPosition(level->getPacmanSpawn().y, level->getPacmanSpawn().x);
+    }
+    const LevelData::Spawn& start = level->getPacmanSpawn();
+    if (gameMap.isPacman(start.y, start.x)) gameMap.setCell(start.y, start.x, ' ');   // the file's start glyph
+    const vector<LevelData::Spawn>& spawns = level->getGhostSpawns();
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        int y = ghosts[i].getY();
+        int x = ghosts[i].getX();
+        if (!level->contains(y, x) || level->terrainAt(y, x) == LevelData::WALL) {
+            ghosts[i].setPosition(spawns[i].y, spawns[i].x);
+            y = spawns[i].y;
+            x = spawns[i].x;
+        }
+        // The edit may have put a dot under the ghost or taken one away
+        ghosts[i].setUnder(gameMap.isDot(y, x) || gameMap.isSuperPellet(y, x) ? gameMap.getCell(y, x) : ' ');
+        gameMap.setCell(y, x, ghosts[i].getCharacter());
+    }
+    gameMap.setCell(pacman.getY(), pacman.getX(), pacman.getCharacter());
+
+    // Rewinding across the edit would mix layouts; replays re-sync here. The
+    // keyframe stays out of the index, which holds only the periodic ones
+    message = MessageId::LEVEL_RELOADED;
+    rewindBuffer.clear();
+    if (recorder.isOpen()) {
+        captureSnapshot(snapshotScratch);
+        recorder.recordKeyframe(snapshotScratch, false);
+    }
+}
+
+void Game::stopRecording() {
+    if (recorder.isOpen()) {
+        recorder.close();
+    }
+}
+
+bool Game::rewindStep() {
+    if (!rewindBuffer.stepBack()) return false;
+    restoreSnapshot(rewindBuffer.current());
+    if (!headless) {
+        displayGame();
+    }
+    return true;
+}
+
+void Game::resumeFromRewind() {
+    rewinding = false;
+    // The replay can't re-simulate a jump back in time, so store the state we resume from
+    if (recorder.isOpen()) {
+        captureSnapshot(snapshotScratch);
+        recorder.recordKeyframe(snapshotScratch, false);
+    }
+}
+
+// Called on the Pacman thread. Nothing ticks while paused: this thread sleeps
+// in poll() on stdin and the ghost threads on pauseSignal.
+void Game::pauseGame() {
+    {
+        InstrumentedLock lock(gameMutex, gameMutex.site("input"));
+        paused = true;
+        if (!headless) displayGame();
+    }
+
+    bool inputClosed = false;
+    while (true) {
+        int key = waitKey();
+        if (key == PAUSE_KEY) break;
+        if (key == INPUT_CLOSED) {
+            inputClosed = true;
+            break;
+        }
+        if (key == NO_KEY) {
+            // Woken by a signal: maybe a trace export, maybe a resize to repaint for
+            TRACE_SERVICE_REQUESTS(PACMAN_TRACE_FILE);
+            if (!headless && resizeGeneration() != screenGeneration) {
+                InstrumentedLock lock(gameMutex, gameMutex.site("input"));
+                displayGame();
+            }
+        }
+    }
+
+    {
+        InstrumentedLock lock(gameMutex, gameMutex.site("input"));
+        {
+            lock_guard<mutex> pauseLock(pauseMutex);
+            paused = false;
+            if (inputClosed) gameRunning = false;
+        }
+        if (!headless) displayGame();
+    }
+    pauseSignal.notify_all();
+}
+
+void Game::toggleHud() {
+    hudVisible = !hudVisible;
+    if (hudVisible) {
+        hud.start(perf, terminal, gameMutex, events);
+    } else {
+        hud.stop();
+    }
+    repaintPending = true;   // the board moves by a line
+    if (!headless) {
+        displayGame();
+    }
+}
+
+void Game::displayGame() {
+    {
+        TRACE_SCOPE("frame.build");
+        auto buildStart = chrono::steady_clock::now();
+        buildFrame(frameLines);
+        perf.frameBuilt(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - buildStart).count());
+    }
+
+    if (!headless) {
+        TRACE_SCOPE("frame.submit");
+        // One write(2) for the whole frame instead of a flush per line, made
+        // by the writer thread so a slow terminal never holds up the game
+        composeFrame();
+        cout.flush();   // anything already queued on cout goes out first
+        terminal.submit(frameBytes);
+    }
+
+    if (spectators.isRunning()) {
+        TRACE_SCOPE("spectators.publish");
+        spectators.publish(frameLines);
+    }
+}
+
+// Appends 'line' but stops after 'maxCols' visible columns. Escape sequences
+// take no columns and UTF-8 continuation bytes belong to the previous glyph.
+static void appendClipped(string& out, const string& line, int maxCols) {
+    int cols = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+        unsigned char c = static_cast<unsigned char>(line[i]);
+        if (c == '\033') {
+            size_t end = i + 1;
+            while (end < line.size() && !isalpha(static_cast<unsigned char>(line[end]))) ++end;
+            out.append(line, i, end + 1 - i);
+            i = end + 1;
+            continue;
+        }
+        if ((c & 0xC0) != 0x80) {
+            if (cols == maxCols) break;
+            ++cols;
+        }
+        out += line[i++];
+    }
+}
+
+static void appendCursorTo(string& out, int row, int col) {
+    char move[32];
+    snprintf(move, sizeof(move), "\033[%d;%dH", row, col);
+    out += move;
+}
+
+// Lays frameLines out for the cached terminal size: centred when there is
+// room, clipped when not. The size is only re-read after a SIGWINCH, and that
+// frame (or one after a layout change) clears the screen first.
+void Game::composeFrame() {
+    uint64_t generation = resizeGeneration();
+    if (generation != screenGeneration) {
+        screen = queryTerminalGeometry();
+        screenGeneration = generation;
+        repaintPending = true;
+    }
+    if (frameLines.size() != lastFrameLines) {
+        lastFrameLines = frameLines.size();
+        repaintPending = true;
+    }
+
+    frameBytes.clear();
+    if (repaintPending) {
+        frameBytes += "\033[2J";
+        repaintPending = false;
+    }
+
+    const int lineCount = static_cast<int>(frameLines.size());
+    const int boardWidth = gameMap.getWidth();
+    const bool known = screen.rows > 0 && screen.cols > 0;
+    const int top = known && screen.rows > lineCount ? (screen.rows - lineCount) / 2 : 0;
+    const int left = known && screen.cols > boardWidth ? (screen.cols - boardWidth) / 2 : 0;
+    const int visibleLines = known ? min(lineCount, screen.rows - top) : lineCount;
+    const int maxCols = known ? screen.cols - left : INT_MAX;
+
+    for (int i = 0; i < visibleLines; ++i) {
+        appendCursorTo(frameBytes, top + i + 1, left + 1);
+        appendClipped(frameBytes, frameLines[i], maxCols);
+        frameBytes += "\033[0m\033[K";   // nothing stale right of the line
+    }
+    // Leave the cursor below the board for anything printed after the frame
+    appendCursorTo(frameBytes, known ? min(top + lineCount + 1, screen.rows) : lineCount + 1, 1);
+
+    // Submitting swaps buffers with the writer, so all of them get room for
+    // twice the largest frame yet; steady-state frames then never grow one
+    if (frameBytes.size() > frameReserve) {
+        frameReserve = frameBytes.size() * 2;
+        frameBytes.reserve(frameReserve);
+        terminal.reserve(frameReserve);
+    }
+}
+
+void Game::appendCell(string& row, char cellChar) const {
+    // choose color based on character
+    switch(cellChar) {
+        case '#':
+            appendTextColor(row, BLUE);
+            break;
+        case '<': case '^': case '>': case 'v': // pacman glyphs
+            appendTextColor(row, BRIGHT_YELLOW);
+            break;
+        case 'M':
+            appendTextColor(row, superMode ? WHITE : BRIGHT_RED);
+            break;
+        case 'Y':
+            appendTextColor(row, superMode ? WHITE : BRIGHT_GREEN);
+            break;
+        case 'W':
+            appendTextColor(row, superMode ? WHITE : BRIGHT_MAGENTA);
+            break;
+        case 'U':
+            appendTextColor(row, superMode ? WHITE : BRIGHT_CYAN);
+            break;
+        case '.':
+            appendTextColor(row, YELLOW);
+            break;
+        case 'O':
+            appendTextColor(row, BRIGHT_WHITE);
+            break;
+        case '[': case ']':
+            appendTextColor(row, CYAN);
+            break;
+        default:
+            appendTextColor(row, WHITE);
+            break;
+    }
+
+    // print glyph; walls use BLOCK_FULL (multi-byte), others print the char
+    if (cellChar == '#') {
+        row += BLOCK_FULL;
+    } else {
+        // print single-char items (pacman, ghosts, dots, fruit)
+        row += cellChar;
+    }
+}
+
+void Game::buildFrame(vector<string>& lines) const {
+    const int top = hudVisible ? 2 : 1;   // board starts below the header (and HUD)
+    lines.resize(gameMap.getHeight() + top + 1);
+    // Worst-case row: a colour escape plus a 3-byte glyph per cell. Reserving
+    // it up front keeps lines from regrowing when the score or message lengthens
+    const size_t lineCapacity = static_cast<size_t>(gameMap.getWidth()) * 9 + PerfHud::LINE_SIZE;
+    for (auto& line : lines) {
+        line.clear();
+        line.reserve(lineCapacity);
+    }
+
+    // Score + Lives (hearts)
+    string& header = lines[0];
+    appendTextColor(header, BRIGHT_RED);
+    char number[32];
+    snprintf(number, sizeof(number), "%d", score);
+    header += "  Score: ";
+    header += number;
+
+    appendTextColor(header, BRIGHT_YELLOW);
+    header += "  Lives: ";
+
+    // print 3 hearts (solid if present, empty if lost)
+    const int MAX_LIVES = 3;
+    for (int i = 0; i < MAX_LIVES; ++i) {
+        if (i < lives) {
+            header += HEART_SOLID;
+            header += " ";
+        } else {
+            header += HEART_EMPTY;
+            header += " ";
+        }
+    }
+
+    if (hudVisible) {
+        appendTextColor(lines[1], CYAN);
+        hud.appendLine(lines[1]);
+    }
+
+    int h = gameMap.getHeight();
+    int w = gameMap.getWidth();
+    int py = pacman.getY();
+    int px = pacman.getX();
+    const bool cached = terrain.isFor(gameMap.getLevelData());
+
+    // Render row-by-row straight from the map, overlaying pacman and then the
+    // ghosts (no copy of the grid). Cells that match the level's static layer
+    // are copied from the terrain cache a span at a time; only the rest (dots,
+    // pellets, actors) are rendered here.
+    for (int y = 0; y < h; ++y) {
+        string& row = lines[y + top];
+        const char* cells = gameMap.getRow(y);
+        bool actorsOnRow = (y == py);
+        for (const auto& g : ghosts) {
+            actorsOnRow = actorsOnRow || y == g.getY();
+        }
+
+        int spanStart = 0;
+        for (int x = 0; x < w; ++x) {
+            char cellChar = cells[x];
+            if (actorsOnRow) {
+                if (y == py && x == px) {
+                    cellChar = pacman.getChar();
+                }
+                for (const auto& g : ghosts) {
+                    if (y == g.getY() && x == g.getX()) {
+                        cellChar = g.getChar();
+                    }
+                }
+            }
+            if (cached && cellChar == terrain.baseCell(y, x)) {
+                continue;
+            }
+            if (cached) {
+                terrain.appendSpan(row, y, spanStart, x);
+            }
+            appendCell(row, cellChar);
+            spanStart = x + 1;
+        }
+        if (cached) {
+            terrain.appendSpan(row, y, spanStart, w);
+        }
     }
 
     // Show message line
-    setTextColor(YELLOW);
-    cout << "[GAME] " << message << "                          " << endl;
+    string& footer = lines[h + top];
+    appendTextColor(footer, YELLOW);
+    if (paused) {
+        footer += "[PAUSED] press P to resume";
+    } else if (rewinding) {
+        char status[64];
+        snprintf(status, sizeof(status), "[REWIND] tick %d (%zu more)", time, rewindBuffer.size());
+        footer += status;
+    } else {
+        footer += "[GAME] ";
+        footer += messageText(message);
+    }
+    footer += "                          ";
 }
 
 
@@ -267,16 +1233,18 @@ void Game::handleGameEnd() {
         showGameOverScreen();
     }
 
+    // How the five game threads shared gameMutex this game
+    setTextColor(CYAN);
+    cout << endl;
+    gameMutex.printReport(cout);
+    resetTextColor();
+
     // Prompt and wait for a single key (use your kbhit/getch helpers)
     setTextColor(BRIGHT_YELLOW);
     cout << "\n(Press any key to continue...)" << endl;
 
-    // Wait for a keypress (works with raw mode)
-    while (!kbhit()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    }
-    char c = getch(); // consume the key so subsequent logic isn't messed up
-    (void)c;
+    // Wait for a keypress (blocks; no polling)
+    nextMenuKey();
 }
 
 
@@ -291,16 +1259,26 @@ int Game::showTitleScreen() {
     |__|  |__|__|_____|_|_|_|__|__|_|___|
     )";
     
-    char input = getch();
+    int input = nextMenuKey();
     cout << " ";
     
     switch(input) {
-        case 's':
+        case 's': {
             cout << "New game starting..." << endl;
-            cout << "Select level (1 or 2): ";
-            int level;
-            cin >> level;
-            return level;
+            int lastLevel = levelPath.empty() ? 2 : LevelData::FILE_LEVEL;
+            if (levelPath.empty()) {
+                cout << "Select level (1 or 2): ";
+            } else {
+                cout << "Select level (1, 2 or 3 = " << levelPath << "): ";
+            }
+            int key;
+            do {
+                key = nextMenuKey();
+                if (key == 'q') exit(0);
+            } while (key < '1' || key > '0' + lastLevel);
+            cout << static_cast<char>(key) << endl;
+            return key - '0';
+        }
         case 'q':
             exit(0);
         default:
@@ -0,0 +1,170 @@
+#include "game_log.hpp"
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+const size_t LogRecord::SIZE;
+const size_t GameLog::RING_CAPACITY;
+const int GameLog::FLUSH_MS;
+const uint64_t GameLog::DEFAULT_ROTATE_BYTES;
+const int GameLog::DEFAULT_KEEP_FILES;
+const uint8_t GameLog::VERSION;
+const char GameLog::MAGIC[4] = {'P', 'M', 'L', 'G'};
+
+static void putLE(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint64_t getLE(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+void LogRecord::encode(uint8_t* out) const {
+    putLE(out, tick, 4);
+    putLE(out + 4, static_cast<uint32_t>(score), 4);
+    out[8] = type;
+    out[9] = static_cast<uint8_t>(entity);
+    out[10] = y;
+    out[11] = x;
+    out[12] = lives;
+    out[13] = level;
+    putLE(out + 14, reserved, 2);
+}
+
+LogRecord LogRecord::decode(const uint8_t* in) {
+    LogRecord r;
+    r.tick = static_cast<uint32_t>(getLE(in, 4));
+    r.score = static_cast<int32_t>(static_cast<uint32_t>(getLE(in + 4, 4)));
+    r.type = in[8];
+    r.entity = static_cast<char>(in[9]);
+    r.y = in[10];
+    r.x = in[11];
+    r.lives = in[12];
+    r.level = in[13];
+    r.reserved = static_cast<uint16_t>(getLE(in + 14, 2));
+    return r;
+}
+
+GameLog::GameLog() : head(0), tail(0), dropped(0), written(0), opened(false), file(nullptr),
+                     fileBytes(0), rotateBytes(DEFAULT_ROTATE_BYTES), keepFiles(DEFAULT_KEEP_FILES),
+                     stopping(false) {
+}
+
+GameLog::~GameLog() {
+    close();
+}
+
+bool GameLog::open(const string& logPath, uint64_t rotateAt, int keep) {
+    if (opened) close();
+    path = logPath;
+    rotateBytes = rotateAt;
+    keepFiles = keep;
+    if (!openFile()) return false;
+
+    head = 0;
+    tail = 0;
+    batch.reserve(RING_CAPACITY * LogRecord::SIZE);
+    stopping = false;
+    opened = true;
+    flusher = thread(&GameLog::flushLoop, this);
+    return true;
+}
+
+void GameLog::close() {
+    if (!opened) return;
+    {
+        lock_guard<mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+    flusher.join();    // the flusher drains the ring once more before exiting
+    if (file) {
+        fclose(file);     // null if a rotation could not reopen the log
+        file = nullptr;
+    }
+    opened = false;
+}
+
+void GameLog::append(const LogRecord& record) {
+    uint64_t h = head.load(memory_order_relaxed);
+    if (h - tail.load(memory_order_acquire) >= RING_CAPACITY) {
+        dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    ring[h & (RING_CAPACITY - 1)] = record;
+    head.store(h + 1, memory_order_release);
+}
+
+size_t GameLog::drainBatch() {
+    uint64_t t = tail.load(memory_order_relaxed);
+    uint64_t h = head.load(memory_order_acquire);
+    batch.resize(static_cast<size_t>(h - t) * LogRecord::SIZE);
+    uint8_t* out = batch.data();
+    for (uint64_t i = t; i < h; ++i, out += LogRecord::SIZE) {
+        ring[i & (RING_CAPACITY - 1)].encode(out);
+    }
+    tail.store(h, memory_order_release);
+    return batch.size();
+}
+
+void GameLog::flushLoop() {
+    unique_lock<mutex> lock(stopMutex);
+    bool last = false;
+    while (!last) {
+        last = stopSignal.wait_for(lock, chrono::milliseconds(FLUSH_MS), [this]() { return stopping; });
+        size_t bytes = drainBatch();
+        if (bytes > 0 && writeBatch(bytes)) {
+            written.fetch_add(bytes / LogRecord::SIZE, memory_order_relaxed);
+        }
+    }
+}
+
+bool GameLog::writeBatch(size_t bytes) {
+    if (fileBytes + bytes > rotateBytes && fileBytes > 0) {
+        rotate();
+    }
+    if (!file) return false;
+    bool ok = fwrite(batch.data(), 1, bytes, file) == bytes;
+    fflush(file);
+    fileBytes += bytes;
+    return ok;
+}
+
+bool GameLog::openFile() {
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    uint8_t header[8] = {0};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    header[4] = VERSION;
+    header[5] = static_cast<uint8_t>(LogRecord::SIZE);
+    fwrite(header, 1, sizeof(header), file);
+    fileBytes = sizeof(header);
+    return true;
+}
+
+void GameLog::rotate() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    // path.N-1 -> path.N, ..., path -> path.1; the oldest is overwritten
+    for (int i = keepFiles - 1; i >= 1; --i) {
+        string from = path + "." + to_string(i);
+        string to = path + "." + to_string(i + 1);
+        rename(from.c_str(), to.c_str());
+    }
+    if (keepFiles > 0) {
+        rename(path.c_str(), (path + ".1").c_str());
+    }
+    openFile();
+}
+
+bool GameLog::readHeader(FILE* in) {
+    uint8_t header[8];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header)) return false;
+    return memcmp(header, MAGIC, sizeof(MAGIC)) == 0 && header[4] == VERSION &&
+           header[5] == LogRecord::SIZE;
+}
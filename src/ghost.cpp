@@ -1,6 +1,8 @@
 #include "ghost.hpp"
 #include "map.hpp"
 #include "game.hpp"
+#include "pacman.hpp"
+#include "pathfinder.hpp"
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
@@ -8,12 +10,16 @@
 
 using namespace std;
 
+const int Ghost::CLYDE_SHY_DISTANCE;
+
 Ghost::Ghost() : posY(9), posX(12), type(GhostType::BLINKY), character('M'), 
-                 direction(Direction::UP), speed(250), alive(true) {
+                 direction(Direction::UP), speed(250), alive(true), under(' '), targetY(0), targetX(0),
+                 targetValid(false) {
 }
 
 Ghost::Ghost(GhostType t, int y, int x, int spd) : posY(y), posX(x), type(t), 
-                                                   speed(spd), alive(true) {
+                                                   speed(spd), alive(true), under(' '), targetY(0), targetX(0),
+                                                   targetValid(false) {
     switch(type) {
         case GhostType::BLINKY:
             character = 'M';
@@ -38,20 +44,50 @@ char Ghost::getChar() const {
     return character;
 }
 
-void Ghost::update(int pacmanY, int pacmanX, Map& map, Game& game) {
+void Ghost::update(const Pacman& pacman, Map& map, Game& game) {
     if (!alive) return;
-    
-    int targetY, targetX;
-    setTarget(targetY, targetX, pacmanY, pacmanX, game.isSuperMode());
-    
+
+    GhostTargetKey key;
+    key.pacmanY = pacman.getY();
+    key.pacmanX = pacman.getX();
+    key.pacmanDirection = pacman.getDirection();
+    key.mode = game.getGhostMode();
+    key.otherY = key.otherX = -1;
+    key.near = false;
+    key.mapHeight = map.getHeight();
+    key.mapWidth = map.getWidth();
+    if (key.mode == GhostMode::CHASE && type == GhostType::INKY) {
+        for (size_t i = 0; i < game.getGhostCount(); ++i) {
+            const Ghost& other = game.getGhost(i);
+            if (other.getType() == GhostType::BLINKY) {
+                key.otherY = other.getY();
+                key.otherX = other.getX();
+                break;
+            }
+        }
+    } else if (key.mode == GhostMode::CHASE && type == GhostType::CLYDE) {
+        int dY = posY - key.pacmanY;
+        int dX = posX - key.pacmanX;
+        key.near = dY * dY + dX * dX < CLYDE_SHY_DISTANCE * CLYDE_SHY_DISTANCE;
+    }
+
+    // The target is a function of the relevant part of the key alone, so
+    // an unchanged part means an unchanged target (across rewinds and restores too)
+    GhostTargetKey relevant = relevantPart(key);
+    if (!targetValid || !(relevant == targetKey)) {
+        setTarget(targetY, targetX, key);
+        targetKey = relevant;
+        targetValid = true;
+    }
+
     moveTowardsTarget(targetY, targetX, map, game);
 }
 
 void Ghost::move(Map& map, Game& game) {
     if (!alive) return;
     
-    // Clear current position
-    map.setCell(posY, posX, ' ');
+    // Uncover what the ghost was standing on
+    map.setCell(posY, posX, under);
     
     int newY = posY;
     int newX = posX;
@@ -74,6 +110,7 @@ void Ghost::move(Map& map, Game& game) {
         if (map.isPortal(posY, posX)) {
             map.handlePortal(posY, posX);
         }
+        under = map.getCell(posY, posX);   // ghosts pass over dots, they don't eat them
     } else {
         // Change direction if can't move
         changeDirection(newY, newX, posY, posX, map, game);
@@ -99,6 +136,10 @@ bool Ghost::canMove(char nextChar, Map& map) {
 }
 
 void Ghost::changeDirection(int targetY, int targetX, int currentY, int currentX, Map& map, Game& game) {
+    // Large levels have routes; the greedy turn below gets lost in their mazes
+    HierarchicalPathfinder* routes = game.getRoutes();
+    if (routes && followRoute(*routes, targetY, targetX, map)) return;
+
     Direction currentDir = direction;
     int dY = currentY - targetY;
     int dX = currentX - targetX;
@@ -121,17 +162,44 @@ void Ghost::changeDirection(int targetY, int targetX, int currentY, int currentX
     
     // If stuck, choose random direction
     if (direction == currentDir) {
-        direction = static_cast<Direction>((rand() % 4) + 1);
+        direction = static_cast<Direction>(game.randomInt(4) + 1);
     }
 }
 
+// Turns onto the first cell of a route to the walkable cell nearest the
+// target. False if there is no route or the cell is taken.
+bool Ghost::followRoute(HierarchicalPathfinder& routes, int targetY, int targetX, Map& map) {
+    // A target next door is move()'s blocked cell, nothing to route to
+    if (abs(targetY - posY) + abs(targetX - posX) <= 1) return false;
+    int width = map.getWidth();
+    int here = posY * width + posX;
+    int goal = routes.nearestWalkable(targetY, targetX);
+    if (goal < 0) return false;
+    int next = routes.nextStep(here, goal, false);
+    if (next == here || !canMove(map.getCell(next / width, next % width), map)) return false;
+
+    int dY = next / width - posY;
+    int dX = next % width - posX;
+    if (dY < 0) direction = Direction::UP;
+    else if (dY > 0) direction = Direction::DOWN;
+    else if (dX < 0) direction = Direction::LEFT;
+    else direction = Direction::RIGHT;
+    return true;
+}
+
 void Ghost::moveTowardsTarget(int targetY, int targetX, Map& map, Game& game) {
     changeDirection(targetY, targetX, posY, posX, map, game);
     move(map, game);
 }
 
+void Ghost::steer(Direction dir, Map& map, Game& game) {
+    if (!alive) return;
+    direction = dir;
+    move(map, game);
+}
+
 void Ghost::randomMove(Map& map, Game& game) {
-    direction = static_cast<Direction>((rand() % 4) + 1);
+    direction = static_cast<Direction>(game.randomInt(4) + 1);
     move(map, game);
 }
 
@@ -164,6 +232,7 @@ void Ghost::reset() {
             break;
     }
     alive = true;
+    under = ' ';
 }
 
 void Ghost::die() {
@@ -174,30 +243,80 @@ void Ghost::respawn() {
     reset();
 }
 
-void Ghost::setTarget(int& targetY, int& targetX, int pacmanY, int pacmanX, bool superMode) {
-    if (!superMode) {
-        // Chase mode - different targeting for each ghost
-        switch(type) {
-            case GhostType::BLINKY:
-                targetY = pacmanY;
-                targetX = pacmanX;
-                break;
-            case GhostType::PINKY:
-                targetY = pacmanY + 2;
-                targetX = pacmanX + 2;
-                break;
-            case GhostType::INKY:
-                targetY = pacmanY;
-                targetX = pacmanX;
-                break;
-            case GhostType::CLYDE:
-                targetY = pacmanY;
-                targetX = pacmanX;
-                break;
+// Each ghost's home corner: Blinky top right, Pinky top left, Inky bottom
+// right, Clyde bottom left
+void Ghost::scatterCorner(int& y, int& x, int mapHeight, int mapWidth) const {
+    bool top = type == GhostType::BLINKY || type == GhostType::PINKY;
+    bool right = type == GhostType::BLINKY || type == GhostType::INKY;
+    y = top ? 0 : mapHeight - 1;
+    x = right ? mapWidth - 1 : 0;
+}
+
+// Blanks the fields setTarget won't read for this ghost and mode. Scatter
+// only needs the map size; fleeing only which half of the map Pacman is in.
+GhostTargetKey Ghost::relevantPart(const GhostTargetKey& key) const {
+    GhostTargetKey part = key;
+    bool ignoresPacman = key.mode == GhostMode::SCATTER ||
+                         (key.mode == GhostMode::CHASE && type == GhostType::CLYDE && key.near);
+    if (ignoresPacman) {
+        part.pacmanY = part.pacmanX = -1;
+    } else if (key.mode == GhostMode::FRIGHTENED) {
+        part.pacmanY = key.pacmanY < key.mapHeight / 2;
+        part.pacmanX = key.pacmanX < key.mapWidth / 2;
+    }
+    bool usesDirection = key.mode == GhostMode::CHASE && (type == GhostType::PINKY || type == GhostType::INKY);
+    if (!usesDirection) part.pacmanDirection = 0;
+    return part;
+}
+
+void Ghost::setTarget(int& y, int& x, const GhostTargetKey& key) const {
+    if (key.mode == GhostMode::SCATTER) {
+        scatterCorner(y, x, key.mapHeight, key.mapWidth);
+        return;
+    }
+    if (key.mode == GhostMode::FRIGHTENED) {
+        // Flee to the corner farthest from Pacman
+        y = key.pacmanY < key.mapHeight / 2 ? key.mapHeight - 1 : 0;
+        x = key.pacmanX < key.mapWidth / 2 ? key.mapWidth - 1 : 0;
+        return;
+    }
+
+    // One cell in the direction Pacman is heading ('<' moves right, '>' left)
+    int stepY = 0, stepX = 0;
+    switch (key.pacmanDirection) {
+        case '^': stepY = -1; break;
+        case 'v': stepY = 1; break;
+        case '<': stepX = 1; break;
+        case '>': stepX = -1; break;
+    }
+
+    switch (type) {
+        case GhostType::BLINKY:
+            // Straight at Pacman
+            y = key.pacmanY;
+            x = key.pacmanX;
+            break;
+        case GhostType::PINKY:
+            // Four cells ahead of Pacman, to cut him off
+            y = key.pacmanY + 4 * stepY;
+            x = key.pacmanX + 4 * stepX;
+            break;
+        case GhostType::INKY: {
+            // The vector from Blinky to two cells ahead of Pacman, doubled
+            int pivotY = key.pacmanY + 2 * stepY;
+            int pivotX = key.pacmanX + 2 * stepX;
+            y = key.otherY < 0 ? pivotY : 2 * pivotY - key.otherY;
+            x = key.otherX < 0 ? pivotX : 2 * pivotX - key.otherX;
+            break;
         }
-    } else {
-        // Flee mode - move away from pacman
-        targetY = 15 - pacmanY;
-        targetX = 15 - pacmanX;
+        case GhostType::CLYDE:
+            // Chases from afar, backs off to his corner up close
+            if (key.near) {
+                scatterCorner(y, x, key.mapHeight, key.mapWidth);
+            } else {
+                y = key.pacmanY;
+                x = key.pacmanX;
+            }
+            break;
     }
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Global operator new/delete replacements count every heap allocation, both
+// process-wide and per thread. Counting is one thread-local increment and one
+// relaxed atomic add per allocation, so it is always compiled in.
+uint64_t allocationsOnThisThread();
+uint64_t allocationsTotal();
+
+// Plays a game with a random-input bot through the interactive tick (frames
+// to /dev/null via the terminal writer, one spectator attached, rewind and
+// save capture) and fails (returns 1) if any tick after level start
+// allocates on the simulating thread, or the writer and spectator threads
+// allocate at all. A tick covers the Pacman step, due ghost steps, input,
+// frame build and state capture.
+int runAllocationCheck(int ticks, uint64_t seed);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 // ANSI color constants for Linux/Unix
 enum TextColor {
     DEFAULT = 0,
@@ -22,3 +24,6 @@ enum TextColor {
 
 void setTextColor(TextColor color);
 void resetTextColor();
+
+// Same escape sequence as setTextColor, appended to a frame buffer
+void appendTextColor(std::string& out, TextColor color);
@@ -36,4 +36,14 @@ enum class InputKey {
 void setTerminalNonBlocking();
 void restoreTerminalBlocking();
 
-InputKey getInputKey();
\ No newline at end of file
+InputKey getInputKey();
+
+// Raw single-byte key input straight from the stdin fd (no stdio buffering).
+// waitKey() sleeps in poll() on stdin and a wake pipe, so idle screens cost
+// no CPU; wakeInputWait() is async-signal-safe and makes it return early.
+const int NO_KEY = -1;          // no key waiting, or a signal woke the wait
+const int INPUT_CLOSED = -2;    // stdin hit EOF / hung up
+
+int readKey();                  // next key, or NO_KEY if none is waiting
+int waitKey();
+void wakeInputWait();
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class GameEventType : uint8_t {
+    DOT_EATEN,
+    PELLET_EATEN,
+    GHOST_EATEN,      // entity = ghost glyph
+    PACMAN_DIED,      // entity = glyph of the ghost that caught him
+    LEVEL_CLEARED,
+    COUNT
+};
+
+// One thing that happened in the simulation. Packs into 64 bits so ring
+// slots can be plain atomics.
+struct GameEvent {
+    GameEventType type;
+    char entity;
+    uint8_t y;
+    uint8_t x;
+    uint32_t tick;
+
+    uint64_t pack() const;
+    static GameEvent unpack(uint64_t bits);
+};
+
+const char* eventTypeName(GameEventType type);
+
+// Fixed-size broadcast ring of GameEvents. The simulation publishes (one
+// producer at a time - whoever holds the game lock) and never waits; each
+// subscriber owns a Cursor and drains in batches whenever it likes. A
+// subscriber that falls more than CAPACITY events behind skips ahead and
+// counts what it missed.
+class EventBus {
+public:
+    static const size_t CAPACITY = 256;   // power of two
+
+    struct Cursor {
+        uint64_t next;
+        uint64_t dropped;
+        Cursor() : next(0), dropped(0) {}
+    };
+
+    EventBus();
+
+    void publish(const GameEvent& event);
+
+    // Copies up to 'max' unread events into 'out'; returns how many
+    size_t drain(Cursor& cursor, GameEvent* out, size_t max) const;
+
+    // A cursor that starts at the next event published
+    Cursor subscribe() const;
+
+    uint64_t getPublished() const { return head.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint64_t> slots[CAPACITY];
+    std::atomic<uint64_t> head;    // sequence number of the next event
+};
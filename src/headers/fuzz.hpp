@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game.hpp"
+
+// One fuzz case: a level, a game seed and the key handed to Pacman::move on
+// each tick (0 = no key that tick). Replaying it gives the same game.
+struct FuzzCase {
+    int level;
+    uint64_t seed;
+    std::vector<char> keys;
+
+    FuzzCase() : level(1), seed(1) {}
+    size_t keyCount() const;
+};
+
+struct InvariantFailure {
+    int tick;
+    const char* rule;
+    std::string detail;
+};
+
+// Rules that must hold after every step of the simulation:
+//   dots       the number of dots and pellets on the grid never grows
+//   score      dotsEaten <= maxDots
+//   walls      neither Pacman nor a ghost stands in a wall
+//   bounds     every actor is on the grid and every portal exits onto it
+//   pacman     exactly one Pacman glyph on the grid
+class InvariantChecker {
+public:
+    InvariantChecker();
+
+    // Call after newGame; checks the level's portals
+    bool begin(const Game& game, InvariantFailure& failure);
+    bool check(const Game& game, InvariantFailure& failure);
+
+private:
+    int dotsOnGrid;
+};
+
+// Entry point for `--fuzz`: plays random and coverage-guided input sequences
+// for 'ticks' ticks in total across 'threads' workers (0 = one per core).
+// The first failure found is minimised and written as a replay to 'reproPath'.
+int runFuzzer(uint64_t ticks, size_t threads, const std::string& reproPath);
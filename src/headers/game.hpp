@@ -4,19 +4,48 @@
 #include <thread>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include "pacman.hpp"
 #include "ghost.hpp"
 #include "map.hpp"
 #include "ultils.hpp"
 #include "color.hpp"
+#include "rng.hpp"
+#include "snapshot.hpp"
+#include "replay.hpp"
+#include "rewind.hpp"
+#include "spectator.hpp"
+#include "message.hpp"
+#include "event_bus.hpp"
+#include "game_log.hpp"
+#include "instrumented_mutex.hpp"
+#include "terminal_writer.hpp"
+#include "perf_hud.hpp"
+#include "terminal_geometry.hpp"
+#include "terrain_cache.hpp"
+#include "strategy_plugin.hpp"
+#include "save_game.hpp"
+#include "level_watcher.hpp"
+#include "pathfinder.hpp"
+#include "swarm.hpp"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 
+class WorkStealingPool;
+
 class Game {
 private:
+    static const int FLOW_SLOTS = 5;   // one chase rule per ghost type, plus Clyde up close
+
     Pacman pacman;
     std::vector<Ghost> ghosts;
     Map gameMap;
+    TerrainCache terrain;          // static layer of gameMap's level, baked for buildFrame
+    std::unique_ptr<HierarchicalPathfinder> routes;   // ghost routes on large levels, null on small ones
+    std::shared_ptr<const LevelData> routesLevel;     // the level 'routes' matches
     
     int score;
     int lives;
@@ -25,44 +54,167 @@ private:
     int dotsEaten;
     int maxDots;
     bool superMode;
-    std::string message;
+    MessageId message;
+    bool headless;
+    
+    Rng rng;
+    uint64_t seed;
+    std::string replayDirectory;
+    ReplayRecorder recorder;
+    RewindBuffer rewindBuffer;
+    GameSnapshot snapshotScratch;
+    SpectatorBroadcaster spectators;
+    std::vector<std::string> frameLines;
+    std::string frameBytes;
+    size_t frameReserve;           // capacity every frame buffer the writer rotates through has
+    uint64_t screenGeneration;     // resizeGeneration() the cached size belongs to
+    TerminalGeometry screen;
+    size_t lastFrameLines;
+    bool repaintPending;
+    PerfCounters perf;          // before terminal: its writer thread reports here
+    TerminalWriter terminal;
+    EventBus events;
+    EventBus::Cursor scoringCursor;
+    GameLog log;
+    PerfHud hud;
+    bool hudVisible;
+    StrategyPlugin strategy;
+    std::vector<PacmanGhostView> strategyGhosts;
+    std::vector<uint8_t> strategyMoves;
+    int strategyTick;              // tick strategyMoves were decided for, -1 if none
+    bool swarm;                    // setSwarm: ghosts move along shared flow fields
+    WorkStealingPool* flowPool;    // builds stale fields side by side; null builds them here
+    std::vector<FlowField> flowFields;
+    int flowSlots[FLOW_SLOTS];     // flowFields index each rule follows this tick, -1 for none
+    int flowTick;                  // tick flowSlots were worked out for, -1 if none
+    uint64_t flowBuilds;
+    std::chrono::steady_clock::duration flowTime;
+    std::string savePath;          // empty: no saves, and no per-tick save image
+    SaveImage saveImages[2];       // the tick loop encodes into one while the other stays readable
+    std::atomic<int> publishedSave;   // saveImages index a signal handler may write out, -1 if none
+    GameSnapshot resumeState;
+    bool resumePending;            // start() plays resumeState instead of showing the title screen
+    std::string levelPath;         // --level-file, played as LevelData::FILE_LEVEL
+    LevelWatcher levelWatcher;
     
     std::atomic<bool> gameRunning;
-    std::mutex gameMutex; 
+    std::atomic<bool> rewinding;
+    std::atomic<bool> paused;
+    std::mutex pauseMutex;
+    std::condition_variable pauseSignal;   // ghost threads sleep here while paused
+    InstrumentedMutex gameMutex;
     std::thread pacmanThread;
     std::vector<std::thread> ghostThreads;
     
-    void initializeGame(int level);
+    void initializeGame(int level, uint64_t gameSeed);
     void runGameLoop();
-    void displayGame();
     void handleGameEnd();
     void resetGame();
+    void resetActors();
     int showTitleScreen();
     void showWinScreen();
     void showGameOverScreen();
+    void startRecording();
+    void stopRecording();
+    bool rewindStep();
+    void resumeFromRewind();
+    void toggleHud();
+    void applyEvents();
+    void sendGhostHome(int y, int x);
+    void pauseGame();
+    void composeFrame();
+    void appendCell(std::string& row, char cellChar) const;
+    void decideGhosts();
+    void publishSave();
+    void reloadLevelFile();
+    void buildRoutes();
+    void updateFlowFields();
+    bool chaseAlongFlow(size_t index);
     
 public:
+    static const int TICK_MS = 150;         // Pacman step / frame period
+    static const int GHOST_STEP_MS = 250;   // ghost step period
+
     Game();
     ~Game();
     void start();
     void stop();
     bool isRunning() const;
+    void displayGame();
+    void flushOutput() { terminal.drain(); }   // wait for queued frames before other output
+    void buildFrame(std::vector<std::string>& lines) const;
+    bool startBroadcast(const std::string& socketPath) { return spectators.start(socketPath); }
+    bool startLog(const std::string& path) { return log.open(path); }
+    bool loadStrategy(const std::string& path, std::string& error);
+    // Offer a level file on the title screen and reload it between ticks
+    // whenever it is saved
+    bool watchLevelFile(const std::string& path, std::string& error);
+    bool recordTo(const std::string& path);   // start a replay of the current game
+    // Stress mode: 'count' ghosts instead of the classic four, the ones past
+    // the level's spawns scattered over its floor. Once per tick, every
+    // ghost rule's target gets a flow field shared by all the ghosts
+    // following that rule, so each ghost's move is one lookup. Fields are
+    // only rebuilt when their target moves, on 'pool' if there is one.
+    // Call before loadStrategy and newGame.
+    void setSwarm(size_t count, WorkStealingPool* pool);
+
+    // Saves, off until setSavePath gives a path (only the interactive game
+    // does). Then every tick is encoded into memory; 'k' writes it to savePath
+    // and writeLastSave() does the same from a signal handler (no locks, no
+    // allocation). A --level-file layout is encoded once per level, not per tick.
+    bool saveGame();
+    bool writeLastSave() const;
+    bool loadSave(const std::string& path, std::string& error);   // next start() resumes it
+
+    // Simulation steps. Each is one critical section of the live game; the
+    // replay recorder logs them in order and the replay player re-runs them.
+    void newGame(int level, uint64_t gameSeed);
+    void tickPacman();
+    void applyInput(char input);
+    void stepGhost(size_t index);
+    // One tick of the interactive loop, under the game lock: a pending level
+    // file reload, the Pacman step and its frame, rewind capture, save publish
+    void playTick();
+    void enableRewind();   // sizes the rewind history; start() calls it
+
+    // Simulation code reports what happened here; Game applies scoring at the
+    // end of the step and other subscribers drain the bus on their own time
+    void emit(GameEventType type, int y, int x, char entity = 0);
+    const EventBus& getEventBus() const { return events; }
+    bool isOver() const { return lives <= 0 || dotsEaten >= maxDots; }
 
+    void captureSnapshot(GameSnapshot& snapshot) const;
+    void restoreSnapshot(const GameSnapshot& snapshot);
     
     // Getters for game state
     int getScore() const { return score; }
     int getLives() const { return lives; }
     int getDotsEaten() const { return dotsEaten; }
     int getMaxDots() const { return maxDots; }
+    int getTime() const { return time; }
+    int getLevel() const { return gameMap.getCurrentLevel(); }
+    size_t getMapOwnedBytes() const { return gameMap.getOwnedBytes(); }
+    uint64_t getSeed() const { return seed; }
+    size_t getGhostCount() const { return ghosts.size(); }
+    const Map& getMap() const { return gameMap; }
+    const Pacman& getPacman() const { return pacman; }
+    const Ghost& getGhost(size_t index) const { return ghosts[index]; }
+    HierarchicalPathfinder* getRoutes() { return routes.get(); }
+    uint64_t getFlowBuilds() const { return flowBuilds; }
+    std::chrono::steady_clock::duration getFlowTime() const { return flowTime; }   // wall time of the builds
     bool isSuperMode() const { return superMode; }
-    std::string getMessage() const { return message; }
+    GhostMode getGhostMode() const;
+    bool isHeadless() const { return headless; }
+    MessageId getMessage() const { return message; }
+    const char* getMessageText() const { return messageText(message); }
     
     // Setters for game state
     void setScore(int s) { score = s; }
     void setLives(int l) { lives = l; }
     void setSuperMode(bool sm) { superMode = sm; }
-    void setMessage(const std::string& msg) { message = msg; }
-    void incrementDotsEaten() { dotsEaten++; }
-    void incrementScore() { score++; }
-    void decrementLives() { lives--; }
+    void setMessage(MessageId msg) { message = msg; }
+    void setHeadless(bool h) { headless = h; }
+    void setReplayDirectory(const std::string& dir) { replayDirectory = dir; }
+    void setSavePath(const std::string& path) { savePath = path; }
+    int randomInt(int n) { return rng.nextInt(n); }
 };
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One fixed-size binary log record. Written as 16 little-endian bytes.
+struct LogRecord {
+    uint32_t tick;
+    int32_t score;
+    uint8_t type;       // GameEventType
+    char entity;
+    uint8_t y;
+    uint8_t x;
+    uint8_t lives;
+    uint8_t level;
+    uint16_t reserved;
+
+    static const size_t SIZE = 16;
+    void encode(uint8_t* out) const;
+    static LogRecord decode(const uint8_t* in);
+};
+
+// Low-overhead diagnostics log. The game thread copies records into a
+// single-producer ring and never waits or formats anything; a background
+// thread flushes them in batches to a size-rotated binary file
+// (path, path.1, ... path.N). If the disk can't keep up the ring fills and
+// new records are dropped and counted rather than buffered without bound.
+// Decoding is left to the pacman-logdump tool.
+class GameLog {
+public:
+    static const size_t RING_CAPACITY = 4096;           // records, power of two
+    static const int FLUSH_MS = 200;
+    static const uint64_t DEFAULT_ROTATE_BYTES = 4 << 20;
+    static const int DEFAULT_KEEP_FILES = 3;
+
+    GameLog();
+    ~GameLog();
+
+    bool open(const std::string& path, uint64_t rotateBytes = DEFAULT_ROTATE_BYTES,
+              int keepFiles = DEFAULT_KEEP_FILES);
+    void close();
+    bool isOpen() const { return opened; }
+
+    // Producer side: one thread at a time (the game lock holder)
+    void append(const LogRecord& record);
+
+    uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t getWritten() const { return written.load(std::memory_order_relaxed); }
+
+    // File header; the dump tool checks it
+    static const char MAGIC[4];
+    static const uint8_t VERSION = 1;
+    static bool readHeader(FILE* in);
+
+private:
+    void flushLoop();
+    size_t drainBatch();
+    bool writeBatch(size_t bytes);
+    bool openFile();
+    void rotate();
+
+    LogRecord ring[RING_CAPACITY];
+    std::atomic<uint64_t> head;      // next record the producer writes
+    std::atomic<uint64_t> tail;      // next record the flusher reads
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+
+    bool opened;                     // changed only by open()/close()
+    std::string path;
+    FILE* file;                      // flusher-owned while open
+    uint64_t fileBytes;
+    uint64_t rotateBytes;
+    int keepFiles;
+    std::vector<uint8_t> batch;      // flusher-only encode buffer
+
+    bool stopping;
+    std::mutex stopMutex;
+    std::condition_variable stopSignal;
+    std::thread flusher;
+};
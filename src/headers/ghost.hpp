@@ -4,6 +4,8 @@
 #include <string>
 #include "game_forward.hpp"
 
+class HierarchicalPathfinder;
+
 enum class GhostType {
     BLINKY,  // Red - M
     PINKY,   // Pink - W
@@ -18,6 +20,32 @@ enum class Direction {
     LEFT = 4
 };
 
+// Scatter and chase alternate on Game's wave timer; a super pellet
+// frightens the ghosts until super mode ends
+enum class GhostMode {
+    SCATTER,    // head for the ghost's own corner
+    CHASE,      // each ghost's classic rule
+    FRIGHTENED  // run for the corner farthest from Pacman
+};
+
+// What a ghost's target is computed from. The cached target is keyed by
+// only the fields the current rule reads (see relevantPart), so it is
+// recomputed when one of those changes and reused otherwise.
+struct GhostTargetKey {
+    int pacmanY, pacmanX;
+    char pacmanDirection;
+    GhostMode mode;
+    int otherY, otherX;   // Inky: Blinky's cell; unused (-1) for the others
+    bool near;            // Clyde: within CLYDE_SHY_DISTANCE of Pacman
+    int mapHeight, mapWidth;
+
+    bool operator==(const GhostTargetKey& o) const {
+        return pacmanY == o.pacmanY && pacmanX == o.pacmanX && pacmanDirection == o.pacmanDirection &&
+               mode == o.mode && otherY == o.otherY && otherX == o.otherX && near == o.near &&
+               mapHeight == o.mapHeight && mapWidth == o.mapWidth;
+    }
+};
+
 class Ghost {
 private:
     int posY, posX;
@@ -26,34 +54,45 @@ private:
     Direction direction;
     int speed; // Delay in milliseconds
     bool alive;
+    char under;                 // map cell the ghost's glyph covers, put back when it leaves
+    int targetY, targetX;       // cached target, valid for targetKey
+    GhostTargetKey targetKey;
+    bool targetValid;
     
     // AI behavior
     void changeDirection(int targetY, int targetX, int currentY, int currentX, Map& map, Game& game);
+    bool followRoute(HierarchicalPathfinder& routes, int targetY, int targetX, Map& map);
     bool canMove(char nextChar, Map& map);
     void moveTowardsTarget(int targetY, int targetX, Map& map, Game& game);
     void randomMove(Map& map, Game& game);
     
 public:
+    static const int CLYDE_SHY_DISTANCE = 8;   // cells; closer than this Clyde scatters
+
     Ghost();
     Ghost(GhostType t, int y, int x, int spd);
 
     char getChar() const;
     
     // Movement and AI
-    void update(int pacmanY, int pacmanX, Map& map, Game& game);
+    void update(const Pacman& pacman, Map& map, Game& game);
     void move(Map& map, Game& game);
+    void steer(Direction dir, Map& map, Game& game);   // move in a direction chosen elsewhere
     
     // Getters
     int getY() const { return posY; }
     int getX() const { return posX; }
     char getCharacter() const { return character; }
     GhostType getType() const { return type; }
+    Direction getDirection() const { return direction; }
     bool isAlive() const { return alive; }
+    char getUnder() const { return under; }
     
     // Setters
     void setPosition(int y, int x);
     void setDirection(Direction dir);
     void setAlive(bool a) { alive = a; }
+    void setUnder(char cell) { under = cell; }
     
     // Game logic
     void reset();
@@ -61,5 +100,7 @@ public:
     void respawn();
     
     // AI targeting
-    void setTarget(int& targetY, int& targetX, int pacmanY, int pacmanX, bool superMode);
+    void setTarget(int& y, int& x, const GhostTargetKey& key) const;
+    void scatterCorner(int& y, int& x, int mapHeight, int mapWidth) const;
+    GhostTargetKey relevantPart(const GhostTargetKey& key) const;
 };
@@ -0,0 +1,76 @@
+#pragma once
+
+// C ABI for ghost strategy plugins, loaded with --strategy PATH.
+//
+// A plugin is a shared library exporting PACMAN_STRATEGY_ENTRY, a function
+// returning a PacmanGhostStrategy. The game calls decide() once per tick with
+// a read-only view of the whole game and an output slot per ghost, rather
+// than once per ghost step, so the call overhead doesn't grow with the
+// number of ghosts. Everything in the view is owned by the game and only
+// valid during the call.
+//
+// Plain C types only, so a plugin can be built by any compiler (or in C):
+//   g++ -shared -fPIC -O2 -Isrc/headers my_strategy.cpp -o libmy_strategy.so
+
+#include <stdint.h>
+
+#define PACMAN_STRATEGY_ABI_VERSION 1
+#define PACMAN_STRATEGY_ENTRY "pacman_ghost_strategy"
+
+// Directions, as in Ghost's Direction enum; NONE leaves the ghost to the built-in AI
+#define PACMAN_DIR_NONE 0
+#define PACMAN_DIR_UP 1
+#define PACMAN_DIR_DOWN 2
+#define PACMAN_DIR_RIGHT 3
+#define PACMAN_DIR_LEFT 4
+
+// Bits of PacmanGameView::nav, as in LevelData::NavBits
+#define PACMAN_NAV_UP 1
+#define PACMAN_NAV_DOWN 2
+#define PACMAN_NAV_LEFT 4
+#define PACMAN_NAV_RIGHT 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PacmanGhostView {
+    int32_t y;
+    int32_t x;
+    uint8_t type;            // 0 Blinky, 1 Pinky, 2 Inky, 3 Clyde
+    uint8_t direction;       // PACMAN_DIR_*
+    uint8_t alive;
+    uint8_t reserved;
+} PacmanGhostView;
+
+typedef struct PacmanGameView {
+    uint32_t abiVersion;
+    uint32_t tick;
+    int32_t width;
+    int32_t height;
+    const char* const* rows;     // current map, one row per pointer: '#' wall, '.' dot, 'O' pellet,
+                                 // '[' ']' portals, plus the glyphs of actors standing there
+    const uint8_t* nav;          // row-major PACMAN_NAV_* bits: which neighbours are not walls
+    int32_t pacmanY;
+    int32_t pacmanX;
+    uint8_t pacmanDirection;     // PACMAN_DIR_*
+    uint8_t superMode;           // ghosts are edible
+    uint8_t reserved[2];
+    uint32_t ghostCount;
+    const PacmanGhostView* ghosts;
+} PacmanGameView;
+
+typedef struct PacmanGhostStrategy {
+    uint32_t abiVersion;         // PACMAN_STRATEGY_ABI_VERSION the plugin was built against
+    const char* name;
+    void* (*create)(void);
+    void (*destroy)(void* state);
+    // Write one PACMAN_DIR_* per ghost into directions[0 .. view->ghostCount)
+    void (*decide)(void* state, const PacmanGameView* view, uint8_t* directions);
+} PacmanGhostStrategy;
+
+typedef const PacmanGhostStrategy* (*PacmanStrategyEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
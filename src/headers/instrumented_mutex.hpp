@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "trace.hpp"
+
+// Acquisition statistics for one place in the code that takes the mutex.
+// Wait and hold times are bucketed by powers of two microseconds.
+struct LockSite {
+    static const int BUCKETS = 32;
+
+    explicit LockSite(const std::string& siteName);
+    void reset();
+
+    std::string name;
+    std::string waitLabel;    // trace event names, kept alive for TraceScope
+    std::string holdLabel;
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;
+    std::atomic<uint64_t> waitNs;
+    std::atomic<uint64_t> holdNs;
+    std::atomic<uint64_t> maxWaitNs;
+    std::atomic<uint64_t> maxHoldNs;
+    std::atomic<uint64_t> waitBuckets[BUCKETS];
+    std::atomic<uint64_t> holdBuckets[BUCKETS];
+};
+
+// std::mutex that keeps running totals of how often it was taken, how often
+// the caller had to wait, and for how long. Uncontended locks only pay for a
+// try_lock; the clock is read only when the lock is actually contended.
+// Taking it through InstrumentedLock also attributes wait and hold time to a
+// LockSite, for the contention report.
+class InstrumentedMutex {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit InstrumentedMutex(const std::string& name = "mutex");
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    // Finds or registers a call site. Look sites up once per thread, not per lock.
+    LockSite& site(const std::string& name);
+    void resetSites();
+    void printReport(std::ostream& out) const;
+
+    uint64_t getAcquisitions() const { return acquisitions.load(std::memory_order_relaxed); }
+    uint64_t getContended() const { return contended.load(std::memory_order_relaxed); }
+    uint64_t getWaitNs() const { return waitNs.load(std::memory_order_relaxed); }
+
+private:
+    friend class InstrumentedLock;
+    uint64_t lockTimed();    // returns nanoseconds spent waiting
+
+    std::string name;
+    std::mutex mutex;
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;
+    std::atomic<uint64_t> waitNs;
+
+    mutable std::mutex sitesMutex;
+    std::vector<std::unique_ptr<LockSite> > sites;
+};
+
+// lock_guard for InstrumentedMutex that records wait and hold time against a
+// site (and as trace events in PACMAN_TRACE builds)
+class InstrumentedLock {
+public:
+    InstrumentedLock(InstrumentedMutex& mutex, LockSite& site);
+    ~InstrumentedLock();
+
+    InstrumentedLock(const InstrumentedLock&) = delete;
+    InstrumentedLock& operator=(const InstrumentedLock&) = delete;
+
+private:
+    InstrumentedMutex::Clock::time_point acquire();
+
+    InstrumentedMutex& mutex;
+    LockSite& site;
+    InstrumentedMutex::Clock::time_point acquired;
+#ifdef PACMAN_TRACE
+    TraceScope holdScope;
+#endif
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// Entry point for `--io-bench FRAMES`: writes FRAMES rendered frames to 1, 8
+// and 64 pipes with each IoBackend and reports system calls and CPU per frame
+int runIoBenchmark(int frames);
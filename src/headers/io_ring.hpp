@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// How terminal frames and spectator streams reach their file descriptors
+enum class IoBackend {
+    WRITE,    // write(2)/send(2), poll(2) when the fd is full
+    URING     // batched through an IoRing; falls back to WRITE where io_uring is unavailable
+};
+
+void setIoBackend(IoBackend backend);
+IoBackend getIoBackend();
+const char* ioBackendName(IoBackend backend);
+bool parseIoBackend(const std::string& name, IoBackend& backend);
+
+// A small io_uring on the raw system calls (no liburing). Writes are queued
+// and then submitted and waited for together with a single io_uring_enter,
+// so N file descriptors cost one system call instead of N. Buffers
+// registered up front are written with WRITE_FIXED, which spares the kernel
+// pinning the pages on every write. One thread at a time.
+class IoRing {
+public:
+    struct Completion {
+        uint64_t tag;
+        int result;      // bytes written, or -errno
+    };
+
+    IoRing();
+    ~IoRing();
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    bool open(unsigned entries, std::string& error);
+    void close();
+    bool isOpen() const { return ringFd >= 0; }
+
+    // 'count' registered buffers of 'bytes' each
+    bool registerBuffers(size_t count, size_t bytes, std::string& error);
+    uint8_t* buffer(size_t index) { return &buffers[index * bufferBytes]; }
+    size_t bufferSize() const { return bufferBytes; }
+
+    // False when the submission queue is full: submit first
+    bool queueWrite(int fd, size_t bufferIndex, size_t offset, size_t length, uint64_t tag);
+    bool queueSend(int fd, const void* data, size_t length, uint64_t tag);   // MSG_NOSIGNAL
+
+    // Submits everything queued and waits for all of it. False if the ring
+    // failed; the operations are then lost and the caller should fall back.
+    bool submitAndWait(std::vector<Completion>& completions);
+    uint64_t getEnterCalls() const { return enterCalls; }
+
+private:
+    int ringFd;
+    void* sqMap;
+    size_t sqMapBytes;
+    void* cqMap;
+    size_t cqMapBytes;
+    io_uring_sqe* sqes;
+    size_t sqesBytes;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned sqEntries;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    io_uring_cqe* cqes;
+    unsigned localTail;        // SQ tail including entries not yet published
+    unsigned inFlight;
+    std::vector<uint8_t> buffers;
+    size_t bufferBytes;
+    uint64_t enterCalls;
+
+    io_uring_sqe* nextSqe();
+};
+
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ByteReader;
+
+// Static, read-only description of one level. Built once per level id and
+// shared by every Map (and so every Game/session) playing that level; nothing
+// in here changes during play.
+class LevelData {
+public:
+    enum Terrain : uint8_t {
+        FLOOR = 0,
+        WALL = 1,
+        PORTAL = 2
+    };
+
+    // Bits of the per-cell navigation mask: which neighbours can be entered
+    enum NavBits : uint8_t {
+        NAV_UP = 1,
+        NAV_DOWN = 2,
+        NAV_LEFT = 4,
+        NAV_RIGHT = 8
+    };
+
+    struct Spawn {
+        int y;
+        int x;
+    };
+
+    // Cells [top, bottom] x [left, right] that differ between two builds of a level
+    struct Region {
+        int top;
+        int left;
+        int bottom;
+        int right;
+        bool empty() const { return bottom < top; }
+    };
+
+    static const int FILE_LEVEL = 3;    // id a --level-file level is played as
+    static const int MAX_SIDE = 255;    // events store cell coordinates in a byte
+    static const int MAX_GHOST_SPAWNS = 255;   // write() stores the count in a byte
+
+    // Shared instance for a built-in level id, or nullptr if there is none
+    static std::shared_ptr<const LevelData> acquire(int id);
+
+    // Cells Pacman has to eat to clear a level: dots and pellets
+    static bool countsTowardClear(char c) { return c == '.' || c == 'O'; }
+
+    // Build from text rows ('#' wall, '.' dot, 'O' pellet, '[' ']' portals,
+    // '<' Pacman start, anything else floor). maxDots < 0 means "count the
+    // cells that count toward clearing".
+    static std::shared_ptr<const LevelData> fromRows(int id, const std::vector<std::string>& rows,
+                                                     int maxDots, const std::vector<Spawn>& ghostSpawns);
+
+    // Read a level file: the rows fromRows takes, with 'G' marking each ghost
+    // spawn (the built-in ghost house if there is none). If 'previous' has the
+    // same size, only the cells that differ from it are re-derived and
+    // 'changed' bounds them; otherwise the level is built from scratch and
+    // 'changed' covers the grid. Returns nullptr and sets 'error' if the file
+    // can't be used.
+    static std::shared_ptr<const LevelData> fromFile(int id, const std::string& path, const LevelData* previous,
+                                                     Region& changed, std::string& error);
+
+    // Make 'level' what acquire() returns for its id from now on
+    static void install(const std::shared_ptr<const LevelData>& level);
+
+    // Size, initial cells and ghost spawns: everything a level that is not
+    // built in needs to travel inside a save or replay. read() returns
+    // 'reuse' instead of a new build when the layouts are the same, and
+    // nullptr if the bytes don't describe a playable level.
+    void write(std::vector<uint8_t>& out) const;
+    static std::shared_ptr<const LevelData> read(int id, ByteReader& in,
+                                                 const std::shared_ptr<const LevelData>& reuse);
+
+    int getId() const { return id; }
+    int getHeight() const { return height; }
+    int getWidth() const { return width; }
+    int getMaxDots() const { return maxDots; }
+    bool contains(int y, int x) const { return y >= 0 && y < height && x >= 0 && x < width; }
+
+    // Initial contents of the mutable layer (dots, pellets, Pacman glyph), row-major
+    const char* initialRow(int y) const { return &initialCells[static_cast<size_t>(y) * width]; }
+    Terrain terrainAt(int y, int x) const { return static_cast<Terrain>(terrain[index(y, x)]); }
+    uint8_t navAt(int y, int x) const { return nav[index(y, x)]; }
+    const uint8_t* navData() const { return nav.data(); }
+
+    // The floor cell nearest (y, x), which may be off the grid; -1 if there is
+    // none. findNearest runs the same search over any row-major grid for a
+    // cell holding 'value'.
+    int nearestFloor(int y, int x) const { return findNearest(terrain.data(), height, width, FLOOR, y, x); }
+    static int findNearest(const uint8_t* cells, int height, int width, uint8_t value, int y, int x);
+
+    // Where a portal sends you; returns false for non-portal cells
+    bool portalExit(int y, int x, int& exitY, int& exitX) const;
+
+    const Spawn& getPacmanSpawn() const { return pacmanSpawn; }
+    const std::vector<Spawn>& getGhostSpawns() const { return ghostSpawns; }
+
+    size_t memoryBytes() const;
+
+private:
+    int id;
+    int height;
+    int width;
+    int maxDots;
+    std::vector<char> initialCells;
+    std::vector<uint8_t> terrain;
+    std::vector<uint8_t> nav;
+    std::vector<int> portalTarget;   // target cell index per cell, -1 if not a portal
+    Spawn pacmanSpawn;
+    std::vector<Spawn> ghostSpawns;
+
+    LevelData();
+    size_t index(int y, int x) const { return static_cast<size_t>(y) * width + x; }
+    void deriveNav(int y, int x);
+    void pairPortals(int y);
+    void patch(const std::vector<std::string>& rows, Region& changed);
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+// Watches one level file with inotify. The directory is watched rather than
+// the file, because most editors save by writing a new file and renaming it
+// over the old one, which would end a watch on the file itself.
+class LevelWatcher {
+public:
+    LevelWatcher();
+    ~LevelWatcher();
+    LevelWatcher(const LevelWatcher&) = delete;
+    LevelWatcher& operator=(const LevelWatcher&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Never blocks. True if the file was saved since the last call; several
+    // saves in between count once.
+    bool changed();
+
+private:
+    int fd;
+    std::string name;    // file name inside the watched directory
+};
@@ -1,33 +1,47 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
+#include "level.hpp"
 
+// Per-game view of a level. Walls, portals, spawns and navigation live in the
+// shared, immutable LevelData; the Map itself only owns the cells that have
+// changed (eaten dots/pellets and actor glyphs). Each row points into the
+// level's initial grid until it is first written, and is copied then into
+// a backing block sized at level start, so ticks never allocate.
 class Map {
 private:
-    static const int MAP_HEIGHT = 21;
-    static const int MAP_WIDTH = 28;
-    
-    char level[MAP_HEIGHT][MAP_WIDTH];
-    int maxDots;
+    std::shared_ptr<const LevelData> levelData;
+    std::vector<const char*> rows;                 // current contents of each row
+    std::vector<char> ownedCells;                  // row slots for private copies, kept across levels
     int currentLevel;
     
-    // Predefined maps
-    void loadLevel1();
-    void loadLevel2();
+    char* writableRow(int y);
+    void resetRows();
     
 public:
     Map();
     Map(int level);
+    Map(const Map&) = delete;
+    Map& operator=(const Map&) = delete;
     
     // Map management
     void loadLevel(int level);
+    void loadLevel(const std::shared_ptr<const LevelData>& data);   // e.g. one carried by a snapshot
+    // Switch to a new build of the current level of the same size. Cells
+    // inside 'changed' whose layout differs take the new layout; every other
+    // cell keeps its state (eaten dots stay eaten). Returns how many more
+    // dots and pellets are left on the map than before.
+    int reloadLevel(const std::shared_ptr<const LevelData>& data, const LevelData::Region& changed);
     void reset();
     char getCell(int y, int x) const;
+    const char* getRow(int y) const { return rows[y]; }
+    const char* const* getRows() const { return rows.data(); }
     void setCell(int y, int x, char c);
     bool isValidPosition(int y, int x) const;
-    std::string renderCell(int y, int x) const;
+    const char* renderCell(int y, int x) const;   // static text, never allocates
 
     // Game logic
     bool isWall(int y, int x) const;
@@ -41,10 +55,15 @@ public:
     void handlePortal(int& y, int& x) const;
     
     // Getters
-    int getHeight() const { return MAP_HEIGHT; }
-    int getWidth() const { return MAP_WIDTH; }
-    int getMaxDots() const { return maxDots; }
+    int getHeight() const { return levelData->getHeight(); }
+    int getWidth() const { return levelData->getWidth(); }
+    int getMaxDots() const { return levelData->getMaxDots(); }
     int getCurrentLevel() const { return currentLevel; }
+    const LevelData& getLevelData() const { return *levelData; }
+    std::shared_ptr<const LevelData> shareLevelData() const { return levelData; }
+    
+    // Bytes of map state owned by this game rather than shared with others
+    size_t getOwnedBytes() const;
     
     // Display
     void display() const;
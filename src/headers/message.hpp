@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Status-line messages are interned: game state holds a small ID and the text
+// lives in a static table, so changing the message never copies a string.
+enum class MessageId : uint8_t {
+    ROUND_START,
+    SUPER_MODE_ON,
+    SUPER_MODE_OVER,
+    PACMAN_EATEN,
+    GHOST_EATEN,
+    GAME_SAVED,
+    SAVE_FAILED,
+    LEVEL_RELOADED,
+    LEVEL_RELOAD_FAILED,
+    COUNT
+};
+
+const char* messageText(MessageId id);
+
+// Reverse lookup for saved/recorded text; false if the text is not a known message
+bool messageFromText(const std::string& text, MessageId& id);
@@ -11,8 +11,8 @@ private:
     char character; // Current character representation
     bool alive;
     
-    bool canMove(char nextChar, Map& map, Game& game);
-    void handleCollision(char nextChar, Map& map, Game& game);
+    bool canMove(char nextChar, int y, int x, Map& map, Game& game);
+    void handleCollision(char nextChar, int y, int x, Map& map, Game& game);
     void resetPosition();
     
 public:
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "level.hpp"
+
+// HPA*-style pathfinder for large mazes. The grid is cut into square clusters;
+// each walkable run along a cluster border gets one or two transition cells,
+// and the transition cells inside a cluster are joined by their in-cluster
+// distance. Every transition cell also keeps its distance to each cell of its
+// cluster, so a query links its ends to the graph and walks the route cell by
+// cell with table lookups instead of a BFS. Routes are cached per (source
+// cluster, target cluster), and changing a cell rebuilds only the clusters
+// around it.
+//
+// A query expands at most SEARCH_BUDGET abstract nodes. Past that, nextStep
+// heads for the node it reached closest to the target; findPath carries on
+// from there until it arrives. Mazes up to the game's MAX_SIDE stay well
+// inside the budget, so their routes are always complete.
+//
+// Cells are row-major indices (y * width + x). Portals count as walls, as they
+// do for the game's ghosts. Routes are near-optimal, not exact.
+class HierarchicalPathfinder {
+public:
+    static const int DEFAULT_CLUSTER_SIZE = 16;
+    static const int MIN_LEVEL_CELLS = 64 * 64;   // smaller levels are left to the greedy turn
+
+    explicit HierarchicalPathfinder(const LevelData& level, int clusterSize = DEFAULT_CLUSTER_SIZE);
+
+    // Whether the game routes ghosts and the autopilot through a pathfinder on this level
+    static bool suits(const LevelData& level);
+
+    // Cells from 'from' to 'to' inclusive; false if 'to' can't be reached
+    bool findPath(int from, int to, std::vector<int>& path);
+    // The first cell to step to on the way, or 'from' itself if there is none.
+    // Without the route cache the answer depends only on the terrain and the
+    // two cells, which is what replays and rewinds need.
+    int nextStep(int from, int to, bool useCache = true);
+    // The walkable cell nearest (y, x), which may be off the grid; -1 if there is none
+    int nearestWalkable(int y, int x) const;
+
+    void setWalkable(int y, int x, bool walkable);
+    bool isWalkable(int cell) const { return open[cell] != 0; }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getClusterSize() const { return clusterSize; }
+    size_t getNodeCount() const { return nodes.size() - freeNodes.size(); }
+    size_t getEdgeCount() const;
+    uint64_t getCacheHits() const { return cacheHits; }
+    uint64_t getCacheMisses() const { return cacheMisses; }
+    uint64_t getCutShort() const { return cutShort; }    // searches that hit SEARCH_BUDGET
+    size_t getTableBytes() const;
+
+private:
+    static const size_t ROUTE_CACHE_LIMIT = 4096;
+    static const int HEURISTIC_PERCENT = 150;       // routes at most 1.5x the shortest
+    static const int SEARCH_BUDGET = 2048;          // abstract nodes one query may expand
+    static const uint16_t UNREACHED = 0xFFFF;
+
+    struct Edge {
+        int32_t to;
+        int32_t cost;
+        bool inter;       // crosses a cluster border (cost 1)
+    };
+    struct Node {
+        int32_t cell;
+        int32_t refs;     // transitions using this cell; 0 = free slot
+        std::vector<Edge> edges;
+        std::vector<uint16_t> dist;   // in-cluster distance to each cell of the cluster
+    };
+    struct Route {
+        std::vector<int32_t> nodes;
+        bool complete;    // ends in the target's cluster; otherwise cut short by the budget
+    };
+    struct Transition {
+        int32_t a;
+        int32_t b;
+    };
+
+    int width;
+    int height;
+    int clusterSize;
+    int clustersX;
+    int clustersY;
+    std::vector<uint8_t> open;
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    std::vector<int32_t> nodeAt;                           // node id on each cell, -1 if none
+    std::vector<std::vector<int32_t> > clusterNodes;
+    std::vector<std::vector<Transition> > eastBorders;     // cluster c and c + 1
+    std::vector<std::vector<Transition> > southBorders;    // cluster c and c + clustersX
+
+    std::unordered_map<uint64_t, Route> routeCache;
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    uint64_t cutShort;
+
+    // Search scratch, stamped so nothing is cleared between searches
+    std::vector<uint32_t> cellStamp;
+    std::vector<int32_t> cellDist;
+    std::vector<int32_t> cellParent;
+    std::vector<int32_t> cellQueue;
+    uint32_t bfsStamp;
+    std::vector<uint32_t> nodeStamp;
+    std::vector<int32_t> nodeCost;
+    std::vector<int32_t> nodeParent;
+    uint32_t searchStamp;
+    std::vector<std::pair<int64_t, int32_t> > heap;
+    std::vector<std::pair<int32_t, int32_t> > goalLinks;   // node, distance on to the target
+    std::vector<int> stepPath;
+    std::vector<int> chunk;
+    Route scratchRoute;
+
+    int clusterOf(int cell) const;
+    void clusterBounds(int cluster, int& y0, int& x0, int& y1, int& x1) const;
+    int localIndex(int cell) const;
+    bool reached(int cell) const { return cellStamp[cell] == bfsStamp; }
+    int estimate(int from, int to) const;
+
+    int acquireNode(int cell);
+    void releaseNode(int id);
+    void removeEdge(int from, int to, bool inter);
+    void buildBorder(int cluster, bool east);
+    void clearBorder(int cluster, bool east);
+    void buildIntraEdges(int cluster);
+
+    void clusterBfs(int cluster, int source, int stopAt);
+    bool walkToNode(int cell, int id, std::vector<int>& path) const;
+    bool route(int from, int to, Route& result, bool bounded);
+    bool refine(int from, int to, const Route& route, std::vector<int>& path, size_t segments);
+    bool search(int from, int to, std::vector<int>& path, size_t segments, bool bounded, bool useCache);
+};
+
+// Entry point for `--paths`: build, query and update a generated size x size maze
+int runPathBenchmark(int size, int queries);
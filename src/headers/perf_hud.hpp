@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "event_bus.hpp"
+#include "instrumented_mutex.hpp"
+#include "terminal_writer.hpp"
+
+// Counters bumped from the tick, render and input paths. Every update is a
+// relaxed atomic add so the hot paths never lock or format anything.
+class PerfCounters {
+public:
+    static const int LATENCY_BUCKETS = 32;   // powers of two microseconds
+
+    PerfCounters();
+
+    void tick() { ticks.fetch_add(1, std::memory_order_relaxed); }
+    void frameBuilt(int64_t buildNs);
+    void inputReceived();                    // key read, effect not on screen yet
+    void frameShown();                       // a frame reached the terminal
+
+    uint64_t getTicks() const { return ticks.load(std::memory_order_relaxed); }
+    uint64_t getFrames() const { return frames.load(std::memory_order_relaxed); }
+    uint64_t getFrameBuildNs() const { return frameBuildNs.load(std::memory_order_relaxed); }
+    uint64_t getLatencyBucket(int i) const { return latencyBuckets[i].load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> frameBuildNs;
+    std::atomic<int64_t> pendingInputNs;     // steady_clock time of the oldest unseen key, 0 if none
+    std::atomic<uint64_t> latencyBuckets[LATENCY_BUCKETS];
+};
+
+// Samples the counters twice a second on its own thread, smooths the rates and
+// formats the HUD line. The render path only copies the last published line.
+class PerfHud {
+public:
+    static const int SAMPLE_MS = 500;
+    static const size_t LINE_SIZE = 160;
+
+    PerfHud();
+    ~PerfHud();
+
+    void start(const PerfCounters& counters, const TerminalWriter& writer, const InstrumentedMutex& mutex,
+               const EventBus& events);
+    void stop();
+    bool isRunning() const { return running; }
+    void appendLine(std::string& out) const;
+
+private:
+    struct Sample {
+        uint64_t ticks;
+        uint64_t frames;
+        uint64_t frameBuildNs;
+        uint64_t bytes;
+        uint64_t writes;
+        uint64_t waitNs;
+        uint64_t dropped;
+        uint64_t shown;      // frames that reached the terminal
+        uint64_t latency[PerfCounters::LATENCY_BUCKETS];
+    };
+
+    void samplerLoop();
+    void takeSample(Sample& sample) const;
+
+    const PerfCounters* counters;
+    const TerminalWriter* writer;
+    const InstrumentedMutex* mutex;
+    const EventBus* events;
+    EventBus::Cursor eventCursor;    // the HUD is an event-bus subscriber like any other
+
+    // Two line buffers: the sampler fills the one readers aren't pointed at
+    // and then flips the index. Readers finish long before the next flip.
+    char lines[2][LINE_SIZE];
+    std::atomic<int> published;
+
+    bool running;
+    bool stopping;
+    std::mutex stopMutex;
+    std::condition_variable stopSignal;
+    std::thread sampler;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "snapshot.hpp"
+#include "game_forward.hpp"
+
+// Replay file layout (integers little-endian, "varint" = LEB128):
+//   header   "PMRP", u8 version, varint level, u64 seed, varint ghostCount,
+//            varint keyframeInterval
+//   ops      varint (payload << 2 | kind), one per game step:
+//              TICKS    payload = run length of consecutive Pacman ticks
+//              GHOST    payload = index of the ghost that stepped
+//              INPUT    payload = key handed to Pacman::move
+//              KEYFRAME payload = size of the serialized GameSnapshot that follows
+//   index    per periodic keyframe: u32 tick, u64 file offset of its op
+//   trailer  u32 keyframeCount, u32 ticksRecorded, u64 indexOffset, "PMRI"
+// The ops are the game's critical sections in the order they took gameMutex,
+// so running them again from the same seed reproduces the game exactly.
+// Ticks in the index count recorded Pacman ticks, which keep increasing even
+// when a rewind moves the game clock back. A rewind is recorded as an extra,
+// unindexed keyframe; the player restores every keyframe it passes. A
+// --level-file level has no built-in data, so each keyframe of such a game
+// carries the layout (GameSnapshot::layout), including the one after a reload.
+enum class ReplayOp : uint8_t {
+    TICKS = 0,
+    GHOST = 1,
+    INPUT = 2,
+    KEYFRAME = 3
+};
+
+struct ReplayKeyframe {
+    uint32_t tick;
+    uint64_t offset;
+};
+
+// Streams a game to disk. The record* calls run inside the tick path and only
+// append a few bytes to a memory buffer; full buffers are handed to a
+// background thread that does the actual file writes.
+class ReplayRecorder {
+public:
+    static const int KEYFRAME_INTERVAL = 64;   // ticks between full-state keyframes
+
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    bool open(const std::string& path, int level, uint64_t seed, size_t ghostCount);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    const std::string& getPath() const { return path; }
+
+    void recordTick();
+    void recordGhost(size_t index);
+    void recordInput(char input);
+    void recordKeyframe(const GameSnapshot& snapshot, bool indexed);
+    uint32_t getTicksRecorded() const { return ticksRecorded; }
+
+private:
+    static const size_t FLUSH_THRESHOLD = 4096;
+
+    FILE* file;
+    std::string path;
+    std::vector<uint8_t> active;     // filled by the game thread
+    std::vector<uint8_t> pending;    // handed over to the writer thread
+    std::vector<uint8_t> scratch;    // keyframe serialization buffer
+    uint64_t flushedBytes;           // bytes already moved out of 'active'
+    uint32_t tickRun;                // Pacman ticks not yet emitted
+    uint32_t ticksRecorded;
+    std::vector<ReplayKeyframe> keyframes;
+
+    std::mutex writerMutex;
+    std::condition_variable writerCv;
+    std::thread writer;
+    bool closing;
+
+    void putOp(ReplayOp op, uint64_t payload);
+    void flushTickRun();
+    void submit();
+    void writerLoop();
+};
+
+// A replay file mapped into memory with its keyframe index.
+class ReplayFile {
+public:
+    int level;
+    uint64_t seed;
+    size_t ghostCount;
+    int keyframeInterval;
+    int finalTick;
+    std::vector<ReplayKeyframe> keyframes;
+
+    ReplayFile();
+    ~ReplayFile();
+    ReplayFile(const ReplayFile&) = delete;
+    ReplayFile& operator=(const ReplayFile&) = delete;
+
+    bool load(const std::string& path, std::string& error);
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+    size_t opsBegin() const { return opsStart; }
+    size_t opsEnd() const { return opsStop; }
+
+    // Index of the last keyframe at or before 'tick' (keyframes are evenly spaced)
+    size_t keyframeFor(int tick) const;
+
+private:
+    const uint8_t* bytes;      // read-only mapping of the whole file
+    size_t byteCount;
+    size_t opsStart;
+    size_t opsStop;
+
+    bool parseIndex();
+    void rebuildIndex();
+    void unmap();
+};
+
+// Re-simulates a recorded game through the same Game step functions the live
+// game uses, either headless as fast as possible or rendered at 1x/2x/8x.
+class ReplayPlayer {
+public:
+    explicit ReplayPlayer(Game& game);
+
+    bool load(const std::string& path, std::string& error);
+
+    // Jump to 'tick' by restoring the nearest keyframe and re-simulating the rest
+    bool seek(int tick);
+
+    // Execute the next recorded step; returns false at the end of the replay
+    bool step(ReplayOp& executed);
+
+    int playHeadless();
+    int playRendered(int speed);
+
+    const ReplayFile& getFile() const { return file; }
+    int getTick() const { return replayTick; }
+
+private:
+    Game& game;
+    ReplayFile file;
+    size_t cursor;
+    uint32_t ticksLeftInRun;
+    int replayTick;
+    GameSnapshot keyframe;
+
+    bool restoreKeyframeAt(size_t offset);
+};
+
+// Entry point for `--replay`; speed 0 means headless at maximum speed
+int runReplay(const std::string& path, int speed, int seekTick);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "game.hpp"
+#include "serialize.hpp"
+
+// Aggregates for one level over any number of replays. Every field is a sum
+// or a count, so merge() is associative and commutative: partial results from
+// different threads or runs combine in any order.
+struct LevelAnalytics {
+    static const int GHOST_TYPES = 4;           // one heatmap per GhostType
+    static const int CLEAR_BUCKET_TICKS = 100;
+    static const int CLEAR_BUCKETS = 64;        // the last bucket holds everything slower
+    static const uint32_t RANK_SCALE = 65536;   // dot order is stored as rank / maxDots * RANK_SCALE
+
+    int level;
+    int height;
+    int width;
+    uint64_t games;
+    uint64_t clears;
+    uint64_t ticks;
+    std::vector<uint64_t> pacmanVisits;                  // ticks Pacman ended on each cell
+    std::vector<uint64_t> ghostVisits[GHOST_TYPES];      // ticks each ghost type ended on each cell
+    std::vector<uint64_t> deaths;                        // cell of the ghost Pacman ran into
+    std::vector<uint64_t> clearRankSum;                  // per cell: summed order its dot was eaten in
+    std::vector<uint64_t> clearCount;                    // per cell: games its dot was eaten in
+    uint64_t clearTimes[CLEAR_BUCKETS];                  // ticks to clear the level
+
+    LevelAnalytics();
+    void reset(int levelId, int levelHeight, int levelWidth);
+    void merge(const LevelAnalytics& other);
+
+    // Upper edge (in ticks) of the bucket holding the p-th fastest clear, 0 if none
+    int clearTimePercentile(double p) const;
+
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(ByteReader& in);
+};
+
+// Per-level aggregates plus the replays already folded in, keyed by path with
+// size and mtime, so a later run only reads replays that are new.
+class ReplayAnalytics {
+public:
+    struct FileStamp {
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    // Re-simulates the replay on 'game' and adds what happened to the aggregates
+    bool addReplay(Game& game, const std::string& path, std::string& error);
+    void merge(const ReplayAnalytics& other);
+
+    bool save(const std::string& path) const;    // written to a temp file, then renamed
+    bool load(const std::string& path, std::string& error);
+    void writeJson(std::ostream& out) const;
+    void printReport(std::ostream& out) const;
+
+    bool hasSeen(const std::string& path) const { return seen.count(path) > 0; }
+    void markSeen(const std::string& path, const FileStamp& stamp) { seen[path] = stamp; }
+    size_t seenCount() const { return seen.size(); }
+    const std::map<int, LevelAnalytics>& getLevels() const { return levels; }
+
+private:
+    std::map<int, LevelAnalytics> levels;
+    std::map<std::string, FileStamp> seen;
+
+    LevelAnalytics& forLevel(int level, int height, int width);
+};
+
+// Entry point for `--analyze DIR`: folds every new *.pmr in DIR into
+// DIR/analytics.pma using 'threads' workers (0 = one per core), then prints a
+// report and writes DIR/analytics.json
+int runReplayAnalytics(const std::string& directory, size_t threads);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "snapshot.hpp"
+
+// Fixed-size history of recent game states for rewinding.
+//
+// Only the newest state is kept in full ('head'). Every capture pushes an undo
+// record holding the previous tick's scalars and entities plus the old value
+// of each map cell that changed, which is usually a handful per tick. All
+// storage is allocated once by allocate(), before the first capture; the
+// oldest records are overwritten once the ring or the shared cell pool is full.
+class RewindBuffer {
+public:
+    RewindBuffer();
+
+    // One-time allocation of all history storage
+    void allocate(size_t capacityTicks, size_t ghostCount);
+
+    // Forget all history (new level / new game)
+    void clear();
+
+    // Record the state at the end of a tick
+    void capture(const GameSnapshot& state);
+
+    // Step 'head' one tick back; false when no older state is left
+    bool stepBack();
+
+    const GameSnapshot& current() const { return head; }
+    size_t size() const { return count; }
+    size_t capacity() const { return entries.size(); }
+
+private:
+    struct CellChange {
+        uint32_t index;
+        char previous;
+    };
+
+    struct Entry {
+        int time;
+        int SMtime;
+        int score;
+        int lives;
+        int dotsEaten;
+        bool superMode;
+        uint64_t rngState;
+        EntitySnapshot pacman;
+        uint64_t cellStart;      // position in the cell pool (monotonic)
+        uint32_t cellCount;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<MessageId> messages;        // parallel to entries
+    std::vector<EntitySnapshot> ghostPool;  // entries.size() * ghostsPerEntry
+    std::vector<CellChange> cellPool;
+    size_t ghostsPerEntry;
+
+    size_t newest;          // index of the newest entry
+    size_t count;
+    uint64_t cellEnd;       // total cell changes ever written
+    bool hasHead;
+    GameSnapshot head;
+
+    void dropOldest();
+    size_t oldestIndex() const;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Small deterministic PRNG (xorshift64*). The whole state is a single word so it
+// can be stored in replays and snapshots and restored exactly.
+class Rng {
+private:
+    uint64_t state;
+
+public:
+    explicit Rng(uint64_t s = 1) { seed(s); }
+
+    void seed(uint64_t s) { state = s ? s : 0x9E3779B97F4A7C15ULL; }
+    uint64_t getState() const { return state; }
+    void setState(uint64_t s) { seed(s); }
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // Uniform-enough integer in [0, n)
+    int nextInt(int n) { return static_cast<int>(next() % static_cast<uint64_t>(n)); }
+};
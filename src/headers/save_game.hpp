@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "snapshot.hpp"
+
+// Save file layout (integers little-endian):
+//   header   "PMSV", u8 version, 3 reserved bytes, u32 payloadSize,
+//            u32 layoutSize, u64 checksum (FNV-1a of the last layoutSize
+//            bytes of the payload, then of the rest)
+//   payload  GameSnapshot::serialize: counters, RNG state, the map's cell
+//            layer, every actor's position and heading, and last the layout
+//            of a --level-file level (layoutSize bytes, 0 if none)
+// Hashing the layout first lets an image encode and hash it once per level
+// and only the game state each tick.
+// A save is written to "<path>.tmp" and renamed over <path>, so a reader sees
+// the old save or the new one, never part of one.
+class SaveImage {
+public:
+    static const size_t HEADER_SIZE = 24;
+
+    SaveImage();
+
+    // Reuses its buffers, so encoding allocates nothing once they have grown.
+    // The layout is re-encoded only when the snapshot carries a different one.
+    void encode(const GameSnapshot& snapshot);
+
+private:
+    friend bool writeSaveFile(const char* path, const SaveImage& image);
+
+    std::vector<uint8_t> bytes;      // header and game state
+    std::vector<uint8_t> layoutBytes;
+    std::shared_ptr<const LevelData> layout;   // what layoutBytes holds
+    uint64_t layoutHash;             // FNV-1a state after layoutBytes
+};
+
+// Only open/write/close/rename on an already encoded image, so it is safe to
+// call from a signal handler
+bool writeSaveFile(const char* path, const SaveImage& image);
+
+// Maps the file and checks magic, version, size and checksum, then decodes it
+// and checks it against the level it names (size, actors on the grid)
+bool loadSaveFile(const std::string& path, GameSnapshot& snapshot, std::string& error);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Little-endian fixed-width and LEB128 varint encoding helpers shared by the
+// replay, snapshot and save formats.
+void putU8(std::vector<uint8_t>& out, uint8_t v);
+void putU32(std::vector<uint8_t>& out, uint32_t v);
+void putU64(std::vector<uint8_t>& out, uint64_t v);
+void putVarint(std::vector<uint8_t>& out, uint64_t v);
+void putSignedVarint(std::vector<uint8_t>& out, int64_t v);
+void putBytes(std::vector<uint8_t>& out, const void* data, size_t size);
+void putString(std::vector<uint8_t>& out, const std::string& s);
+void putString(std::vector<uint8_t>& out, const char* s);
+
+// Bounds-checked reader over a byte range. Any read past the end sets the
+// failed flag and returns zero, so callers can decode a whole record and check
+// ok() once at the end.
+class ByteReader {
+private:
+    const uint8_t* cur;
+    const uint8_t* end;
+    bool failed;
+
+public:
+    ByteReader(const uint8_t* data, size_t size) : cur(data), end(data + size), failed(false) {}
+
+    uint8_t getU8();
+    uint32_t getU32();
+    uint64_t getU64();
+    uint64_t getVarint();
+    int64_t getSignedVarint();
+    bool getBytes(void* dst, size_t size);
+    std::string getString();
+    bool skip(size_t size);
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return cur >= end; }
+    size_t remaining() const { return static_cast<size_t>(end - cur); }
+    const uint8_t* position() const { return cur; }
+};
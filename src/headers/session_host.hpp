@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "game.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+// Lateness of scheduled steps, bucketed by powers of two microseconds
+class JitterStats {
+public:
+    static const int BUCKETS = 32;
+
+    JitterStats();
+    void add(int64_t micros);
+    void merge(const JitterStats& other);
+    int64_t percentile(double p) const;   // upper bound of the bucket holding p
+    int64_t getMax() const { return maxMicros; }
+    double mean() const { return samples ? static_cast<double>(totalMicros) / samples : 0.0; }
+    uint64_t count() const { return samples; }
+
+private:
+    uint64_t buckets[BUCKETS];
+    uint64_t samples;
+    int64_t totalMicros;
+    int64_t maxMicros;
+};
+
+// Runs many independent headless Games on one WorkStealingPool instead of the
+// five threads per Game that Game::start() uses. A timer thread keeps every
+// session's next due time in a heap and submits the session as one task when
+// it is due; the task runs all of that session's Pacman/ghost steps that are
+// due, so a session never runs on two workers at once and needs no lock.
+class SessionHost {
+public:
+    SessionHost(size_t sessionCount, size_t threadCount, uint64_t seed);
+    ~SessionHost();
+
+    void run(std::chrono::milliseconds duration);
+    void printReport(std::ostream& out) const;
+
+    // A run is sustained when nearly every step started within 10% of a tick
+    bool sustained() const;
+    size_t getThreadCount() const { return pool.size(); }
+    size_t getSessionCount() const { return sessions.size(); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Session {
+        Game game;
+        Rng input;
+        Clock::time_point nextPacman;
+        std::vector<Clock::time_point> nextGhost;
+        JitterStats jitter;
+        uint64_t ticks;
+        uint64_t gamesFinished;
+    };
+
+    struct Due {
+        Clock::time_point when;
+        size_t session;
+        bool operator>(const Due& other) const { return when > other.when; }
+    };
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    WorkStealingPool pool;
+
+    std::mutex timerMutex;
+    std::condition_variable timerCv;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due> > timers;
+    bool stopping;
+    std::atomic<size_t> inFlight;
+    Clock::duration elapsed;
+
+    void runSession(size_t index, Clock::time_point due);
+    void schedule(size_t index, Clock::time_point when);
+    void timerLoop();
+};
+
+// Entry point for `--host`; sessions == 0 ramps up to find the sustainable count
+int runSessionHost(size_t sessions, int seconds, size_t threads);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "message.hpp"
+
+class LevelData;
+
+// Position/heading of one actor. Pacman stores its glyph ('<', '>', '^', 'v'),
+// ghosts store their Direction value and the cell their glyph covers.
+struct EntitySnapshot {
+    int y;
+    int x;
+    char direction;
+    bool alive;
+    char under;
+};
+
+// Complete simulation state of a Game: enough to resume play bit-for-bit.
+struct GameSnapshot {
+    int level;
+    int time;
+    int SMtime;
+    int score;
+    int lives;
+    int dotsEaten;
+    int maxDots;
+    bool superMode;
+    uint64_t rngState;
+    MessageId message;          // stored as its text, so IDs may be renumbered
+
+    int height;
+    int width;
+    std::vector<char> cells;    // height * width, row-major
+
+    EntitySnapshot pacman;
+    std::vector<EntitySnapshot> ghosts;
+
+    // Set only for a level that is not built in (--level-file), which a
+    // replay or save then carries with it
+    std::shared_ptr<const LevelData> layout;
+
+    GameSnapshot();
+
+    void serialize(std::vector<uint8_t>& out) const;
+    // serialize() without the layout, which it appends last
+    void serializeState(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+};
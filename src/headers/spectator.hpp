@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "io_ring.hpp"
+
+// Read-only spectators over a local Unix domain socket.
+//
+// The game publishes each rendered frame once per tick. publish() diffs it
+// against the previous frame and encodes only the changed lines as cursor
+// moves + line text (every KEYFRAME_INTERVAL ticks, and whenever someone new
+// connects, a full clear-and-redraw is encoded instead). The encoded message
+// goes into a fixed ring; a server thread copies ring entries to each client
+// with non-blocking writes. A client that falls a whole ring behind skips
+// ahead to the newest keyframe, so the game never waits for a spectator. With
+// the io_uring backend one submission per loop iteration carries the sends to
+// every client that has something to read. The
+// stream is plain terminal output: `socat - UNIX-CONNECT:<path>` works too.
+class SpectatorBroadcaster {
+public:
+    static const size_t RING_SLOTS = 64;
+    static const int KEYFRAME_INTERVAL = 32;
+
+    SpectatorBroadcaster();
+    ~SpectatorBroadcaster();
+
+    bool start(const std::string& socketPath);
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // Called once per tick from the render path
+    void publish(const std::vector<std::string>& lines);
+
+    size_t getSpectatorCount() const { return spectatorCount.load(); }
+    uint64_t getDroppedFrames() const { return droppedFrames.load(); }
+
+private:
+    struct Slot {
+        uint64_t seq;
+        bool keyframe;
+        std::string bytes;
+    };
+
+    struct Client {
+        int fd;
+        uint64_t nextSeq;
+        std::string pending;
+        size_t offset;
+    };
+
+    std::vector<Slot> ring;
+    uint64_t nextSeq;            // sequence number of the next published message
+    size_t slotReserve;          // capacity of every slot, twice the largest message so far
+    mutable std::mutex ringMutex;
+
+    // Encoder state, only touched by publish()
+    std::vector<std::string> previous;
+    std::string encoded;
+    int ticksSinceKeyframe;
+    std::atomic<bool> keyframeRequested;
+
+    std::string path;
+    int listenFd;
+    int wakeFds[2];
+    std::thread server;
+    std::atomic<bool> running;
+    std::atomic<size_t> spectatorCount;
+    std::atomic<uint64_t> droppedFrames;
+
+    void serverLoop();
+    bool fillPending(Client& client);
+    bool flushClient(Client& client);
+    void flushClientsRing(std::vector<Client>& clients, IoRing& sender,
+                          std::vector<IoRing::Completion>& completions);
+};
+
+// Entry point for `--spectate`: copy a broadcast to this terminal
+int runSpectator(const std::string& socketPath);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "ghost_strategy_abi.hpp"
+
+// A ghost strategy loaded from a shared library (see ghost_strategy_abi.hpp).
+// Owns the library handle and the plugin's state; unloads both on destruction.
+class StrategyPlugin {
+public:
+    StrategyPlugin();
+    ~StrategyPlugin();
+    StrategyPlugin(const StrategyPlugin&) = delete;
+    StrategyPlugin& operator=(const StrategyPlugin&) = delete;
+
+    // False (with the reason in 'error') if the library can't be used
+    bool load(const std::string& path, std::string& error);
+    bool isLoaded() const { return strategy != nullptr; }
+    const char* getName() const { return strategy ? strategy->name : ""; }
+
+    void decide(const PacmanGameView& view, uint8_t* directions);
+    uint64_t getCalls() const { return calls; }
+
+private:
+    void* library;
+    const PacmanGhostStrategy* strategy;
+    void* state;
+    uint64_t calls;
+
+    void unload();
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "level.hpp"
+
+// Next step toward one target cell for every cell of a level. A BFS outward
+// from the target records, for each cell reached, the neighbour it was reached
+// from, so a chaser's whole decision is one lookup. Portals count as walls,
+// as they do for the game's ghosts.
+//
+// A maze keeps the BFS frontier to a few hundred cells even at MAX_SIDE, too
+// narrow to be worth splitting across threads, so one field is one serial
+// BFS. Swarm mode (Game::setSwarm) builds the fields for different targets
+// side by side instead.
+class FlowField {
+public:
+    explicit FlowField(std::shared_ptr<const LevelData> level);
+
+    void compute(int targetCell);
+    int next(int cell) const { return nextCell[cell]; }   // the cell itself if unreachable
+    int getTarget() const { return target; }
+    bool isFor(const LevelData& data) const { return level.get() == &data; }
+
+private:
+    std::shared_ptr<const LevelData> level;
+    std::vector<int32_t> nextCell;
+    std::vector<int32_t> queue;
+    int target;
+};
+
+// Entry point for `--swarm`: plays the real game headless with 'ghosts' ghosts
+// in swarm mode on a generated arena, ticking back to back, and reports
+// ticks/sec, the cost of a field build and of a ghost step for each thread
+// count. ghosts == 0 sweeps ghost counts, threads == 0 sweeps 1..cores.
+int runSwarmBenchmark(size_t ghosts, int seconds, size_t threads, const std::string& strategyPath = "");
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Terminal size, re-read only after SIGWINCH. The handler just bumps a
+// generation counter (and wakes any waitKey()), so renderers compare one
+// number per frame and call ioctl(TIOCGWINSZ) only when it has changed.
+struct TerminalGeometry {
+    int rows;    // 0 when stdout is not a terminal
+    int cols;
+};
+
+void installResizeHandler();
+uint64_t resizeGeneration();
+TerminalGeometry queryTerminalGeometry();
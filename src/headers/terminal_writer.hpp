@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "io_ring.hpp"
+
+// Writes whole frames to the terminal with write(2) on its own thread, so a
+// slow terminal (e.g. an SSH pty) never stalls whoever submits frames. At
+// most two frames are pending: the one being written and the next one. A
+// frame submitted while the next one is still waiting replaces it, so the
+// terminal always catches up to the latest state and the skipped frames are
+// counted. With the io_uring backend (see io_ring.hpp) each frame goes out
+// through one registered buffer instead of write(2).
+class TerminalWriter {
+public:
+    explicit TerminalWriter(int fd = STDOUT_FILENO);
+    ~TerminalWriter();
+
+    TerminalWriter(const TerminalWriter&) = delete;
+    TerminalWriter& operator=(const TerminalWriter&) = delete;
+
+    // Queues 'frame' and hands back a spare buffer in its place (so callers
+    // can reuse its capacity). Never waits for the terminal.
+    void submit(std::string& frame);
+
+    // Blocks until every submitted frame is on the terminal. Call before
+    // writing to the terminal any other way.
+    void drain();
+
+    // Drains, then grows the writer's own frame buffers to 'bytes', so frames
+    // up to that size are handed back and forth without allocating
+    void reserve(size_t bytes);
+
+    // Called on the writer thread after each frame is fully written
+    void setOnFrameWritten(const std::function<void()>& callback) { onFrameWritten = callback; }
+
+    uint64_t getBytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+    uint64_t getWriteCalls() const { return writeCalls.load(std::memory_order_relaxed); }
+    uint64_t getFramesWritten() const { return framesWritten.load(std::memory_order_relaxed); }
+    uint64_t getFramesDropped() const { return framesDropped.load(std::memory_order_relaxed); }
+    bool isUsingRing() const { return usingRing.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    bool writeAll(const std::string& bytes);
+    bool writeAllRing(const std::string& bytes);
+    void waitWritable();
+
+    int fd;
+    std::function<void()> onFrameWritten;
+
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable idle;
+    std::string queued;      // next frame, replaced by newer submissions
+    std::string writing;     // frame the writer thread is putting out
+    bool hasQueued;
+    bool busy;
+    bool stopping;
+    std::thread writer;      // started by the first submit
+    IoRing ring;             // writer thread only; closed unless the backend is URING
+    std::vector<IoRing::Completion> completions;
+
+    std::atomic<uint64_t> bytesWritten;
+    std::atomic<uint64_t> writeCalls;
+    std::atomic<uint64_t> framesWritten;
+    std::atomic<uint64_t> framesDropped;
+    std::atomic<bool> usingRing;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "color.hpp"
+#include "level.hpp"
+
+// The parts of a level that never change while it is played (walls, portals,
+// bare floor), rendered once into one byte block with the colour escapes
+// baked in. Consecutive cells of one colour share a single escape. Frames copy
+// spans of it and render only the cells that differ from it: dots, pellets
+// and the actors.
+class TerrainCache {
+private:
+    std::shared_ptr<const LevelData> level;
+    int width;
+    std::string bytes;                     // every row, back to back
+    std::vector<uint32_t> offsets;         // (width + 1) per row: where each cell's bytes start
+    std::vector<char> baseCells;           // map character the baked bytes show
+    std::vector<uint8_t> colours;          // TextColor of each cell
+    std::vector<uint8_t> runStarts;        // 1 if the cell's bytes begin with its colour escape
+
+    size_t index(int y, int x) const { return static_cast<size_t>(y) * width + x; }
+    void bakeRow(const LevelData& data, int y, std::string& out, uint32_t base);
+
+public:
+    TerrainCache();
+
+    // Bake the static layer for a level; buffers are reused between levels
+    void build(const std::shared_ptr<const LevelData>& data);
+    // Switch to a new build of the same level, re-baking only the rows in
+    // 'changed' (a build of another size is baked from scratch)
+    void update(const std::shared_ptr<const LevelData>& data, const LevelData::Region& changed);
+    bool isFor(const LevelData& data) const { return level.get() == &data; }
+
+    char baseCell(int y, int x) const { return baseCells[index(y, x)]; }
+
+    // Append cells [x0, x1) of row y as baked
+    void appendSpan(std::string& out, int y, int x0, int x1) const;
+};
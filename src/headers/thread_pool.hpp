@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool. Every worker owns a deque: it pops its
+// own work from the back (LIFO, cache-warm) and idle workers steal from the
+// front of other workers' deques. Tasks submitted from outside the pool are
+// spread round-robin over the workers.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threadCount = 0);   // 0 = one per core
+    ~WorkStealingPool();
+
+    void submit(std::function<void()> task);
+    size_t size() const { return workers.size(); }
+    uint64_t getStealCount() const { return steals.load(); }
+    uint64_t getTaskCount() const { return executed.load(); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> nextWorker;
+    std::atomic<size_t> queued;
+    std::atomic<uint64_t> steals;
+    std::atomic<uint64_t> executed;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+
+    bool popLocal(size_t index, std::function<void()>& task);
+    bool steal(size_t thief, std::function<void()>& task);
+    void workerLoop(size_t index);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "game.hpp"
+#include "pathfinder.hpp"
+#include "rng.hpp"
+
+// How a headless Pacman picks its input each tick
+enum class PacmanPolicy {
+    RANDOM,     // the --host bot: turns at random now and then
+    GREEDY,     // heads for the nearest dot or pellet, ignoring ghosts
+    EVASIVE     // nearest dot it can reach without passing next to a ghost;
+                // hunts ghosts while they are frightened
+};
+
+const char* policyName(PacmanPolicy policy);
+bool parsePolicy(const std::string& name, PacmanPolicy& policy);
+
+// Plays one policy. Keeps its BFS scratch between ticks so deciding never
+// allocates once the level size is known. On large levels the BFS stops after
+// NEAR_FOOD_CELLS cells, and food farther off is reached along a route.
+class PacmanBot {
+public:
+    PacmanBot();
+
+    void reset(PacmanPolicy policy, uint64_t seed);
+    // Key to pass to Game::applyInput, or 0 to keep the current heading
+    char decide(const Game& game);
+
+private:
+    PacmanPolicy policy;
+    Rng rng;
+    int width;
+    std::vector<int32_t> queue;
+    std::vector<uint32_t> seen;      // == stamp when visited in the current search
+    std::vector<uint8_t> firstMove;  // index into MOVES of the first step toward the cell
+    std::vector<uint32_t> danger;    // == stamp when next to a ghost this tick
+    uint32_t stamp;
+    std::shared_ptr<const LevelData> routesLevel;     // the level 'routes' matches
+    std::unique_ptr<HierarchicalPathfinder> routes;   // null on small levels
+    int farFood;                                      // cell being routed to, -1 if none
+
+    bool passable(const Map& map, int y, int x) const;
+    char nearestFood(const Game& game, bool avoidGhosts, bool huntGhosts);
+    char routeToFood(const Game& game, bool avoidGhosts);
+    char safestStep(const Game& game) const;
+};
+
+struct TournamentConfig {
+    std::string outPath;                   // CSV of finished games; the summary goes next to it
+    std::vector<std::string> strategies;   // "builtin" or a plugin path
+    std::vector<PacmanPolicy> policies;
+    std::vector<int> levels;
+    int seeds;                             // games per (strategy, policy, level)
+    size_t threads;                        // 0 = one per core
+    int maxTicks;                          // a game still running after this many ticks is a loss
+
+    TournamentConfig();
+};
+
+// Entry point for `--tournament`: plays every strategy against every policy on
+// every level and seed, appending each game to the CSV as it finishes. Games
+// already in the CSV are skipped, so an interrupted tournament resumes.
+int runTournament(const TournamentConfig& config);
@@ -0,0 +1,59 @@
+#pragma once
+
+// Scoped tick-phase tracing, exported as Chrome/Perfetto trace-event JSON.
+//
+// Build with -DPACMAN_TRACE (CMake: -DENABLE_TRACING=ON, make: TRACE=1) to
+// enable. Without it every TRACE_* macro expands to nothing, so the trace
+// points cost no code at all in normal builds.
+//
+// Each thread appends complete events to its own fixed ring buffer; the only
+// shared state is the buffer registry, touched once per thread. Export reads
+// the rings without stopping writers, so an event being overwritten at that
+// exact moment may come out torn - fine for a profiling aid.
+
+// Written on exit, and on SIGUSR1 while a game is running
+#define PACMAN_TRACE_FILE "pacman-trace.json"
+
+#ifdef PACMAN_TRACE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, long arg = -1);
+    ~TraceScope() { end(); }
+    void end();
+
+private:
+    const char* name;
+    long arg;
+    uint64_t start;
+    bool open;
+};
+
+void traceSetThreadName(const char* name);
+bool traceExport(const char* path);
+void traceRequestExport();     // async-signal-safe; serviced by traceServiceRequests()
+void traceServiceRequests(const char* path);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, static_cast<long>(arg))
+#define TRACE_THREAD_NAME(name) traceSetThreadName(name)
+#define TRACE_EXPORT(path) traceExport(path)
+#define TRACE_REQUEST_EXPORT() traceRequestExport()
+#define TRACE_SERVICE_REQUESTS(path) traceServiceRequests(path)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_SCOPE_ARG(name, arg) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#define TRACE_EXPORT(path) do {} while (0)
+#define TRACE_REQUEST_EXPORT() do {} while (0)
+#define TRACE_SERVICE_REQUESTS(path) do {} while (0)
+
+#endif
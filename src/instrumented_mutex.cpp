@@ -0,0 +1,173 @@
+#include "instrumented_mutex.hpp"
+#include <iomanip>
+
+using namespace std;
+
+const int LockSite::BUCKETS;
+
+static int bucketFor(uint64_t ns) {
+    uint64_t micros = ns / 1000;
+    int bucket = 0;
+    while (bucket < LockSite::BUCKETS - 1 && (uint64_t(1) << bucket) <= micros) ++bucket;
+    return bucket;
+}
+
+static void updateMax(atomic<uint64_t>& maximum, uint64_t value) {
+    uint64_t seen = maximum.load(memory_order_relaxed);
+    while (value > seen && !maximum.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+    }
+}
+
+// Upper bound (in microseconds) of the bucket holding percentile p; 0 for under 1us
+static uint64_t percentileMicros(const atomic<uint64_t>* buckets, uint64_t samples, double p) {
+    if (samples == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(p * samples);
+    uint64_t seen = 0;
+    for (int i = 0; i < LockSite::BUCKETS; ++i) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen > target) return i == 0 ? 0 : uint64_t(1) << i;
+    }
+    return uint64_t(1) << (LockSite::BUCKETS - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Sites
+// ---------------------------------------------------------------------------
+
+LockSite::LockSite(const string& siteName)
+    : name(siteName), waitLabel("lock wait: " + siteName), holdLabel("lock hold: " + siteName) {
+    reset();
+}
+
+void LockSite::reset() {
+    acquisitions = 0;
+    contended = 0;
+    waitNs = 0;
+    holdNs = 0;
+    maxWaitNs = 0;
+    maxHoldNs = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        waitBuckets[i] = 0;
+        holdBuckets[i] = 0;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Mutex
+// ---------------------------------------------------------------------------
+
+InstrumentedMutex::InstrumentedMutex(const string& mutexName)
+    : name(mutexName), acquisitions(0), contended(0), waitNs(0) {
+}
+
+uint64_t InstrumentedMutex::lockTimed() {
+    uint64_t waited = 0;
+    if (!mutex.try_lock()) {
+        auto start = Clock::now();
+        mutex.lock();
+        waited = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+        waitNs.fetch_add(waited, memory_order_relaxed);
+        contended.fetch_add(1, memory_order_relaxed);
+    }
+    acquisitions.fetch_add(1, memory_order_relaxed);
+    return waited;
+}
+
+void InstrumentedMutex::lock() {
+    lockTimed();
+}
+
+bool InstrumentedMutex::try_lock() {
+    if (!mutex.try_lock()) return false;
+    acquisitions.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void InstrumentedMutex::unlock() {
+    mutex.unlock();
+}
+
+LockSite& InstrumentedMutex::site(const string& siteName) {
+    lock_guard<std::mutex> lock(sitesMutex);
+    for (auto& s : sites) {
+        if (s->name == siteName) return *s;
+    }
+    sites.push_back(unique_ptr<LockSite>(new LockSite(siteName)));
+    return *sites.back();
+}
+
+void InstrumentedMutex::resetSites() {
+    lock_guard<std::mutex> lock(sitesMutex);
+    for (auto& s : sites) s->reset();
+}
+
+void InstrumentedMutex::printReport(ostream& out) const {
+    lock_guard<std::mutex> lock(sitesMutex);
+    uint64_t total = 0, totalContended = 0;
+    for (const auto& s : sites) {
+        total += s->acquisitions;
+        totalContended += s->contended;
+    }
+
+    out << "  Lock profile: " << name << "  " << total << " acquisitions, "
+        << fixed << setprecision(1) << (total ? 100.0 * totalContended / total : 0.0) << "% contended" << endl;
+    out << "  " << left << setw(12) << "site" << right
+        << setw(8) << "count" << setw(8) << "cont%"
+        << setw(10) << "wait p50" << setw(10) << "wait p99" << setw(10) << "wait max"
+        << setw(10) << "hold p50" << setw(10) << "hold p99" << setw(10) << "hold max"
+        << setw(11) << "wait ms" << setw(10) << "hold ms" << endl;
+    for (const auto& s : sites) {
+        uint64_t n = s->acquisitions;
+        if (n == 0) continue;
+        out << "  " << left << setw(12) << s->name << right
+            << setw(8) << n
+            << setw(8) << setprecision(1) << 100.0 * s->contended / n
+            << setw(8) << percentileMicros(s->waitBuckets, n, 0.50) << "us"
+            << setw(8) << percentileMicros(s->waitBuckets, n, 0.99) << "us"
+            << setw(8) << s->maxWaitNs / 1000 << "us"
+            << setw(8) << percentileMicros(s->holdBuckets, n, 0.50) << "us"
+            << setw(8) << percentileMicros(s->holdBuckets, n, 0.99) << "us"
+            << setw(8) << s->maxHoldNs / 1000 << "us"
+            << setw(11) << setprecision(2) << s->waitNs / 1e6
+            << setw(10) << s->holdNs / 1e6 << endl;
+    }
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
+
+// ---------------------------------------------------------------------------
+// Guard
+// ---------------------------------------------------------------------------
+
+InstrumentedLock::InstrumentedLock(InstrumentedMutex& m, LockSite& s)
+    : mutex(m), site(s), acquired(acquire())
+#ifdef PACMAN_TRACE
+    , holdScope(s.holdLabel.c_str())
+#endif
+{
+}
+
+InstrumentedMutex::Clock::time_point InstrumentedLock::acquire() {
+#ifdef PACMAN_TRACE
+    TraceScope waitScope(site.waitLabel.c_str());
+#endif
+    uint64_t waited = mutex.lockTimed();
+    if (waited > 0) site.contended.fetch_add(1, memory_order_relaxed);
+    site.waitNs.fetch_add(waited, memory_order_relaxed);
+    site.waitBuckets[bucketFor(waited)].fetch_add(1, memory_order_relaxed);
+    updateMax(site.maxWaitNs, waited);
+    return InstrumentedMutex::Clock::now();
+}
+
+InstrumentedLock::~InstrumentedLock() {
+    uint64_t held = static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(InstrumentedMutex::Clock::now() - acquired).count());
+#ifdef PACMAN_TRACE
+    holdScope.end();
+#endif
+    mutex.unlock();
+    site.acquisitions.fetch_add(1, memory_order_relaxed);
+    site.holdNs.fetch_add(held, memory_order_relaxed);
+    site.holdBuckets[bucketFor(held)].fetch_add(1, memory_order_relaxed);
+    updateMax(site.maxHoldNs, held);
+}
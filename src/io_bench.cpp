@@ -0,0 +1,188 @@
+#include "io_bench.hpp"
+#include "io_ring.hpp"
+#include "game.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+// Frames of a headless game, as the terminal would receive them
+static vector<string> recordFrames(size_t count) {
+    Game game;
+    game.setHeadless(true);
+    game.setReplayDirectory("");
+    game.newGame(1, 42);
+    vector<string> frames;
+    vector<string> lines;
+    static const char KEYS[] = "dwas";
+    for (size_t i = 0; frames.size() < count; ++i) {
+        if (game.isOver()) game.newGame(1, 42 + i);
+        game.tickPacman();
+        if (i % 5 == 0) game.applyInput(KEYS[(i / 5) % 4]);
+        if (i % 2 == 0) {
+            for (size_t g = 0; g < game.getGhostCount(); ++g) game.stepGhost(g);
+        }
+        game.buildFrame(lines);
+        string frame = "\033[H";
+        for (size_t l = 0; l < lines.size(); ++l) frame += lines[l] + "\n";
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+static double cpuMicros() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+struct IoBenchResult {
+    uint64_t syscalls;
+    double cpuMicros;
+    double wallMicros;
+};
+
+// One frame to every pipe per iteration; a reader thread keeps the pipes empty
+static bool benchBackend(IoBackend backend, const vector<string>& frames, int count, size_t sessions,
+                         IoBenchResult& result, string& error) {
+    vector<int> readEnds(sessions), writeEnds(sessions);
+    for (size_t s = 0; s < sessions; ++s) {
+        int ends[2];
+        if (pipe(ends) != 0) {
+            error = string("pipe: ") + strerror(errno);
+            for (size_t k = 0; k < s; ++k) {
+                ::close(readEnds[k]);
+                ::close(writeEnds[k]);
+            }
+            return false;
+        }
+        readEnds[s] = ends[0];
+        writeEnds[s] = ends[1];
+    }
+
+    IoRing ring;
+    vector<IoRing::Completion> completions;
+    bool ready = backend != IoBackend::URING ||
+                 (ring.open(static_cast<unsigned>(max<size_t>(sessions, 2)), error) &&
+                  ring.registerBuffers(sessions, 64 * 1024, error));
+    atomic<bool> draining(ready);
+    thread reader([&]() {
+        vector<pollfd> fds(sessions);
+        for (size_t s = 0; s < sessions; ++s) {
+            fds[s].fd = readEnds[s];
+            fds[s].events = POLLIN;
+        }
+        char sink[65536];
+        while (draining) {
+            if (poll(fds.data(), fds.size(), 20) <= 0) continue;
+            for (size_t s = 0; s < sessions; ++s) {
+                if (fds[s].revents & POLLIN) {
+                    ssize_t ignored = read(fds[s].fd, sink, sizeof(sink));
+                    (void)ignored;
+                }
+            }
+        }
+    });
+
+    bool ok = ready;
+    uint64_t calls = 0;
+    vector<size_t> sent(sessions);
+    double cpuStart = cpuMicros();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; ok && i < count; ++i) {
+        const string& frame = frames[static_cast<size_t>(i) % frames.size()];
+        if (backend == IoBackend::WRITE) {
+            for (size_t s = 0; ok && s < sessions; ++s) {
+                size_t offset = 0;
+                while (offset < frame.size()) {
+                    ssize_t n = ::write(writeEnds[s], frame.data() + offset, frame.size() - offset);
+                    ++calls;
+                    if (n > 0) {
+                        offset += static_cast<size_t>(n);
+                    } else if (n < 0 && errno != EINTR) {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+        } else {
+            size_t waiting = sessions;
+            for (size_t s = 0; s < sessions; ++s) {
+                memcpy(ring.buffer(s), frame.data(), frame.size());
+                sent[s] = 0;
+            }
+            while (ok && waiting > 0) {
+                for (size_t s = 0; s < sessions; ++s) {
+                    if (sent[s] < frame.size()) ring.queueWrite(writeEnds[s], s, sent[s], frame.size() - sent[s], s);
+                }
+                ok = ring.submitAndWait(completions);
+                for (size_t c = 0; ok && c < completions.size(); ++c) {
+                    int n = completions[c].result;
+                    if (n > 0) {
+                        sent[completions[c].tag] += static_cast<size_t>(n);
+                        if (sent[completions[c].tag] == frame.size()) --waiting;
+                    } else if (n != -EINTR && n != -EAGAIN) {
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    result.wallMicros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    result.cpuMicros = cpuMicros() - cpuStart;
+    result.syscalls = backend == IoBackend::URING ? ring.getEnterCalls() : calls;
+
+    draining = false;
+    reader.join();
+    for (size_t s = 0; s < sessions; ++s) {
+        ::close(readEnds[s]);
+        ::close(writeEnds[s]);
+    }
+    if (ready && !ok) error = "write failed";
+    return ok;
+}
+
+int runIoBenchmark(int frames) {
+    frames = max(frames, 1);
+    vector<string> recorded = recordFrames(256);
+    size_t bytes = 0;
+    for (size_t i = 0; i < recorded.size(); ++i) bytes += recorded[i].size();
+
+    cout << "Terminal I/O: " << frames << " frames of ~" << bytes / recorded.size()
+         << " bytes to each session (a pipe drained by another thread)" << endl;
+    cout << "  CPU includes the draining thread, which is the same for both backends" << endl;
+    cout << "  sessions  backend  syscalls/frame  cpu us/frame  wall us/frame" << endl;
+    cout << fixed;
+    static const size_t SESSIONS[] = {1, 8, 64};
+    static const IoBackend BACKENDS[] = {IoBackend::WRITE, IoBackend::URING};
+    bool uringMissing = false;
+    for (size_t s = 0; s < sizeof(SESSIONS) / sizeof(SESSIONS[0]); ++s) {
+        for (size_t b = 0; b < 2; ++b) {
+            if (BACKENDS[b] == IoBackend::URING && uringMissing) continue;
+            IoBenchResult result = {0, 0, 0};
+            string error;
+            if (!benchBackend(BACKENDS[b], recorded, frames, SESSIONS[s], result, error)) {
+                cout << "  " << setw(8) << SESSIONS[s] << "  " << setw(7) << ioBackendName(BACKENDS[b])
+                     << "  " << error << (BACKENDS[b] == IoBackend::URING ? " (write is the fallback)" : "")
+                     << endl;
+                if (BACKENDS[b] == IoBackend::URING) uringMissing = true;
+                continue;
+            }
+            double perFrame = static_cast<double>(frames) * SESSIONS[s];
+            cout << "  " << setw(8) << SESSIONS[s] << "  " << setw(7) << ioBackendName(BACKENDS[b]) << "  "
+                 << setprecision(3) << setw(14) << result.syscalls / perFrame << "  " << setprecision(2)
+                 << setw(12) << result.cpuMicros / perFrame << "  " << setw(13) << result.wallMicros / perFrame
+                 << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "io_ring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace std;
+
+static atomic<int> selectedBackend(static_cast<int>(IoBackend::WRITE));
+
+void setIoBackend(IoBackend backend) {
+    selectedBackend = static_cast<int>(backend);
+}
+
+IoBackend getIoBackend() {
+    return static_cast<IoBackend>(selectedBackend.load());
+}
+
+const char* ioBackendName(IoBackend backend) {
+    return backend == IoBackend::URING ? "uring" : "write";
+}
+
+bool parseIoBackend(const string& name, IoBackend& backend) {
+    if (name == "write") {
+        backend = IoBackend::WRITE;
+    } else if (name == "uring") {
+        backend = IoBackend::URING;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned submit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+IoRing::IoRing() : ringFd(-1), sqMap(MAP_FAILED), sqMapBytes(0), cqMap(MAP_FAILED), cqMapBytes(0),
+                   sqes(nullptr), sqesBytes(0), sqHead(nullptr), sqTail(nullptr), sqMask(nullptr),
+                   sqArray(nullptr), sqEntries(0), cqHead(nullptr), cqTail(nullptr), cqMask(nullptr),
+                   cqes(nullptr), localTail(0), inFlight(0), bufferBytes(0), enterCalls(0) {
+}
+
+IoRing::~IoRing() {
+    close();
+}
+
+bool IoRing::open(unsigned entries, string& error) {
+    close();
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = ioUringSetup(entries, &params);
+    if (ringFd < 0) {
+        error = string("io_uring unavailable: ") + strerror(errno);
+        return false;
+    }
+
+    sqMapBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) sqMapBytes = cqMapBytes = max(sqMapBytes, cqMapBytes);
+
+    sqMap = mmap(nullptr, sqMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    cqMap = single ? sqMap
+                   : mmap(nullptr, cqMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                          IORING_OFF_CQ_RING);
+    sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqeMap = mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                        IORING_OFF_SQES);
+    if (sqMap == MAP_FAILED || cqMap == MAP_FAILED || sqeMap == MAP_FAILED) {
+        if (sqeMap != MAP_FAILED) munmap(sqeMap, sqesBytes);
+        error = string("cannot map io_uring: ") + strerror(errno);
+        close();
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+    uint8_t* sq = static_cast<uint8_t*>(sqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    uint8_t* cq = static_cast<uint8_t*>(cqMap);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    localTail = *sqTail;
+    inFlight = 0;
+    return true;
+}
+
+void IoRing::close() {
+    if (sqes) munmap(sqes, sqesBytes);
+    if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqMapBytes);
+    if (sqMap != MAP_FAILED) munmap(sqMap, sqMapBytes);
+    if (ringFd >= 0) ::close(ringFd);   // also drops the registered buffers
+    ringFd = -1;
+    sqMap = cqMap = MAP_FAILED;
+    sqes = nullptr;
+    cqes = nullptr;
+    buffers.clear();
+    bufferBytes = 0;
+}
+
+bool IoRing::registerBuffers(size_t count, size_t bytes, string& error) {
+    buffers.assign(count * bytes, 0);
+    bufferBytes = bytes;
+    vector<iovec> vectors(count);
+    for (size_t i = 0; i < count; ++i) {
+        vectors[i].iov_base = buffer(i);
+        vectors[i].iov_len = bytes;
+    }
+    if (ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, vectors.data(), static_cast<unsigned>(count)) < 0) {
+        error = string("cannot register io_uring buffers: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+io_uring_sqe* IoRing::nextSqe() {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (localTail - head >= sqEntries) return nullptr;
+    unsigned index = localTail & *sqMask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++localTail;
+    ++inFlight;
+    return sqe;
+}
+
+bool IoRing::queueWrite(int fd, size_t bufferIndex, size_t offset, size_t length, uint64_t tag) {
+    io_uring_sqe* sqe = nextSqe();
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer(bufferIndex) + offset);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = static_cast<uint64_t>(-1);   // current file position, as write(2)
+    sqe->buf_index = static_cast<uint16_t>(bufferIndex);
+    sqe->user_data = tag;
+    return true;
+}
+
+bool IoRing::queueSend(int fd, const void* data, size_t length, uint64_t tag) {
+    io_uring_sqe* sqe = nextSqe();
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag;
+    return true;
+}
+
+bool IoRing::submitAndWait(vector<Completion>& completions) {
+    completions.clear();
+    __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+    while (inFlight > 0) {
+        unsigned unsubmitted = localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        ++enterCalls;
+        if (ioUringEnter(ringFd, unsubmitted, inFlight, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            inFlight = 0;
+            return false;
+        }
+
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            Completion done;
+            done.tag = cqe.user_data;
+            done.result = cqe.res;
+            completions.push_back(done);
+            --inFlight;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
@@ -0,0 +1,380 @@
+#include "level.hpp"
+#include "serialize.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+// Predefined maps
+static const char* const LEVEL1_ROWS[] = {
+    "###########################",
+    "#O..........###..........O#",
+    "#....#################....#",
+    "#.........................#",
+    "#.######.#########.######.#",
+    "[......#.....#.....#......]",
+    "######....#######....######",
+    "#O.....#           #.....O#",
+    "######.#           #.######",
+    "[......             ......]",
+    "######.#           #.######",
+    "#O.....#           #.....O#",
+    "######.#..#######..#.######",
+    "[.........................]",
+    "#.####.#############.####.#",
+    "#............<............#",
+    "######...###...###...######",
+    "#....#...###...###...#....#",
+    "#O.......................O#",
+    "#..........#####..........#",
+    "###########################"
+};
+
+static const char* const LEVEL2_ROWS[] = {
+    "###########################",
+    "#O..........###..........O#",
+    "#....#################....#",
+    "#.........................#",
+    "#.######.#########.######.#",
+    "[......#.....#.....#......]",
+    "######....#######....######",
+    "#O.....#           #.....O#",
+    "######.#           #.######",
+    "[......             ......]",
+    "######.#           #.######",
+    "#O.....#           #.....O#",
+    "######.#..#######..#.######",
+    "[.........................]",
+    "#.####.#############.####.#",
+    "#............<............#",
+    "######...###...###...######",
+    "#....#...###...###...#....#",
+    "#O.......................O#",
+    "#..........#####..........#",
+    "###########################"
+};
+
+// Ghost house slots, in GhostType order
+static const LevelData::Spawn GHOST_HOUSE[] = {{9, 12}, {9, 14}, {10, 12}, {10, 14}};
+
+const int LevelData::FILE_LEVEL;
+const int LevelData::MAX_SIDE;
+const int LevelData::MAX_GHOST_SPAWNS;
+
+static mutex cacheMutex;
+static map<int, shared_ptr<const LevelData> > cache;
+
+static LevelData::Terrain terrainFor(char c) {
+    if (c == '#') return LevelData::WALL;
+    if (c == '[' || c == ']') return LevelData::PORTAL;
+    return LevelData::FLOOR;
+}
+
+static bool isSpawnGlyph(char c) {
+    return c == '<' || c == '>' || c == '^' || c == 'v';
+}
+
+LevelData::LevelData() : id(0), height(0), width(0), maxDots(0) {
+    pacmanSpawn.y = 0;
+    pacmanSpawn.x = 0;
+}
+
+void LevelData::install(const shared_ptr<const LevelData>& level) {
+    lock_guard<mutex> lock(cacheMutex);
+    cache[level->getId()] = level;
+}
+
+shared_ptr<const LevelData> LevelData::acquire(int levelId) {
+    lock_guard<mutex> lock(cacheMutex);
+    auto it = cache.find(levelId);
+    if (it != cache.end()) return it->second;
+
+    const char* const* rows = nullptr;
+    size_t count = 0;
+    if (levelId == 1) {
+        rows = LEVEL1_ROWS;
+        count = sizeof(LEVEL1_ROWS) / sizeof(LEVEL1_ROWS[0]);
+    } else if (levelId == 2) {
+        rows = LEVEL2_ROWS;
+        count = sizeof(LEVEL2_ROWS) / sizeof(LEVEL2_ROWS[0]);
+    } else {
+        return nullptr;
+    }
+
+    vector<string> text(rows, rows + count);
+    vector<Spawn> ghosts(GHOST_HOUSE, GHOST_HOUSE + sizeof(GHOST_HOUSE) / sizeof(GHOST_HOUSE[0]));
+    // Cleared once every dot and pellet is eaten, as for a level file
+    shared_ptr<const LevelData> level = fromRows(levelId, text, -1, ghosts);
+    cache[levelId] = level;
+    return level;
+}
+
+shared_ptr<const LevelData> LevelData::fromRows(int levelId, const vector<string>& rows, int dotTotal,
+                                                const vector<Spawn>& ghostSpawns) {
+    shared_ptr<LevelData> level(new LevelData());
+    level->id = levelId;
+    level->height = static_cast<int>(rows.size());
+    level->width = 0;
+    for (const auto& row : rows) {
+        level->width = max(level->width, static_cast<int>(row.size()));
+    }
+
+    size_t cells = static_cast<size_t>(level->height) * level->width;
+    level->initialCells.assign(cells, ' ');
+    level->terrain.assign(cells, FLOOR);
+    level->nav.assign(cells, 0);
+    level->portalTarget.assign(cells, -1);
+    level->ghostSpawns = ghostSpawns;
+
+    int dots = 0;
+    for (int y = 0; y < level->height; ++y) {
+        for (int x = 0; x < static_cast<int>(rows[y].size()); ++x) {
+            char c = rows[y][x];
+            size_t i = level->index(y, x);
+            level->initialCells[i] = c;
+            level->terrain[i] = terrainFor(c);
+            if (countsTowardClear(c)) {
+                ++dots;
+            } else if (isSpawnGlyph(c)) {
+                level->pacmanSpawn.y = y;
+                level->pacmanSpawn.x = x;
+            }
+        }
+    }
+    level->maxDots = dotTotal >= 0 ? dotTotal : dots;
+
+    for (int y = 0; y < level->height; ++y) {
+        level->pairPortals(y);
+    }
+    for (int y = 0; y < level->height; ++y) {
+        for (int x = 0; x < level->width; ++x) {
+            level->deriveNav(y, x);
+        }
+    }
+    return level;
+}
+
+// A '[' sends you to the ']' on the same row and vice versa
+void LevelData::pairPortals(int y) {
+    int left = -1, right = -1;
+    for (int x = 0; x < width; ++x) {
+        char c = initialCells[index(y, x)];
+        portalTarget[index(y, x)] = -1;
+        if (c == '[' && left < 0) left = x;
+        if (c == ']') right = x;
+    }
+    if (left >= 0 && right >= 0) {
+        portalTarget[index(y, left)] = static_cast<int>(index(y, right));
+        portalTarget[index(y, right)] = static_cast<int>(index(y, left));
+    }
+}
+
+void LevelData::deriveNav(int y, int x) {
+    uint8_t mask = 0;
+    if (terrainAt(y, x) != WALL) {
+        if (y > 0 && terrainAt(y - 1, x) != WALL) mask |= NAV_UP;
+        if (y + 1 < height && terrainAt(y + 1, x) != WALL) mask |= NAV_DOWN;
+        if (x > 0 && terrainAt(y, x - 1) != WALL) mask |= NAV_LEFT;
+        if (x + 1 < width && terrainAt(y, x + 1) != WALL) mask |= NAV_RIGHT;
+    }
+    nav[index(y, x)] = mask;
+}
+
+// Re-derive a copy of a level for new rows of the same size. Only the cells
+// that changed are touched: the dot total moves by the difference, portals
+// are re-paired on the rows whose portals changed, and navigation is redone
+// for the changed cells and their neighbours.
+void LevelData::patch(const vector<string>& rows, Region& changed) {
+    changed.top = height;
+    changed.left = width;
+    changed.bottom = -1;
+    changed.right = -1;
+    vector<int> portalRows;
+    for (int y = 0; y < height; ++y) {
+        const string& row = rows[y];
+        for (int x = 0; x < width; ++x) {
+            char c = x < static_cast<int>(row.size()) ? row[x] : ' ';
+            size_t i = index(y, x);
+            char old = initialCells[i];
+            if (c == old) continue;
+
+            maxDots += countsTowardClear(c) - countsTowardClear(old);
+            if (terrainFor(c) == PORTAL || terrainFor(old) == PORTAL) {
+                if (portalRows.empty() || portalRows.back() != y) portalRows.push_back(y);
+            }
+            initialCells[i] = c;
+            terrain[i] = terrainFor(c);
+            changed.top = min(changed.top, y);
+            changed.bottom = max(changed.bottom, y);
+            changed.left = min(changed.left, x);
+            changed.right = max(changed.right, x);
+        }
+    }
+    if (changed.empty()) return;
+
+    for (size_t i = 0; i < portalRows.size(); ++i) {
+        pairPortals(portalRows[i]);
+    }
+    for (int y = max(0, changed.top - 1); y <= min(height - 1, changed.bottom + 1); ++y) {
+        for (int x = max(0, changed.left - 1); x <= min(width - 1, changed.right + 1); ++x) {
+            deriveNav(y, x);
+        }
+    }
+}
+
+shared_ptr<const LevelData> LevelData::fromFile(int levelId, const string& path, const LevelData* previous,
+                                                Region& changed, string& error) {
+    ifstream file(path.c_str());
+    if (!file) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+    vector<string> rows;
+    vector<Spawn> ghosts;
+    Spawn start = {-1, -1};
+    size_t longest = 0;
+    string line;
+    while (getline(file, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        int y = static_cast<int>(rows.size());
+        for (size_t x = 0; x < line.size(); ++x) {
+            if (line[x] == 'G') {
+                Spawn spawn = {y, static_cast<int>(x)};
+                ghosts.push_back(spawn);
+                line[x] = ' ';
+            } else if (isSpawnGlyph(line[x])) {
+                start.y = y;
+                start.x = static_cast<int>(x);
+            }
+        }
+        longest = max(longest, line.size());
+        rows.push_back(line);
+    }
+    while (!rows.empty() && rows.back().empty()) rows.pop_back();
+
+    if (rows.empty()) {
+        error = path + " is empty";
+        return nullptr;
+    }
+    if (rows.size() > static_cast<size_t>(MAX_SIDE) || longest > static_cast<size_t>(MAX_SIDE)) {
+        error = path + " is larger than " + to_string(MAX_SIDE) + "x" + to_string(MAX_SIDE);
+        return nullptr;
+    }
+    if (start.y < 0) {
+        error = path + " has no Pacman start ('<')";
+        return nullptr;
+    }
+    if (ghosts.size() > static_cast<size_t>(MAX_GHOST_SPAWNS)) {
+        error = path + " has more than " + to_string(MAX_GHOST_SPAWNS) + " ghost spawns ('G')";
+        return nullptr;
+    }
+    if (ghosts.empty()) {
+        ghosts.assign(GHOST_HOUSE, GHOST_HOUSE + sizeof(GHOST_HOUSE) / sizeof(GHOST_HOUSE[0]));
+    }
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        const Spawn& spawn = ghosts[i];
+        if (spawn.y >= static_cast<int>(rows.size()) || spawn.x >= static_cast<int>(longest) ||
+            (spawn.x < static_cast<int>(rows[spawn.y].size()) && terrainFor(rows[spawn.y][spawn.x]) == WALL)) {
+            error = path + " has a ghost spawn off the floor; mark spawns with 'G'";
+            return nullptr;
+        }
+    }
+
+    if (!previous || previous->height != static_cast<int>(rows.size()) ||
+        previous->width != static_cast<int>(longest)) {
+        shared_ptr<const LevelData> level = fromRows(levelId, rows, -1, ghosts);
+        changed.top = 0;
+        changed.left = 0;
+        changed.bottom = level->height - 1;
+        changed.right = level->width - 1;
+        return level;
+    }
+
+    // Same size: the arrays are copied (the old build stays shared with
+    // whoever still holds it) and only what the edit touched is re-derived
+    shared_ptr<LevelData> level(new LevelData(*previous));
+    level->id = levelId;
+    level->pacmanSpawn = start;
+    level->ghostSpawns = ghosts;
+    level->patch(rows, changed);
+    return level;
+}
+
+void LevelData::write(vector<uint8_t>& out) const {
+    putU8(out, static_cast<uint8_t>(height));
+    putU8(out, static_cast<uint8_t>(width));
+    putBytes(out, initialCells.data(), initialCells.size());
+    putU8(out, static_cast<uint8_t>(ghostSpawns.size()));
+    for (size_t i = 0; i < ghostSpawns.size(); ++i) {
+        putU8(out, static_cast<uint8_t>(ghostSpawns[i].y));
+        putU8(out, static_cast<uint8_t>(ghostSpawns[i].x));
+    }
+}
+
+shared_ptr<const LevelData> LevelData::read(int levelId, ByteReader& in, const shared_ptr<const LevelData>& reuse) {
+    int h = in.getU8();
+    int w = in.getU8();
+    size_t cells = static_cast<size_t>(h) * w;
+    if (!in.ok() || h == 0 || w == 0 || in.remaining() < cells) return nullptr;
+    vector<string> rows(h, string(w, ' '));
+    bool hasStart = false;
+    for (int y = 0; y < h; ++y) {
+        in.getBytes(&rows[y][0], w);
+        for (int x = 0; x < w; ++x) hasStart = hasStart || isSpawnGlyph(rows[y][x]);
+    }
+    vector<Spawn> ghosts(in.getU8());
+    for (size_t i = 0; i < ghosts.size(); ++i) {
+        ghosts[i].y = in.getU8();
+        ghosts[i].x = in.getU8();
+        if (ghosts[i].y >= h || ghosts[i].x >= w) return nullptr;
+    }
+    if (!in.ok() || !hasStart || ghosts.empty()) return nullptr;
+
+    if (reuse && reuse->height == h && reuse->width == w && reuse->ghostSpawns.size() == ghosts.size()) {
+        bool same = true;
+        for (int y = 0; y < h && same; ++y) {
+            same = rows[y].compare(0, w, reuse->initialRow(y), w) == 0;
+        }
+        for (size_t i = 0; i < ghosts.size() && same; ++i) {
+            same = reuse->ghostSpawns[i].y == ghosts[i].y && reuse->ghostSpawns[i].x == ghosts[i].x;
+        }
+        if (same) return reuse;
+    }
+    return fromRows(levelId, rows, -1, ghosts);
+}
+
+// Rings of growing radius around the (clamped) cell; whole rows at the top
+// and bottom of each ring, just the two ends in between
+int LevelData::findNearest(const uint8_t* cells, int height, int width, uint8_t value, int y, int x) {
+    y = min(max(y, 0), height - 1);
+    x = min(max(x, 0), width - 1);
+    int limit = max(height, width);
+    for (int r = 0; r < limit; ++r) {
+        for (int dy = -r; dy <= r; ++dy) {
+            int cy = y + dy;
+            if (cy < 0 || cy >= height) continue;
+            int step = dy == -r || dy == r ? 1 : 2 * r;
+            for (int dx = -r; dx <= r; dx += step) {
+                int cx = x + dx;
+                if (cx >= 0 && cx < width && cells[cy * width + cx] == value) return cy * width + cx;
+            }
+        }
+    }
+    return -1;
+}
+
+bool LevelData::portalExit(int y, int x, int& exitY, int& exitX) const {
+    if (!contains(y, x)) return false;
+    int target = portalTarget[index(y, x)];
+    if (target < 0) return false;
+    exitY = target / width;
+    exitX = target % width;
+    return true;
+}
+
+size_t LevelData::memoryBytes() const {
+    return sizeof(*this) + initialCells.capacity() + terrain.capacity() + nav.capacity() +
+           portalTarget.capacity() * sizeof(int) + ghostSpawns.capacity() * sizeof(Spawn);
+}
@@ -0,0 +1,49 @@
+#include "level_watcher.hpp"
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+
+LevelWatcher::LevelWatcher() : fd(-1) {}
+
+LevelWatcher::~LevelWatcher() {
+    close();
+}
+
+bool LevelWatcher::open(const string& path) {
+    close();
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    name = slash == string::npos ? path : path.substr(slash + 1);
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LevelWatcher::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool LevelWatcher::changed() {
+    if (fd < 0) return false;
+    alignas(inotify_event) char buffer[4096];
+    bool saved = false;
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < n;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && strcmp(event->name, name.c_str()) == 0) saved = true;
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return saved;
+}
@@ -1,18 +1,57 @@
 #include "game.hpp"
 #include "cursor_input.hpp"
+#include "session_host.hpp"
+#include "swarm.hpp"
+#include "pathfinder.hpp"
+#include "io_ring.hpp"
+#include "io_bench.hpp"
+#include "tournament.hpp"
+#include "fuzz.hpp"
+#include "replay_analytics.hpp"
+#include "spectator.hpp"
+#include "trace.hpp"
+#include "alloc_tracker.hpp"
+#include "terminal_geometry.hpp"
 #include <clocale>
 #include <cstdlib>
 #include <ctime>
 #include <string>
+#include <vector>
 #include <csignal>
 #include <iostream>
+#include <atomic>
+#include <unistd.h>
 
 using namespace std;
 
+// The interactive game, while it runs, so a kill can still save it
+static atomic<Game*> liveGame(nullptr);
+
+// SIGINT/SIGTERM. Only async-signal-safe calls from here on: another thread may
+// hold a lock or be inside malloc, so the trace is not exported on this path
+// (SIGUSR1 dumps it on demand) and the process leaves with _exit, which skips
+// the atexit handlers and static destructors.
 void cleanup(int signal) {
+    Game* game = liveGame.load();
+    if (game) game->writeLastSave();
     restoreTerminalBlocking();
-    showCursor();
-    exit(signal);
+    static const char showCursorCode[] = "\033[?25h";   // showCursor() goes through cout
+    ssize_t written = write(STDOUT_FILENO, showCursorCode, sizeof(showCursorCode) - 1);
+    (void)written;
+    _exit(signal);
+}
+
+// Splits "a,b,c"; empty items are dropped
+vector<string> splitList(const string& list) {
+    vector<string> items;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t comma = list.find(',', begin);
+        if (comma == string::npos) comma = list.size();
+        if (comma > begin) items.push_back(list.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return items;
 }
 
 void showInfo(const string& arg, const string& programName) {
@@ -22,9 +61,42 @@ void showInfo(const string& arg, const string& programName) {
         cout << "Options: " << endl;
         cout << "  -h, --help   Show this help message" << endl;
         cout << "  -v, --version Show version information" << endl;
+        cout << "  --no-record   Do not write a replay of each game to replays/" << endl;
+        cout << "  --save PATH   Where K (and Ctrl+C / kill) saves the game (default pacman.sav)" << endl;
+        cout << "  --resume FILE Continue a saved game" << endl;
+        cout << "  --level-file PATH  Offer the level in PATH as level 3 and reload it whenever it is saved" << endl;
+        cout << "  --replay FILE Play back a recorded game" << endl;
+        cout << "  --speed N     Replay speed: 1, 2, 8 or 'max' (headless)" << endl;
+        cout << "  --seek TICK   Start the replay at the given tick" << endl;
+        cout << "  --analyze DIR Aggregate heatmaps, deaths and clear times over the replays in DIR;" << endl;
+        cout << "                only replays added since the last run are read" << endl;
+        cout << "  --broadcast PATH  Let spectators watch this game over a Unix socket" << endl;
+        cout << "  --log PATH        Write a binary event log (read it with pacman-logdump)" << endl;
+        cout << "  --spectate PATH   Watch a game broadcast on PATH" << endl;
+        cout << "  --strategy LIB    Let a plugin (.so) steer the ghosts; games are not recorded" << endl;
+        cout << "  --host N|max  Run N headless sessions on a shared thread pool and report jitter" << endl;
+        cout << "                ('max' ramps up to the largest sustainable count)" << endl;
+        cout << "  --swarm N|max Play with N ghosts steered by shared flow fields on a large arena and" << endl;
+        cout << "                report ticks/sec per thread count ('max' also sweeps the ghost count)" << endl;
+        cout << "  --paths SIZE  Benchmark hierarchical pathfinding on a generated SIZE x SIZE maze" << endl;
+        cout << "  --tournament OUT.csv  Play every ghost strategy against every Pacman policy headless;" << endl;
+        cout << "                resumes from OUT.csv and writes a summary to OUT.json" << endl;
+        cout << "  --ghosts LIST     Tournament ghost strategies: builtin and/or plugin paths (default builtin)" << endl;
+        cout << "  --policies LIST   Tournament Pacman policies: random,greedy,evasive (default all)" << endl;
+        cout << "  --levels LIST     Tournament levels (default 1,2)" << endl;
+        cout << "  --seeds N         Tournament games per strategy, policy and level (default 20)" << endl;
+        cout << "  --seconds S   Duration of each --host run (default 5) or --swarm run (default 1)" << endl;
+        cout << "  --threads T   Worker threads for --host/--swarm/--tournament/--fuzz/--analyze (default: one per core / sweep)" << endl;
+        cout << "  --fuzz TICKS  Play random and coverage-guided input for TICKS ticks checking game" << endl;
+        cout << "                invariants; a failure is minimised and saved as fuzz-failure.pmr" << endl;
+        cout << "  --io write|uring  How frames reach the terminal and spectators: write(2), or batched" << endl;
+        cout << "                through io_uring (falls back to write where unavailable)" << endl;
+        cout << "  --io-bench FRAMES Compare system calls and CPU per frame of the two --io backends" << endl;
+        cout << "  --check-allocs N  Simulate N ticks headless and fail if any tick allocates" << endl;
         cout << "\nControls:\n";
         cout << "  W/S or Up/Down - Move Paddle up/down\n";
         cout << "  A/D or Left/Right - Move Paddle left/right\n";
+        cout << "  K - Save the game\n";
         cout << "  Q - Quit to menu\n";
         cout << "  R - Rotate\n";
     } else if (arg == "-v" || arg == "--version") {
@@ -39,19 +111,219 @@ void showInfo(const string& arg, const string& programName) {
 int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "");
 
-    if (argc > 1) {
-        showInfo(argv[1], argv[0]);
-        return 0;
+    string replayPath;
+    int replaySpeed = 1;
+    int seekTick = 0;
+    bool record = true;
+    bool host = false;
+    size_t hostSessions = 0;
+    int hostSeconds = 0;            // 0 = the mode's default
+    bool swarm = false;
+    size_t swarmGhosts = 0;
+    int pathsSize = 0;
+    size_t hostThreads = 0;
+    string broadcastPath;
+    string spectatePath;
+    string logPath;
+    string strategyPath;
+    string savePath = "pacman.sav";
+    string resumePath;
+    string levelFile;
+    int ioBenchFrames = 0;
+    int checkTicks = 0;
+    uint64_t fuzzTicks = 0;
+    string analyzeDirectory;
+    string tournamentPath;
+    string tournamentGhosts = "builtin";
+    string tournamentPolicies = "random,greedy,evasive";
+    string tournamentLevels = "1,2";
+    int tournamentSeeds = 20;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--speed" && i + 1 < argc) {
+            string value = argv[++i];
+            replaySpeed = (value == "max") ? 0 : atoi(value.c_str());
+        } else if (arg == "--seek" && i + 1 < argc) {
+            seekTick = atoi(argv[++i]);
+        } else if (arg == "--host" && i + 1 < argc) {
+            string value = argv[++i];
+            host = true;
+            hostSessions = (value == "max") ? 0 : static_cast<size_t>(atol(value.c_str()));
+        } else if (arg == "--swarm" && i + 1 < argc) {
+            string value = argv[++i];
+            swarm = true;
+            swarmGhosts = (value == "max") ? 0 : static_cast<size_t>(atol(value.c_str()));
+        } else if (arg == "--paths" && i + 1 < argc) {
+            pathsSize = atoi(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            hostSeconds = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            hostThreads = static_cast<size_t>(atol(argv[++i]));
+        } else if (arg == "--broadcast" && i + 1 < argc) {
+            broadcastPath = argv[++i];
+        } else if (arg == "--log" && i + 1 < argc) {
+            logPath = argv[++i];
+        } else if (arg == "--strategy" && i + 1 < argc) {
+            strategyPath = argv[++i];
+        } else if (arg == "--spectate" && i + 1 < argc) {
+            spectatePath = argv[++i];
+        } else if (arg == "--check-allocs" && i + 1 < argc) {
+            checkTicks = atoi(argv[++i]);
+        } else if (arg == "--tournament" && i + 1 < argc) {
+            tournamentPath = argv[++i];
+        } else if (arg == "--ghosts" && i + 1 < argc) {
+            tournamentGhosts = argv[++i];
+        } else if (arg == "--policies" && i + 1 < argc) {
+            tournamentPolicies = argv[++i];
+        } else if (arg == "--levels" && i + 1 < argc) {
+            tournamentLevels = argv[++i];
+        } else if (arg == "--seeds" && i + 1 < argc) {
+            tournamentSeeds = atoi(argv[++i]);
+        } else if (arg == "--fuzz" && i + 1 < argc) {
+            fuzzTicks = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--analyze" && i + 1 < argc) {
+            analyzeDirectory = argv[++i];
+        } else if (arg == "--save" && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (arg == "--io" && i + 1 < argc) {
+            IoBackend backend;
+            if (!parseIoBackend(argv[++i], backend)) {
+                cerr << "Error: --io takes write or uring" << endl;
+                return 1;
+            }
+            setIoBackend(backend);
+        } else if (arg == "--io-bench" && i + 1 < argc) {
+            ioBenchFrames = atoi(argv[++i]);
+        } else if (arg == "--level-file" && i + 1 < argc) {
+            levelFile = argv[++i];
+        } else if (arg == "--resume" && i + 1 < argc) {
+            resumePath = argv[++i];
+        } else if (arg == "--no-record") {
+            record = false;
+        } else {
+            showInfo(arg, argv[0]);
+            return 0;
+        }
     }
 
     signal(SIGINT, cleanup);    // CTRL + C
     signal(SIGTERM, cleanup);   // kill command
+#ifdef PACMAN_TRACE
+    signal(SIGUSR1, [](int) { TRACE_REQUEST_EXPORT(); wakeInputWait(); });   // dump trace while running
+#endif
+
+    if (checkTicks > 0) {
+        return runAllocationCheck(checkTicks, 1);
+    }
+
+    if (!analyzeDirectory.empty()) {
+        int result = runReplayAnalytics(analyzeDirectory, hostThreads);
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
+
+    if (fuzzTicks > 0) {
+        int result = runFuzzer(fuzzTicks, hostThreads, "fuzz-failure.pmr");
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
+
+    if (pathsSize > 0) {
+        return runPathBenchmark(pathsSize, 1000);
+    }
+
+    if (ioBenchFrames > 0) {
+        return runIoBenchmark(ioBenchFrames);
+    }
+
+    if (!tournamentPath.empty()) {
+        TournamentConfig config;
+        config.outPath = tournamentPath;
+        config.strategies = splitList(tournamentGhosts);
+        vector<string> policies = splitList(tournamentPolicies);
+        for (size_t i = 0; i < policies.size(); ++i) {
+            PacmanPolicy policy;
+            if (!parsePolicy(policies[i], policy)) {
+                cerr << "Error: unknown policy " << policies[i] << endl;
+                return 1;
+            }
+            config.policies.push_back(policy);
+        }
+        vector<string> levels = splitList(tournamentLevels);
+        for (size_t i = 0; i < levels.size(); ++i) config.levels.push_back(atoi(levels[i].c_str()));
+        config.seeds = tournamentSeeds;
+        config.threads = hostThreads;
+        int result = runTournament(config);
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
+
+    if (swarm) {
+        int result = runSwarmBenchmark(swarmGhosts, hostSeconds > 0 ? hostSeconds : 1, hostThreads, strategyPath);
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
+
+    if (host) {
+        int result = runSessionHost(hostSessions, hostSeconds > 0 ? hostSeconds : 5, hostThreads);
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
+
+    if (!replayPath.empty() && replaySpeed <= 0) {
+        int result = runReplay(replayPath, 0, seekTick);
+        TRACE_EXPORT(PACMAN_TRACE_FILE);
+        return result;
+    }
 
     setTerminalNonBlocking();
+    installResizeHandler();
+
+    if (!spectatePath.empty()) {
+        int result = runSpectator(spectatePath);
+        restoreTerminalBlocking();
+        return result;
+    }
+
+    if (!replayPath.empty()) {
+        int result = runReplay(replayPath, replaySpeed, seekTick);
+        restoreTerminalBlocking();
+        showCursor();
+        return result;
+    }
 
     try {
         Game game;
+        if (!record) {
+            game.setReplayDirectory("");
+        }
+        if (!broadcastPath.empty() && !game.startBroadcast(broadcastPath)) {
+            cerr << "Error: cannot listen on " << broadcastPath << endl;
+            return 1;
+        }
+        if (!logPath.empty() && !game.startLog(logPath)) {
+            cerr << "Error: cannot write log " << logPath << endl;
+            return 1;
+        }
+        string error;
+        if (!strategyPath.empty() && !game.loadStrategy(strategyPath, error)) {
+            cerr << "Error: cannot load strategy " << strategyPath << ": " << error << endl;
+            return 1;
+        }
+        if (!levelFile.empty() && !game.watchLevelFile(levelFile, error)) {
+            cerr << "Error: " << error << endl;
+            return 1;
+        }
+        game.setSavePath(savePath);
+        if (!resumePath.empty() && !game.loadSave(resumePath, error)) {
+            cerr << "Error: cannot resume " << resumePath << ": " << error << endl;
+            return 1;
+        }
+        liveGame = &game;
         game.start();
+        liveGame = nullptr;
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
         return 1;
@@ -62,6 +334,7 @@ int main(int argc, char* argv[]) {
 
     restoreTerminalBlocking();
     showCursor();
+    TRACE_EXPORT(PACMAN_TRACE_FILE);
 
     return 0;
 }
@@ -1,112 +1,79 @@
 #include "map.hpp"
 #include "ultils.hpp"
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
 
-Map::Map() : maxDots(0), currentLevel(1) {
+Map::Map() : currentLevel(1) {
     loadLevel(1);
 }
 
-Map::Map(int level) : maxDots(0), currentLevel(level) {
+Map::Map(int level) : currentLevel(level) {
     loadLevel(level);
 }
 
 void Map::loadLevel(int level) {
+    shared_ptr<const LevelData> data = LevelData::acquire(level);
+    if (data) {
+        loadLevel(data);
+        return;
+    }
     currentLevel = level;
-    if (level == 1) {
-        loadLevel1();
-    } else if (level == 2) {
-        loadLevel2();
+    if (!levelData) {
+        levelData = LevelData::acquire(1);
     }
+    resetRows();
 }
 
-void Map::loadLevel1() {
-    char map1[MAP_HEIGHT][MAP_WIDTH] = {
-        // "╔═══╦═════════════════╦═══╗",
-        // "║...║.................║...║",
-        // "║.O.║.══╦══.....══╦══.║.O.║",
-        // "║.......║...╔.....║.......║",
-        // "╠══###.#║###║═════║#.####.║",
-        // "║......#.....#.....#......║",
-        // "╠══##.╔####.#.═════.═════╝",
-        // "║    #.#           #.#     ",
-        // "║═════.#           #.═════#",
-        // "║.....#             #.....║",
-        // "═════#.#           #.═════╝",
-        // "     #.#           #.#     ",
-        // "╔═════.#..═════##..#.#####║",
-        // "║............#............║",
-        // "║.####.#####.#.#####.####.║",
-        // "║O...#.......<.......#...O║",
-        // "║###.#.#.#########.#.#.###║",
-        // "║......#.....#.....#......║",
-        // "║.####.#####.#.#####.####.║",
-        // "║.........................║",
-        // "╚═════════════════════════╝"
-
-        "###########################",
-        "#O..........###..........O#",
-        "#....#################....#",
-        "#.........................#",
-        "#.######.#########.######.#",
-        "[......#.....#.....#......]",
-        "######....#######....######",
-        "#O.....#           #.....O#",
-        "######.#           #.######",
-        "[......             ......]",
-        "######.#           #.######",
-        "#O.....#           #.....O#",
-        "######.#..#######..#.######",
-        "[.........................]",
-        "#.####.#############.####.#",
-        "#............<............#",
-        "######...###...###...######",
-        "#....#...###...###...#....#",
-        "#O.......................O#",
-        "#..........#####..........#",
-        "###########################"
-    };
-    
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            level[y][x] = map1[y][x];
-        }
+void Map::loadLevel(const shared_ptr<const LevelData>& data) {
+    currentLevel = data->getId();
+    levelData = data;
+    resetRows();
+}
+
+void Map::resetRows() {
+    // Point every row back at the shared initial state; private copies are
+    // made lazily by setCell into slots of one block that survives for the next level
+    int h = levelData->getHeight();
+    rows.resize(h);
+    ownedCells.resize(static_cast<size_t>(h) * getWidth());
+    for (int y = 0; y < h; ++y) {
+        rows[y] = levelData->initialRow(y);
     }
-    maxDots = 210;
-}
-
-void Map::loadLevel2() {
-    char map2[MAP_HEIGHT][MAP_WIDTH] = {
-        "###########################",
-        "#O..........###..........O#",
-        "#....#################....#",
-        "#.........................#",
-        "#.######.#########.######.#",
-        "[......#.....#.....#......]",
-        "######....#######....######",
-        "#O.....#           #.....O#",
-        "######.#           #.######",
-        "[......             ......]",
-        "######.#           #.######",
-        "#O.....#           #.....O#",
-        "######.#..#######..#.######",
-        "[.........................]",
-        "#.####.#############.####.#",
-        "#............<............#",
-        "######...###...###...######",
-        "#....#...###...###...#....#",
-        "#O.......................O#",
-        "#..........#####..........#",
-        "###########################"
-    };
-    
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            level[y][x] = map2[y][x];
+}
+
+int Map::reloadLevel(const shared_ptr<const LevelData>& data, const LevelData::Region& changed) {
+    shared_ptr<const LevelData> old = levelData;
+    levelData = data;
+    int dotsAdded = 0;
+    for (int y = 0; y < getHeight(); ++y) {
+        bool shared = rows[y] == old->initialRow(y);
+        if (y >= changed.top && y <= changed.bottom) {
+            const char* before = old->initialRow(y);
+            const char* after = data->initialRow(y);
+            for (int x = changed.left; x <= changed.right; ++x) {
+                if (before[x] == after[x]) continue;
+                dotsAdded += LevelData::countsTowardClear(after[x]) - LevelData::countsTowardClear(rows[y][x]);
+                if (!shared) ownedCells[static_cast<size_t>(y) * getWidth() + x] = after[x];
+            }
         }
+        if (shared) rows[y] = data->initialRow(y);
     }
-    maxDots = 251;
+    return dotsAdded;
+}
+
+char* Map::writableRow(int y) {
+    char* own = ownedCells.data() + static_cast<size_t>(y) * getWidth();
+    if (rows[y] != own) {
+        copy(rows[y], rows[y] + getWidth(), own);
+        rows[y] = own;
+    }
+    return own;
+}
+
+size_t Map::getOwnedBytes() const {
+    return sizeof(*this) + rows.capacity() * sizeof(const char*) + ownedCells.capacity();
 }
 
 void Map::reset() {
@@ -115,17 +82,17 @@ void Map::reset() {
 
 char Map::getCell(int y, int x) const {
     if (y < 0 || y >= getHeight() || x < 0 || x >= getWidth()) return '#';
-    return level[y][x];
+    return rows[y][x];
 }
 
 void Map::setCell(int y, int x, char c) {
-    if (isValidPosition(y, x)) {
-        level[y][x] = c;
+    if (isValidPosition(y, x) && rows[y][x] != c) {
+        writableRow(y)[x] = c;
     }
 }
 
 bool Map::isValidPosition(int y, int x) const {
-    return y >= 0 && y < MAP_HEIGHT && x >= 0 && x < MAP_WIDTH;
+    return levelData->contains(y, x);
 }
 
 bool Map::isWall(int y, int x) const {
@@ -156,18 +123,18 @@ bool Map::isPacman(int y, int x) const {
 }
 
 void Map::handlePortal(int& y, int& x) const {
-    char cell = getCell(y, x);
-    if (cell == '[') {
-        x = 26; // Teleport to right portal
-    } else if (cell == ']') {
-        x = 0;  // Teleport to left portal
+    // Portal pairs ('[' <-> ']' on the same row) are precomputed per level
+    int exitY, exitX;
+    if (levelData->portalExit(y, x, exitY, exitX)) {
+        y = exitY;
+        x = exitX;
     }
 }
 
-string Map::renderCell(int y, int x) const {
+const char* Map::renderCell(int y, int x) const {
     char cell = getCell(y, x);
     switch(cell) {
-        case '#': return BLOCK_FULL; // Wall - █ (full UTF-8 string)
+        case '#': return BLOCK_FULL; // Wall - █ (full UTF-8 sequence)
         case '.': return ".";      // Dot
         case 'O': return "o";      // Super Pellet
         case '[': return "[";      // Left Portal
@@ -177,8 +144,8 @@ string Map::renderCell(int y, int x) const {
 }
 
 void Map::display() const {
-    for (int y = 0; y < MAP_HEIGHT; y++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
+    for (int y = 0; y < getHeight(); y++) {
+        for (int x = 0; x < getWidth(); x++) {
             cout << renderCell(y, x);
         }
         cout << endl;
@@ -0,0 +1,33 @@
+#include "message.hpp"
+
+using namespace std;
+
+static const char* const MESSAGE_TEXT[] = {
+    "Round start!",
+    "Super mode is now active!",
+    "Super mode is now over.",
+    "You were eaten by a ghost! You lost a life. :(",
+    "You ate a ghost! +100 SCORE!",
+    "Game saved.",
+    "Could not write the save file.",
+    "Level reloaded.",
+    "Level file has errors; kept the old layout.",
+};
+
+static_assert(sizeof(MESSAGE_TEXT) / sizeof(MESSAGE_TEXT[0]) == static_cast<size_t>(MessageId::COUNT),
+              "one text per MessageId");
+
+const char* messageText(MessageId id) {
+    size_t index = static_cast<size_t>(id);
+    return index < static_cast<size_t>(MessageId::COUNT) ? MESSAGE_TEXT[index] : "";
+}
+
+bool messageFromText(const string& text, MessageId& id) {
+    for (size_t i = 0; i < static_cast<size_t>(MessageId::COUNT); ++i) {
+        if (text == MESSAGE_TEXT[i]) {
+            id = static_cast<MessageId>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -47,7 +47,7 @@ void Pacman::update(Map& map, Game& game) {
     
     char nextChar = map.getCell(newY, newX);
     
-    if (canMove(nextChar, map, game)) {
+    if (canMove(nextChar, newY, newX, map, game)) {
         posY = newY;
         posX = newX;
         
@@ -61,20 +61,17 @@ void Pacman::update(Map& map, Game& game) {
     map.setCell(posY, posX, character);
 }
 
-bool Pacman::canMove(char nextChar, Map& map, Game& game) {
+// Scoring, lives and messages are the game's business: only report what happened
+bool Pacman::canMove(char nextChar, int y, int x, Map& map, Game& game) {
     switch(nextChar) {
         case 'M': case 'W': case 'Y': case 'U': // Ghost
-            handleCollision(nextChar, map, game);
+            handleCollision(nextChar, y, x, map, game);
             return false;
         case 'O': // Super Pellet
-            game.setSuperMode(true);
-            game.setMessage("Super mode is now active!");
-            // play_sound("assets/pac_interm.wav");
+            game.emit(GameEventType::PELLET_EATEN, y, x);
             return true;
         case '.': // Dot
-            // play_sound("assets/pac_munch.wav");
-            game.incrementDotsEaten();
-            game.incrementScore();
+            game.emit(GameEventType::DOT_EATEN, y, x);
             return true;
         case '#': // Wall
             return false;
@@ -85,18 +82,14 @@ bool Pacman::canMove(char nextChar, Map& map, Game& game) {
     }
 }
 
-void Pacman::handleCollision(char ghostChar, Map& map, Game& game) {
+void Pacman::handleCollision(char ghostChar, int y, int x, Map& map, Game& game) {
     if (!game.isSuperMode()) {
         // Pacman gets eaten
-        game.setMessage("You were eaten by a ghost! You lost a life. :(");
-        // play_sound("assets/pac_death.wav");
-        game.decrementLives();
+        game.emit(GameEventType::PACMAN_DIED, y, x, ghostChar);
         die();
     } else {
         // Pacman eats ghost
-        game.setMessage("You ate a ghost! +100 SCORE!");
-        // play_sound("assets/pac_eatghost.wav");
-        game.setScore(game.getScore() + 100);
+        game.emit(GameEventType::GHOST_EATEN, y, x, ghostChar);
         // Ghost will be reset by the ghost class
     }
 }
@@ -0,0 +1,750 @@
+#include "pathfinder.hpp"
+#include "rng.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+const int HierarchicalPathfinder::DEFAULT_CLUSTER_SIZE;
+const int HierarchicalPathfinder::MIN_LEVEL_CELLS;
+const size_t HierarchicalPathfinder::ROUTE_CACHE_LIMIT;
+const int HierarchicalPathfinder::HEURISTIC_PERCENT;
+const int HierarchicalPathfinder::SEARCH_BUDGET;
+const uint16_t HierarchicalPathfinder::UNREACHED;
+
+HierarchicalPathfinder::HierarchicalPathfinder(const LevelData& level, int size)
+    : width(level.getWidth()), height(level.getHeight()), clusterSize(max(size, 2)),
+      cacheHits(0), cacheMisses(0), cutShort(0), bfsStamp(0), searchStamp(0) {
+    clustersX = (width + clusterSize - 1) / clusterSize;
+    clustersY = (height + clusterSize - 1) / clusterSize;
+    size_t cells = static_cast<size_t>(width) * height;
+    size_t clusters = static_cast<size_t>(clustersX) * clustersY;
+
+    open.resize(cells);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            open[static_cast<size_t>(y) * width + x] = level.terrainAt(y, x) == LevelData::FLOOR ? 1 : 0;
+        }
+    }
+    nodeAt.assign(cells, -1);
+    cellStamp.assign(cells, 0);
+    cellDist.resize(cells);
+    cellParent.resize(cells);
+    cellQueue.resize(cells);
+    clusterNodes.resize(clusters);
+    eastBorders.resize(clusters);
+    southBorders.resize(clusters);
+
+    for (size_t c = 0; c < clusters; ++c) {
+        buildBorder(static_cast<int>(c), true);
+        buildBorder(static_cast<int>(c), false);
+    }
+    for (size_t c = 0; c < clusters; ++c) {
+        buildIntraEdges(static_cast<int>(c));
+    }
+}
+
+bool HierarchicalPathfinder::suits(const LevelData& level) {
+    return level.getHeight() * level.getWidth() >= MIN_LEVEL_CELLS;
+}
+
+int HierarchicalPathfinder::clusterOf(int cell) const {
+    return (cell / width) / clusterSize * clustersX + (cell % width) / clusterSize;
+}
+
+int HierarchicalPathfinder::localIndex(int cell) const {
+    return (cell / width) % clusterSize * clusterSize + (cell % width) % clusterSize;
+}
+
+// The A* heuristic: Manhattan distance inflated by HEURISTIC_PERCENT, which
+// trades a little route length for far fewer expansions in winding mazes
+int HierarchicalPathfinder::estimate(int from, int to) const {
+    return (abs(from / width - to / width) + abs(from % width - to % width)) * HEURISTIC_PERCENT / 100;
+}
+
+void HierarchicalPathfinder::clusterBounds(int cluster, int& y0, int& x0, int& y1, int& x1) const {
+    y0 = cluster / clustersX * clusterSize;
+    x0 = cluster % clustersX * clusterSize;
+    y1 = min(y0 + clusterSize, height);
+    x1 = min(x0 + clusterSize, width);
+}
+
+size_t HierarchicalPathfinder::getEdgeCount() const {
+    size_t edges = 0;
+    for (const auto& node : nodes) edges += node.edges.size();
+    return edges;
+}
+
+size_t HierarchicalPathfinder::getTableBytes() const {
+    size_t bytes = 0;
+    for (const auto& node : nodes) bytes += node.dist.capacity() * sizeof(uint16_t);
+    return bytes;
+}
+
+// ---------------------------------------------------------------------------
+// Abstract graph
+// ---------------------------------------------------------------------------
+
+int HierarchicalPathfinder::acquireNode(int cell) {
+    int id = nodeAt[cell];
+    if (id < 0) {
+        if (!freeNodes.empty()) {
+            id = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            id = static_cast<int>(nodes.size());
+            nodes.push_back(Node());
+        }
+        nodes[id].cell = cell;
+        nodes[id].refs = 0;
+        nodes[id].edges.clear();
+        nodeAt[cell] = id;
+        clusterNodes[clusterOf(cell)].push_back(id);
+    }
+    ++nodes[id].refs;
+    return id;
+}
+
+void HierarchicalPathfinder::releaseNode(int id) {
+    Node& node = nodes[id];
+    if (--node.refs > 0) return;
+    for (const auto& edge : node.edges) {
+        removeEdge(edge.to, id, edge.inter);
+    }
+    node.edges.clear();
+    vector<int32_t>& members = clusterNodes[clusterOf(node.cell)];
+    members.erase(find(members.begin(), members.end(), id));
+    nodeAt[node.cell] = -1;
+    freeNodes.push_back(id);
+}
+
+void HierarchicalPathfinder::removeEdge(int from, int to, bool inter) {
+    vector<Edge>& edges = nodes[from].edges;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (edges[i].to == to && edges[i].inter == inter) {
+            edges.erase(edges.begin() + i);
+            return;
+        }
+    }
+}
+
+// Transitions across the east or south side of a cluster: one in the middle of
+// each walkable run, or one at each end of a long run
+void HierarchicalPathfinder::buildBorder(int cluster, bool east) {
+    int y0, x0, y1, x1;
+    clusterBounds(cluster, y0, x0, y1, x1);
+    if (east ? x1 >= width : y1 >= height) return;
+
+    vector<Transition>& border = east ? eastBorders[cluster] : southBorders[cluster];
+    const int length = east ? y1 - y0 : x1 - x0;
+    const int step = east ? 1 : width;                       // from a cell to its neighbour across
+    const int first = east ? y0 * width + (x1 - 1) : (y1 - 1) * width + x0;
+    const int along = east ? width : 1;
+
+    auto addTransition = [&](int i) {
+        int a = first + i * along;
+        Transition t;
+        t.a = acquireNode(a);
+        t.b = acquireNode(a + step);
+        Edge edge;
+        edge.cost = 1;
+        edge.inter = true;
+        edge.to = t.b;
+        nodes[t.a].edges.push_back(edge);
+        edge.to = t.a;
+        nodes[t.b].edges.push_back(edge);
+        border.push_back(t);
+    };
+
+    int runStart = -1;
+    for (int i = 0; i <= length; ++i) {
+        int cell = first + i * along;
+        bool passable = i < length && open[cell] && open[cell + step];
+        if (passable && runStart < 0) {
+            runStart = i;
+        } else if (!passable && runStart >= 0) {
+            int runLength = i - runStart;
+            if (runLength < 6) {
+                addTransition(runStart + runLength / 2);
+            } else {
+                addTransition(runStart);
+                addTransition(i - 1);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+void HierarchicalPathfinder::clearBorder(int cluster, bool east) {
+    vector<Transition>& border = east ? eastBorders[cluster] : southBorders[cluster];
+    for (const auto& t : border) {
+        removeEdge(t.a, t.b, true);
+        removeEdge(t.b, t.a, true);
+        releaseNode(t.a);
+        releaseNode(t.b);
+    }
+    border.clear();
+}
+
+void HierarchicalPathfinder::buildIntraEdges(int cluster) {
+    const vector<int32_t>& members = clusterNodes[cluster];
+    for (int32_t id : members) {
+        vector<Edge>& edges = nodes[id].edges;
+        edges.erase(remove_if(edges.begin(), edges.end(), [](const Edge& e) { return !e.inter; }), edges.end());
+    }
+    int y0, x0, y1, x1;
+    clusterBounds(cluster, y0, x0, y1, x1);
+    for (int32_t id : members) {
+        clusterBfs(cluster, nodes[id].cell, -1);
+        vector<uint16_t>& dist = nodes[id].dist;
+        dist.assign(static_cast<size_t>(clusterSize) * clusterSize, UNREACHED);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                if (reached(y * width + x)) dist[(y - y0) * clusterSize + (x - x0)] = static_cast<uint16_t>(cellDist[y * width + x]);
+            }
+        }
+        for (int32_t other : members) {
+            if (other == id || !reached(nodes[other].cell)) continue;
+            Edge edge;
+            edge.to = other;
+            edge.cost = cellDist[nodes[other].cell];
+            edge.inter = false;
+            nodes[id].edges.push_back(edge);
+        }
+    }
+}
+
+void HierarchicalPathfinder::setWalkable(int y, int x, bool walkable) {
+    int cell = y * width + x;
+    if ((open[cell] != 0) == walkable) return;
+
+    // The cell's cluster and the four around it hold every node and edge that
+    // can depend on it
+    int cluster = clusterOf(cell);
+    int cx = cluster % clustersX;
+    int cy = cluster / clustersX;
+    int affected[5];
+    int count = 0;
+    affected[count++] = cluster;
+    if (cx > 0) affected[count++] = cluster - 1;
+    if (cx + 1 < clustersX) affected[count++] = cluster + 1;
+    if (cy > 0) affected[count++] = cluster - clustersX;
+    if (cy + 1 < clustersY) affected[count++] = cluster + clustersX;
+
+    // Drop cached routes through those clusters while their node ids still mean something
+    for (auto it = routeCache.begin(); it != routeCache.end();) {
+        bool stale = false;
+        for (int32_t id : it->second.nodes) {
+            int c = clusterOf(nodes[id].cell);
+            stale = stale || find(affected, affected + count, c) != affected + count;
+        }
+        int fromCluster = static_cast<int>(it->first >> 32);
+        int toCluster = static_cast<int>(it->first & 0xFFFFFFFFu);
+        stale = stale || find(affected, affected + count, fromCluster) != affected + count ||
+                find(affected, affected + count, toCluster) != affected + count;
+        it = stale ? routeCache.erase(it) : ++it;
+    }
+
+    clearBorder(cluster, true);
+    clearBorder(cluster, false);
+    if (cx > 0) clearBorder(cluster - 1, true);
+    if (cy > 0) clearBorder(cluster - clustersX, false);
+
+    open[cell] = walkable ? 1 : 0;
+
+    buildBorder(cluster, true);
+    buildBorder(cluster, false);
+    if (cx > 0) buildBorder(cluster - 1, true);
+    if (cy > 0) buildBorder(cluster - clustersX, false);
+    for (int i = 0; i < count; ++i) {
+        buildIntraEdges(affected[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+// BFS from 'source' that never leaves 'cluster'; stops early once 'stopAt' is reached
+void HierarchicalPathfinder::clusterBfs(int cluster, int source, int stopAt) {
+    int y0, x0, y1, x1;
+    clusterBounds(cluster, y0, x0, y1, x1);
+    if (++bfsStamp == 0) {
+        fill(cellStamp.begin(), cellStamp.end(), 0);
+        bfsStamp = 1;
+    }
+
+    size_t head = 0, tail = 0;
+    cellStamp[source] = bfsStamp;
+    cellDist[source] = 0;
+    cellParent[source] = -1;
+    cellQueue[tail++] = source;
+    while (head < tail) {
+        int cell = cellQueue[head++];
+        if (cell == stopAt) return;
+        int y = cell / width;
+        int x = cell % width;
+        int around[4];
+        int n = 0;
+        if (y > y0) around[n++] = cell - width;
+        if (y + 1 < y1) around[n++] = cell + width;
+        if (x > x0) around[n++] = cell - 1;
+        if (x + 1 < x1) around[n++] = cell + 1;
+        for (int i = 0; i < n; ++i) {
+            int next = around[i];
+            if (!open[next] || cellStamp[next] == bfsStamp) continue;
+            cellStamp[next] = bfsStamp;
+            cellDist[next] = cellDist[cell] + 1;
+            cellParent[next] = cell;
+            cellQueue[tail++] = next;
+        }
+    }
+}
+
+// Cells from 'cell' down node 'id's distance table to the node's own cell,
+// not counting 'cell' itself. False if the node can't reach 'cell' inside
+// their cluster.
+bool HierarchicalPathfinder::walkToNode(int cell, int id, vector<int>& path) const {
+    int cluster = clusterOf(cell);
+    if (cluster != clusterOf(nodes[id].cell)) return false;
+    const vector<uint16_t>& dist = nodes[id].dist;
+    uint16_t d = dist[localIndex(cell)];
+    if (d == UNREACHED) return false;
+    int y0, x0, y1, x1;
+    clusterBounds(cluster, y0, x0, y1, x1);
+    while (d > 0) {
+        int y = cell / width;
+        int x = cell % width;
+        int around[4];
+        int n = 0;
+        if (y > y0) around[n++] = cell - width;
+        if (y + 1 < y1) around[n++] = cell + width;
+        if (x > x0) around[n++] = cell - 1;
+        if (x + 1 < x1) around[n++] = cell + 1;
+        for (int i = 0; i < n; ++i) {
+            if (dist[localIndex(around[i])] == d - 1) {
+                cell = around[i];
+                break;
+            }
+        }
+        path.push_back(cell);
+        --d;
+    }
+    return true;
+}
+
+// A* over the abstract graph from the nodes that reach 'from' in its cluster
+// to those that reach 'to' in its cluster. A bounded search that runs out of
+// budget returns the route to the node it got closest to 'to', marked
+// incomplete.
+bool HierarchicalPathfinder::route(int from, int to, Route& result, bool bounded) {
+    result.nodes.clear();
+    result.complete = false;
+    int fromLocal = localIndex(from);
+    int toLocal = localIndex(to);
+
+    goalLinks.clear();
+    for (int32_t id : clusterNodes[clusterOf(to)]) {
+        uint16_t d = nodes[id].dist[toLocal];
+        if (d != UNREACHED) goalLinks.push_back(make_pair(id, static_cast<int32_t>(d)));
+    }
+    if (goalLinks.empty()) return false;
+
+    if (nodeStamp.size() < nodes.size()) {
+        nodeStamp.resize(nodes.size(), 0);
+        nodeCost.resize(nodes.size());
+        nodeParent.resize(nodes.size());
+    }
+    if (++searchStamp == 0) {
+        fill(nodeStamp.begin(), nodeStamp.end(), 0);
+        searchStamp = 1;
+    }
+
+    // Ordered by f, then by h so that among equal estimates the search keeps
+    // going from the node nearest the goal instead of widening
+    typedef pair<int64_t, int32_t> Entry;
+    auto key = [](int cost, int h) { return (static_cast<int64_t>(cost + h) << 32) | h; };
+    greater<Entry> later;
+    heap.clear();
+    for (int32_t id : clusterNodes[clusterOf(from)]) {
+        uint16_t d = nodes[id].dist[fromLocal];
+        if (d == UNREACHED) continue;
+        nodeStamp[id] = searchStamp;
+        nodeCost[id] = d;
+        nodeParent[id] = -1;
+        heap.push_back(Entry(key(d, estimate(nodes[id].cell, to)), id));
+        push_heap(heap.begin(), heap.end(), later);
+    }
+
+    int bestCost = INT_MAX;
+    int bestNode = -1;
+    int closestNode = -1;
+    int closestH = INT_MAX;
+    int expanded = 0;
+    bool outOfBudget = false;
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), later);
+        Entry top = heap.back();
+        heap.pop_back();
+        if ((top.first >> 32) >= bestCost) break;
+        int id = top.second;
+        int h = estimate(nodes[id].cell, to);
+        if (top.first != key(nodeCost[id], h)) continue;   // stale entry
+        if (bounded && expanded == SEARCH_BUDGET) {
+            outOfBudget = true;
+            break;
+        }
+        ++expanded;
+        if (h < closestH) {
+            closestH = h;
+            closestNode = id;
+        }
+
+        for (const auto& link : goalLinks) {
+            if (link.first == id && nodeCost[id] + link.second < bestCost) {
+                bestCost = nodeCost[id] + link.second;
+                bestNode = id;
+            }
+        }
+        for (const auto& edge : nodes[id].edges) {
+            int cost = nodeCost[id] + edge.cost;
+            if (nodeStamp[edge.to] == searchStamp && nodeCost[edge.to] <= cost) continue;
+            nodeStamp[edge.to] = searchStamp;
+            nodeCost[edge.to] = cost;
+            nodeParent[edge.to] = id;
+            heap.push_back(Entry(key(cost, estimate(nodes[edge.to].cell, to)), edge.to));
+            push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+
+    int last = bestNode;
+    if (last < 0 && outOfBudget) {
+        last = closestNode;
+        ++cutShort;
+    }
+    if (last < 0) return false;
+    result.complete = bestNode >= 0;
+    for (int id = last; id >= 0; id = nodeParent[id]) {
+        result.nodes.push_back(id);
+    }
+    reverse(result.nodes.begin(), result.nodes.end());
+    return true;
+}
+
+// Turn an abstract route into cells by walking down each node's distance
+// table; stops after 'segments' hops that moved. False if a hop no longer
+// connects. A route cut short ends at its last node rather than at 'to'.
+bool HierarchicalPathfinder::refine(int from, int to, const Route& route, vector<int>& path, size_t segments) {
+    path.clear();
+    path.push_back(from);
+    size_t done = 0;
+    for (size_t i = 0; i < route.nodes.size() && done < segments; ++i) {
+        int a = path.back();
+        int b = nodes[route.nodes[i]].cell;
+        if (a == b) continue;
+        if (abs(a / width - b / width) + abs(a % width - b % width) == 1) {
+            path.push_back(b);
+        } else if (!walkToNode(a, route.nodes[i], path)) {
+            return false;
+        }
+        ++done;
+    }
+    if (route.complete && done < segments && path.back() != to) {
+        // The last leg is walked from 'to' back to the node, then turned round
+        size_t mark = path.size();
+        path.push_back(to);
+        if (!walkToNode(to, route.nodes.back(), path)) return false;
+        path.pop_back();
+        reverse(path.begin() + mark, path.end());
+    }
+    return true;
+}
+
+bool HierarchicalPathfinder::search(int from, int to, vector<int>& path, size_t segments, bool bounded,
+                                    bool useCache) {
+    path.clear();
+    if (!open[from] || !open[to]) return false;
+    if (from == to) {
+        path.push_back(from);
+        return true;
+    }
+
+    int fromCluster = clusterOf(from);
+    int toCluster = clusterOf(to);
+    if (fromCluster == toCluster) {
+        clusterBfs(fromCluster, from, to);
+        if (reached(to)) {
+            for (int cell = to; cell != -1; cell = cellParent[cell]) {
+                path.push_back(cell);
+            }
+            reverse(path.begin(), path.end());
+            return true;
+        }
+        // Joined only through other clusters: fall through to the abstract graph
+    }
+
+    uint64_t key = (static_cast<uint64_t>(fromCluster) << 32) | static_cast<uint32_t>(toCluster);
+    if (bounded && useCache) {
+        auto cached = routeCache.find(key);
+        if (cached != routeCache.end() && refine(from, to, cached->second, path, segments)) {
+            ++cacheHits;
+            return true;
+        }
+    }
+
+    if (!route(from, to, scratchRoute, bounded)) {
+        path.clear();
+        return false;
+    }
+    if (useCache) {
+        ++cacheMisses;
+        if (routeCache.size() >= ROUTE_CACHE_LIMIT) routeCache.clear();
+        routeCache[key] = scratchRoute;
+    }
+    return refine(from, to, scratchRoute, path, segments);
+}
+
+bool HierarchicalPathfinder::findPath(int from, int to, vector<int>& path) {
+    // A leg cut short by the budget ends nearer 'to'; carry on from there, and
+    // search without a budget if a leg got no nearer
+    path.clear();
+    int at = from;
+    bool bounded = true;
+    for (;;) {
+        if (!search(at, to, chunk, static_cast<size_t>(-1), bounded, true)) {
+            path.clear();
+            return false;
+        }
+        path.insert(path.end(), chunk.begin() + (path.empty() ? 0 : 1), chunk.end());
+        if (path.back() == to) return true;
+        bounded = estimate(path.back(), to) < estimate(at, to);
+        at = path.back();
+    }
+}
+
+int HierarchicalPathfinder::nextStep(int from, int to, bool useCache) {
+    if (!search(from, to, stepPath, 1, true, useCache) || stepPath.size() < 2) return from;
+    return stepPath[1];
+}
+
+// Searches its own grid rather than the level's: setWalkable can change it
+int HierarchicalPathfinder::nearestWalkable(int y, int x) const {
+    return LevelData::findNearest(open.data(), height, width, 1, y, x);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+// Depth-first maze on the odd cells, then a few walls knocked out so there is
+// more than one way round
+static vector<string> generateMaze(int size, Rng& rng) {
+    vector<string> rows(size, string(size, '#'));
+    int cellsY = (size - 1) / 2;
+    int cellsX = (size - 1) / 2;
+    vector<uint8_t> visited(static_cast<size_t>(cellsY) * cellsX, 0);
+    vector<int> stack;
+    stack.push_back(0);
+    visited[0] = 1;
+    rows[1][1] = ' ';
+    static const int DY[4] = {-1, 1, 0, 0};
+    static const int DX[4] = {0, 0, -1, 1};
+    while (!stack.empty()) {
+        int cell = stack.back();
+        int cy = cell / cellsX;
+        int cx = cell % cellsX;
+        int options[4];
+        int count = 0;
+        for (int d = 0; d < 4; ++d) {
+            int ny = cy + DY[d];
+            int nx = cx + DX[d];
+            if (ny >= 0 && ny < cellsY && nx >= 0 && nx < cellsX && !visited[ny * cellsX + nx]) {
+                options[count++] = d;
+            }
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int d = options[rng.nextInt(count)];
+        int ny = cy + DY[d];
+        int nx = cx + DX[d];
+        visited[ny * cellsX + nx] = 1;
+        rows[2 * cy + 1 + DY[d]][2 * cx + 1 + DX[d]] = ' ';
+        rows[2 * ny + 1][2 * nx + 1] = ' ';
+        stack.push_back(ny * cellsX + nx);
+    }
+    for (int i = 0; i < size * size / 8; ++i) {
+        int y = 1 + rng.nextInt(size - 2);
+        int x = 1 + rng.nextInt(size - 2);
+        bool across = rows[y][x - 1] == ' ' && rows[y][x + 1] == ' ';
+        bool down = rows[y - 1][x] == ' ' && rows[y + 1][x] == ' ';
+        if (across || down) rows[y][x] = ' ';
+    }
+    return rows;
+}
+
+// Exact shortest path length over the whole grid, -1 if unreachable
+static int bfsDistance(const HierarchicalPathfinder& paths, int from, int to, vector<int>& dist, vector<int>& queue) {
+    int w = paths.getWidth();
+    int h = paths.getHeight();
+    fill(dist.begin(), dist.end(), -1);
+    size_t head = 0, tail = 0;
+    dist[from] = 0;
+    queue[tail++] = from;
+    while (head < tail) {
+        int cell = queue[head++];
+        if (cell == to) return dist[cell];
+        int y = cell / w, x = cell % w;
+        int around[4] = {y > 0 ? cell - w : -1, y + 1 < h ? cell + w : -1,
+                         x > 0 ? cell - 1 : -1, x + 1 < w ? cell + 1 : -1};
+        for (int next : around) {
+            if (next < 0 || !paths.isWalkable(next) || dist[next] >= 0) continue;
+            dist[next] = dist[cell] + 1;
+            queue[tail++] = next;
+        }
+    }
+    return -1;
+}
+
+static bool validPath(const HierarchicalPathfinder& paths, const vector<int>& path, int from, int to) {
+    if (path.empty() || path.front() != from || path.back() != to) return false;
+    int w = paths.getWidth();
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (!paths.isWalkable(path[i])) return false;
+        if (i > 0 && abs(path[i] / w - path[i - 1] / w) + abs(path[i] % w - path[i - 1] % w) != 1) return false;
+    }
+    return true;
+}
+
+// Sorts 'micros'; mean, p99 and max
+static void printTimes(vector<double>& micros) {
+    sort(micros.begin(), micros.end());
+    double mean = 0;
+    for (double m : micros) mean += m;
+    mean /= max<size_t>(micros.size(), 1);
+    cout << "mean " << mean << " us, p99 " << micros[micros.size() * 99 / 100] << " us, max " << micros.back() << " us";
+}
+
+int runPathBenchmark(int size, int queries) {
+    typedef chrono::steady_clock Clock;
+    size = max(size, 16) | 1;   // odd, so the maze has a wall all round
+    Rng rng(size);
+    vector<LevelData::Spawn> noGhosts;
+    shared_ptr<const LevelData> level = LevelData::fromRows(0, generateMaze(size, rng), 0, noGhosts);
+
+    vector<int> walkable;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (level->terrainAt(y, x) == LevelData::FLOOR) walkable.push_back(y * size + x);
+        }
+    }
+    auto randomCell = [&]() { return walkable[rng.nextInt(static_cast<int>(walkable.size()))]; };
+
+    Clock::time_point start = Clock::now();
+    HierarchicalPathfinder paths(*level);
+    double buildMs = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    cout << "Hierarchical pathfinding on a " << size << "x" << size << " generated maze ("
+         << paths.getClusterSize() << "x" << paths.getClusterSize() << " clusters)" << endl;
+    cout << fixed << setprecision(1);
+    cout << "  " << walkable.size() << " walkable cells; abstract graph " << paths.getNodeCount()
+         << " nodes, " << paths.getEdgeCount() << " edges, " << paths.getTableBytes() / (1024.0 * 1024.0)
+         << " MB of distance tables, built in " << buildMs << " ms" << endl;
+
+    vector<int> path, dist(static_cast<size_t>(size) * size), queue(dist.size());
+    int invalid = 0;
+
+    // Random pairs: query time, and route length against an exact BFS for some
+    vector<double> micros;
+    double bfsMicros = 0, stretchTotal = 0, stretchWorst = 0;
+    int compared = 0;
+    for (int q = 0; q < queries; ++q) {
+        int from = randomCell(), to = randomCell();
+        Clock::time_point t0 = Clock::now();
+        bool found = paths.findPath(from, to, path);
+        micros.push_back(chrono::duration<double, micro>(Clock::now() - t0).count());
+        if (found && !validPath(paths, path, from, to)) ++invalid;
+        if (q < 50) {
+            Clock::time_point t1 = Clock::now();
+            int exact = bfsDistance(paths, from, to, dist, queue);
+            bfsMicros += chrono::duration<double, micro>(Clock::now() - t1).count();
+            if (found != (exact >= 0)) ++invalid;
+            if (found && exact > 0) {
+                double stretch = static_cast<double>(path.size() - 1) / exact - 1.0;
+                stretchTotal += stretch;
+                stretchWorst = max(stretchWorst, stretch);
+                ++compared;
+            }
+        }
+    }
+    cout << "  " << queries << " random routes: ";
+    printTimes(micros);
+    cout << " (full BFS: " << bfsMicros / min(queries, 50) << " us)" << endl;
+    cout << "  Route length vs exact (" << compared << " queries): mean +" << 100 * stretchTotal / max(compared, 1)
+         << "%, worst +" << 100 * stretchWorst << "%" << endl;
+
+    // What a ghost or the autopilot pays per decision: the first step of a
+    // route found without the cache, one budgeted search at most
+    micros.clear();
+    uint64_t cutBefore = paths.getCutShort();
+    for (int q = 0; q < queries; ++q) {
+        int from = randomCell(), to = randomCell();
+        Clock::time_point t0 = Clock::now();
+        int step = paths.nextStep(from, to, false);
+        micros.push_back(chrono::duration<double, micro>(Clock::now() - t0).count());
+        if (from != to && (step == from || abs(step / size - from / size) + abs(step % size - from % size) != 1)) ++invalid;
+    }
+    cout << "  " << queries << " random first steps: ";
+    printTimes(micros);
+    cout << "; " << paths.getCutShort() - cutBefore << " searches cut short" << endl;
+
+    // Many chasers, one quarry: repeated cluster pairs hit the route cache
+    const int chasers = 64;
+    const int rounds = max(queries / chasers, 1) * 10;
+    vector<int> chaser(chasers);
+    for (auto& c : chaser) c = randomCell();
+    int quarry = randomCell();
+    uint64_t hitsBefore = paths.getCacheHits(), missesBefore = paths.getCacheMisses();
+    Clock::time_point t0 = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        // The quarry wanders a cell at a time, like Pacman does
+        int around[4] = {quarry - size, quarry + size, quarry - 1, quarry + 1};
+        int next = around[rng.nextInt(4)];
+        if (paths.isWalkable(next)) quarry = next;
+        for (auto& c : chaser) c = paths.nextStep(c, quarry);
+    }
+    double stepMicros = chrono::duration<double, micro>(Clock::now() - t0).count() / (rounds * chasers);
+    uint64_t hits = paths.getCacheHits() - hitsBefore, misses = paths.getCacheMisses() - missesBefore;
+    cout << "  " << chasers << " chasers x " << rounds << " rounds of nextStep: " << stepMicros
+         << " us each, route cache hit rate " << 100.0 * hits / max<uint64_t>(hits + misses, 1) << "%" << endl;
+
+    // Terrain edits rebuild a few clusters, not the graph
+    const int edits = 200;
+    t0 = Clock::now();
+    for (int e = 0; e < edits; ++e) {
+        int y = 1 + rng.nextInt(size - 2), x = 1 + rng.nextInt(size - 2);
+        paths.setWalkable(y, x, !paths.isWalkable(y * size + x));
+    }
+    double editMicros = chrono::duration<double, micro>(Clock::now() - t0).count() / edits;
+    int editInvalid = 0;
+    for (int q = 0; q < 50; ++q) {
+        int from = randomCell(), to = randomCell();
+        if (!paths.isWalkable(from) || !paths.isWalkable(to)) continue;
+        bool found = paths.findPath(from, to, path);
+        bool exists = bfsDistance(paths, from, to, dist, queue) >= 0;
+        if (found != exists || (found && !validPath(paths, path, from, to))) ++editInvalid;
+    }
+    cout << "  " << edits << " cell edits: " << editMicros << " us each (full build " << buildMs * 1000
+         << " us); " << editInvalid << " bad routes after edits" << endl;
+
+    invalid += editInvalid;
+    cout << "  " << (invalid == 0 ? "OK" : "FAILED") << endl;
+    return invalid == 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include "perf_hud.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+const int PerfCounters::LATENCY_BUCKETS;
+const int PerfHud::SAMPLE_MS;
+const size_t PerfHud::LINE_SIZE;
+
+static int64_t nowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Counters
+// ---------------------------------------------------------------------------
+
+PerfCounters::PerfCounters() : ticks(0), frames(0), frameBuildNs(0), pendingInputNs(0) {
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) latencyBuckets[i] = 0;
+}
+
+void PerfCounters::frameBuilt(int64_t buildNs) {
+    frames.fetch_add(1, memory_order_relaxed);
+    frameBuildNs.fetch_add(static_cast<uint64_t>(buildNs), memory_order_relaxed);
+}
+
+void PerfCounters::inputReceived() {
+    // Keys that arrive before the next frame share it; time from the first one
+    int64_t expected = 0;
+    pendingInputNs.compare_exchange_strong(expected, nowNs(), memory_order_relaxed);
+}
+
+void PerfCounters::frameShown() {
+    int64_t since = pendingInputNs.exchange(0, memory_order_relaxed);
+    if (since == 0) return;
+    int64_t micros = (nowNs() - since) / 1000;
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (int64_t(1) << bucket) <= micros) ++bucket;
+    latencyBuckets[bucket].fetch_add(1, memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// HUD
+// ---------------------------------------------------------------------------
+
+PerfHud::PerfHud() : counters(nullptr), writer(nullptr), mutex(nullptr), events(nullptr), published(0),
+                     running(false), stopping(false) {
+    strcpy(lines[0], "  HUD: sampling...");
+    lines[1][0] = '\0';
+}
+
+PerfHud::~PerfHud() {
+    stop();
+}
+
+void PerfHud::start(const PerfCounters& c, const TerminalWriter& w, const InstrumentedMutex& m,
+                    const EventBus& e) {
+    if (running) return;
+    counters = &c;
+    writer = &w;
+    mutex = &m;
+    events = &e;
+    eventCursor = e.subscribe();
+    stopping = false;
+    running = true;
+    sampler = thread(&PerfHud::samplerLoop, this);
+}
+
+void PerfHud::stop() {
+    if (!running) return;
+    {
+        lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopSignal.notify_all();
+    sampler.join();
+    running = false;
+}
+
+void PerfHud::appendLine(string& out) const {
+    out += lines[published.load(memory_order_acquire)];
+}
+
+void PerfHud::takeSample(Sample& sample) const {
+    sample.ticks = counters->getTicks();
+    sample.frames = counters->getFrames();
+    sample.frameBuildNs = counters->getFrameBuildNs();
+    sample.bytes = writer->getBytesWritten();
+    sample.writes = writer->getWriteCalls();
+    sample.waitNs = mutex->getWaitNs();
+    sample.dropped = writer->getFramesDropped();
+    sample.shown = writer->getFramesWritten();
+    for (int i = 0; i < PerfCounters::LATENCY_BUCKETS; ++i) {
+        sample.latency[i] = counters->getLatencyBucket(i);
+    }
+}
+
+void PerfHud::samplerLoop() {
+    const double ALPHA = 0.5;   // weight of the newest sample
+    Sample previous;
+    Sample current;
+    takeSample(previous);
+    auto previousTime = chrono::steady_clock::now();
+
+    bool primed = false;
+    double tps = 0, buildUs = 0, bytesPerFrame = 0, writesPerFrame = 0, waitUsPerSec = 0, eventsPerSec = 0;
+    GameEvent batch[64];
+    int64_t inputP99Us = 0;
+
+    unique_lock<std::mutex> lock(stopMutex);
+    while (!stopSignal.wait_for(lock, chrono::milliseconds(SAMPLE_MS), [this]() { return stopping; })) {
+        takeSample(current);
+        auto now = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(now - previousTime).count();
+        uint64_t frames = current.frames - previous.frames;
+
+        double sampleTps = (current.ticks - previous.ticks) / seconds;
+        double sampleWait = (current.waitNs - previous.waitNs) / 1000.0 / seconds;
+
+        uint64_t eventCount = 0;
+        size_t n;
+        while ((n = events->drain(eventCursor, batch, 64)) > 0) eventCount += n;
+        double sampleEvents = eventCount / seconds;
+        double sampleBuild = frames ? (current.frameBuildNs - previous.frameBuildNs) / 1000.0 / frames : buildUs;
+        uint64_t shown = current.shown - previous.shown;
+        double sampleBytes = shown ? static_cast<double>(current.bytes - previous.bytes) / shown : bytesPerFrame;
+        double sampleWrites = shown ? static_cast<double>(current.writes - previous.writes) / shown : writesPerFrame;
+
+        double alpha = primed ? ALPHA : 1.0;
+        tps += alpha * (sampleTps - tps);
+        waitUsPerSec += alpha * (sampleWait - waitUsPerSec);
+        eventsPerSec += alpha * (sampleEvents - eventsPerSec);
+        buildUs += alpha * (sampleBuild - buildUs);
+        bytesPerFrame += alpha * (sampleBytes - bytesPerFrame);
+        writesPerFrame += alpha * (sampleWrites - writesPerFrame);
+        primed = true;
+
+        // p99 of the inputs seen in this window; keep the last value when idle
+        uint64_t inputs = 0;
+        for (int i = 0; i < PerfCounters::LATENCY_BUCKETS; ++i) inputs += current.latency[i] - previous.latency[i];
+        if (inputs > 0) {
+            uint64_t target = inputs * 99 / 100;
+            uint64_t seen = 0;
+            for (int i = 0; i < PerfCounters::LATENCY_BUCKETS; ++i) {
+                seen += current.latency[i] - previous.latency[i];
+                if (seen > target) {
+                    inputP99Us = int64_t(1) << i;
+                    break;
+                }
+            }
+        }
+
+        int next = 1 - published.load(memory_order_relaxed);
+        snprintf(lines[next], LINE_SIZE,
+                 "  TPS %.1f | build %.0fus | %.1fKB/frame | %.1f writes/frame | dropped %llu | input p99 %lldms | lock wait %.0fus/s | events %.1f/s      ",
+                 tps, buildUs, bytesPerFrame / 1024.0, writesPerFrame,
+                 static_cast<unsigned long long>(current.dropped),
+                 static_cast<long long>(inputP99Us / 1000), waitUsPerSec, eventsPerSec);
+        published.store(next, memory_order_release);
+
+        previous = current;
+        previousTime = now;
+    }
+}
@@ -0,0 +1,491 @@
+#include "replay.hpp"
+#include "serialize.hpp"
+#include "game.hpp"
+#include "level.hpp"
+#include "cursor_input.hpp"
+#include "ultils.hpp"
+#include "color.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char REPLAY_MAGIC[4] = {'P', 'M', 'R', 'P'};
+static const char INDEX_MAGIC[4] = {'P', 'M', 'R', 'I'};
+static const uint8_t REPLAY_VERSION = 1;
+static const size_t TRAILER_SIZE = 4 + 4 + 8 + 4;
+
+// ---------------------------------------------------------------------------
+// Recorder
+// ---------------------------------------------------------------------------
+
+ReplayRecorder::ReplayRecorder() : file(nullptr), flushedBytes(0), tickRun(0), ticksRecorded(0),
+                                   closing(false) {
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    if (isOpen()) {
+        close();
+    }
+}
+
+bool ReplayRecorder::open(const string& filePath, int level, uint64_t seed, size_t ghostCount) {
+    if (isOpen()) close();
+
+    file = fopen(filePath.c_str(), "wb");
+    if (!file) return false;
+
+    path = filePath;
+    active.clear();
+    active.reserve(FLUSH_THRESHOLD * 2);
+    pending.clear();
+    pending.reserve(FLUSH_THRESHOLD * 2);
+    keyframes.clear();
+    keyframes.reserve(1024);    // ~2.7 hours of play before the index regrows
+    scratch.reserve(4096);
+    flushedBytes = 0;
+    tickRun = 0;
+    ticksRecorded = 0;
+    closing = false;
+
+    putBytes(active, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    putU8(active, REPLAY_VERSION);
+    putVarint(active, level);
+    putU64(active, seed);
+    putVarint(active, ghostCount);
+    putVarint(active, KEYFRAME_INTERVAL);
+
+    writer = thread(&ReplayRecorder::writerLoop, this);
+    return true;
+}
+
+void ReplayRecorder::close() {
+    if (!isOpen()) return;
+
+    flushTickRun();
+
+    uint64_t indexOffset = flushedBytes + active.size();
+    for (const auto& k : keyframes) {
+        putU32(active, k.tick);
+        putU64(active, k.offset);
+    }
+    putU32(active, static_cast<uint32_t>(keyframes.size()));
+    putU32(active, ticksRecorded);
+    putU64(active, indexOffset);
+    putBytes(active, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    submit();
+
+    {
+        lock_guard<mutex> lock(writerMutex);
+        closing = true;
+    }
+    writerCv.notify_one();
+    writer.join();
+
+    fclose(file);
+    file = nullptr;
+}
+
+void ReplayRecorder::putOp(ReplayOp op, uint64_t payload) {
+    putVarint(active, (payload << 2) | static_cast<uint64_t>(op));
+}
+
+void ReplayRecorder::flushTickRun() {
+    if (tickRun > 0) {
+        putOp(ReplayOp::TICKS, tickRun);
+        tickRun = 0;
+    }
+}
+
+void ReplayRecorder::recordTick() {
+    ++tickRun;
+    ++ticksRecorded;
+}
+
+void ReplayRecorder::recordGhost(size_t index) {
+    flushTickRun();
+    putOp(ReplayOp::GHOST, index);
+    if (active.size() >= FLUSH_THRESHOLD) submit();
+}
+
+void ReplayRecorder::recordInput(char input) {
+    flushTickRun();
+    putOp(ReplayOp::INPUT, static_cast<unsigned char>(input));
+    if (active.size() >= FLUSH_THRESHOLD) submit();
+}
+
+void ReplayRecorder::recordKeyframe(const GameSnapshot& snapshot, bool indexed) {
+    flushTickRun();
+
+    if (indexed) {
+        ReplayKeyframe k;
+        k.tick = ticksRecorded;
+        k.offset = flushedBytes + active.size();
+        keyframes.push_back(k);
+    }
+
+    scratch.clear();
+    snapshot.serialize(scratch);
+    putOp(ReplayOp::KEYFRAME, scratch.size());
+    putBytes(active, scratch.data(), scratch.size());
+    submit();
+}
+
+void ReplayRecorder::submit() {
+    if (active.empty()) return;
+    flushedBytes += active.size();
+    {
+        lock_guard<mutex> lock(writerMutex);
+        if (pending.empty()) {
+            pending.swap(active);   // no copy when the writer has kept up
+        } else {
+            pending.insert(pending.end(), active.begin(), active.end());
+        }
+    }
+    active.clear();
+    writerCv.notify_one();
+}
+
+void ReplayRecorder::writerLoop() {
+    vector<uint8_t> writing;
+    writing.reserve(FLUSH_THRESHOLD * 2);
+    while (true) {
+        {
+            unique_lock<mutex> lock(writerMutex);
+            writerCv.wait(lock, [this]() { return closing || !pending.empty(); });
+            if (pending.empty() && closing) break;
+            writing.swap(pending);
+        }
+        fwrite(writing.data(), 1, writing.size(), file);
+        writing.clear();
+    }
+    fflush(file);
+}
+
+// ---------------------------------------------------------------------------
+// File reader
+// ---------------------------------------------------------------------------
+
+ReplayFile::ReplayFile() : level(1), seed(0), ghostCount(0), keyframeInterval(ReplayRecorder::KEYFRAME_INTERVAL),
+                           finalTick(0), bytes(nullptr), byteCount(0), opsStart(0), opsStop(0) {
+}
+
+ReplayFile::~ReplayFile() {
+    unmap();
+}
+
+void ReplayFile::unmap() {
+    if (bytes) {
+        munmap(const_cast<uint8_t*>(bytes), byteCount);
+        bytes = nullptr;
+        byteCount = 0;
+    }
+}
+
+// The file is mapped rather than read: the player decodes ops in place, so a
+// replay costs page cache instead of a private copy
+bool ReplayFile::load(const string& path, string& error) {
+    unmap();
+    keyframes.clear();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = path + " is not a replay file";
+        return false;
+    }
+    bytes = static_cast<const uint8_t*>(mapped);
+    byteCount = static_cast<size_t>(info.st_size);
+
+    ByteReader header(bytes, byteCount);
+    char magic[4];
+    if (!header.getBytes(magic, sizeof(magic)) || memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0) {
+        error = path + " is not a replay file";
+        return false;
+    }
+    if (header.getU8() != REPLAY_VERSION) {
+        error = "unsupported replay version";
+        return false;
+    }
+    level = static_cast<int>(header.getVarint());
+    seed = header.getU64();
+    ghostCount = static_cast<size_t>(header.getVarint());
+    keyframeInterval = static_cast<int>(header.getVarint());
+    if (!header.ok() || keyframeInterval <= 0) {
+        error = "truncated replay header";
+        return false;
+    }
+    opsStart = static_cast<size_t>(header.position() - bytes);
+
+    // A game that was killed never wrote its index, so recover it by scanning
+    if (!parseIndex()) {
+        rebuildIndex();
+    }
+    return true;
+}
+
+bool ReplayFile::parseIndex() {
+    if (byteCount < opsStart + TRAILER_SIZE) return false;
+
+    const uint8_t* trailer = bytes + byteCount - TRAILER_SIZE;
+    if (memcmp(trailer + TRAILER_SIZE - 4, INDEX_MAGIC, 4) != 0) return false;
+
+    ByteReader in(trailer, TRAILER_SIZE);
+    uint32_t count = in.getU32();
+    uint32_t last = in.getU32();
+    uint64_t indexOffset = in.getU64();
+    if (indexOffset < opsStart || indexOffset + static_cast<uint64_t>(count) * 12 + TRAILER_SIZE != byteCount) {
+        return false;
+    }
+
+    ByteReader index(bytes + indexOffset, static_cast<size_t>(count) * 12);
+    keyframes.resize(count);
+    for (auto& k : keyframes) {
+        k.tick = index.getU32();
+        k.offset = index.getU64();
+    }
+    opsStop = static_cast<size_t>(indexOffset);
+    finalTick = static_cast<int>(last);
+    return index.ok();
+}
+
+void ReplayFile::rebuildIndex() {
+    keyframes.clear();
+    finalTick = 0;
+    ByteReader in(bytes + opsStart, byteCount - opsStart);
+    int tick = 0;
+    size_t lastGood = opsStart;
+    while (!in.atEnd()) {
+        size_t offset = static_cast<size_t>(in.position() - bytes);
+        uint64_t v = in.getVarint();
+        if (!in.ok()) break;
+        ReplayOp op = static_cast<ReplayOp>(v & 3);
+        uint64_t payload = v >> 2;
+        if (op == ReplayOp::TICKS) {
+            tick += static_cast<int>(payload);
+        } else if (op == ReplayOp::KEYFRAME) {
+            if (!in.skip(static_cast<size_t>(payload))) break;
+            // Rewind keyframes fall between the evenly spaced ones; leave them out
+            if (tick % keyframeInterval == 0 && (keyframes.empty() || keyframes.back().tick != static_cast<uint32_t>(tick))) {
+                ReplayKeyframe k;
+                k.tick = static_cast<uint32_t>(tick);
+                k.offset = offset;
+                keyframes.push_back(k);
+            }
+        }
+        lastGood = static_cast<size_t>(in.position() - bytes);
+    }
+    opsStop = lastGood;
+    finalTick = tick;
+}
+
+size_t ReplayFile::keyframeFor(int tick) const {
+    if (keyframes.empty() || tick <= 0) return 0;
+    size_t i = static_cast<size_t>(tick / keyframeInterval);
+    if (i >= keyframes.size()) i = keyframes.size() - 1;
+    // Keyframes are evenly spaced, so this loop only runs for hand-edited files
+    while (i > 0 && static_cast<int>(keyframes[i].tick) > tick) --i;
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// Player
+// ---------------------------------------------------------------------------
+
+ReplayPlayer::ReplayPlayer(Game& g) : game(g), cursor(0), ticksLeftInRun(0), replayTick(0) {
+}
+
+bool ReplayPlayer::load(const string& path, string& error) {
+    if (!file.load(path, error)) return false;
+    if (file.ghostCount != game.getGhostCount()) {
+        error = "replay was recorded with a different ghost count";
+        return false;
+    }
+    game.newGame(file.level, file.seed);
+    cursor = file.opsBegin();
+    ticksLeftInRun = 0;
+    replayTick = 0;
+    // A --level-file level exists only in the keyframes, so start from the
+    // opening one rather than whatever newGame() could find for its id
+    if (!LevelData::acquire(file.level) && !restoreKeyframeAt(file.opsBegin())) {
+        error = "replay does not start with its level layout";
+        return false;
+    }
+    return true;
+}
+
+// Restores the keyframe op at 'offset' and moves the cursor past it
+bool ReplayPlayer::restoreKeyframeAt(size_t offset) {
+    ByteReader in(file.data() + offset, file.opsEnd() - offset);
+    uint64_t v = in.getVarint();
+    size_t size = static_cast<size_t>(v >> 2);
+    if (!in.ok() || static_cast<ReplayOp>(v & 3) != ReplayOp::KEYFRAME || in.remaining() < size ||
+        !keyframe.deserialize(in.position(), size)) {
+        return false;
+    }
+    game.restoreSnapshot(keyframe);
+    cursor = static_cast<size_t>(in.position() - file.data()) + size;
+    ticksLeftInRun = 0;
+    return true;
+}
+
+bool ReplayPlayer::seek(int tick) {
+    if (file.keyframes.empty()) return false;
+
+    // Re-simulating up to the target must not draw every intermediate frame
+    bool wasHeadless = game.isHeadless();
+    game.setHeadless(true);
+
+    const ReplayKeyframe& k = file.keyframes[file.keyframeFor(tick)];
+    if (!restoreKeyframeAt(static_cast<size_t>(k.offset))) {
+        game.setHeadless(wasHeadless);
+        return false;
+    }
+    replayTick = static_cast<int>(k.tick);
+
+    ReplayOp op;
+    while (replayTick < tick && step(op)) {
+    }
+    game.setHeadless(wasHeadless);
+    return true;
+}
+
+bool ReplayPlayer::step(ReplayOp& executed) {
+    while (true) {
+        if (ticksLeftInRun > 0) {
+            --ticksLeftInRun;
+            ++replayTick;
+            game.tickPacman();
+            executed = ReplayOp::TICKS;
+            return true;
+        }
+        if (cursor >= file.opsEnd()) return false;
+
+        ByteReader in(file.data() + cursor, file.opsEnd() - cursor);
+        uint64_t v = in.getVarint();
+        if (!in.ok()) return false;
+        ReplayOp op = static_cast<ReplayOp>(v & 3);
+        uint64_t payload = v >> 2;
+        cursor = static_cast<size_t>(in.position() - file.data());
+
+        switch (op) {
+            case ReplayOp::TICKS:
+                ticksLeftInRun = static_cast<uint32_t>(payload);
+                break;
+            case ReplayOp::GHOST:
+                if (payload >= game.getGhostCount()) return false;
+                game.stepGhost(static_cast<size_t>(payload));
+                executed = op;
+                return true;
+            case ReplayOp::INPUT:
+                game.applyInput(static_cast<char>(payload));
+                executed = op;
+                return true;
+            case ReplayOp::KEYFRAME:
+                // Periodic keyframes match the simulated state already; rewind
+                // keyframes are the only way the recording can move time back
+                if (payload > file.opsEnd() - cursor ||
+                    !keyframe.deserialize(file.data() + cursor, static_cast<size_t>(payload))) {
+                    return false;
+                }
+                game.restoreSnapshot(keyframe);
+                cursor += static_cast<size_t>(payload);
+                break;
+        }
+    }
+}
+
+int ReplayPlayer::playHeadless() {
+    game.setHeadless(true);
+    auto begin = chrono::steady_clock::now();
+    long ops = 0;
+    ReplayOp op;
+    int startTick = replayTick;
+    while (step(op)) {
+        ++ops;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    int ticks = replayTick - startTick;
+
+    cout << "Replay finished at tick " << replayTick << " (recorded " << file.finalTick << ")" << endl;
+    cout << "  Score: " << game.getScore() << "  Lives: " << game.getLives()
+         << "  Dots: " << game.getDotsEaten() << "/" << game.getMaxDots() << endl;
+    cout << "  Simulated " << ticks << " ticks (" << ops << " steps) in " << seconds * 1000.0 << " ms";
+    if (seconds > 0) {
+        cout << " = " << static_cast<long>(ticks / seconds) << " ticks/sec";
+    }
+    cout << endl;
+    return 0;
+}
+
+int ReplayPlayer::playRendered(int speed) {
+    const int SEEK_STEP = ReplayRecorder::KEYFRAME_INTERVAL;
+    game.setHeadless(false);
+    clearScreen();
+    hideCursor();
+    game.displayGame();
+
+    ReplayOp op;
+    bool running = true;
+    while (running && step(op)) {
+        if (op != ReplayOp::TICKS) continue;
+
+        game.flushOutput();
+        setTextColor(BRIGHT_CYAN);
+        cout << "[REPLAY] tick " << replayTick << "/" << file.finalTick << "  speed " << speed
+             << "x   '[' / ']' seek, 'q' quit      " << endl;
+        resetTextColor();
+
+        switch (getInputKey()) {
+            case InputKey::LEFT_BRACKET:
+                seek(replayTick > SEEK_STEP ? replayTick - SEEK_STEP : 0);
+                game.displayGame();
+                break;
+            case InputKey::RIGHT_BRACKET:
+                seek(replayTick + SEEK_STEP);
+                game.displayGame();
+                break;
+            case InputKey::Q:
+                running = false;
+                break;
+            default:
+                break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(150 / speed));
+    }
+
+    showCursor();
+    cout << "Replay ended at tick " << replayTick << ". Score: " << game.getScore() << endl;
+    return 0;
+}
+
+int runReplay(const string& path, int speed, int seekTick) {
+    Game game;
+    game.setHeadless(true);
+    game.setReplayDirectory("");
+
+    ReplayPlayer player(game);
+    string error;
+    if (!player.load(path, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    if (seekTick > 0 && !player.seek(seekTick)) {
+        cerr << "Error: replay has no keyframes to seek with" << endl;
+        return 1;
+    }
+    return speed <= 0 ? player.playHeadless() : player.playRendered(speed);
+}
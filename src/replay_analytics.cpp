@@ -0,0 +1,453 @@
+#include "replay_analytics.hpp"
+#include "level.hpp"
+#include "replay.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sys/stat.h>
+#include <thread>
+
+using namespace std;
+
+const int LevelAnalytics::GHOST_TYPES;
+const int LevelAnalytics::CLEAR_BUCKET_TICKS;
+const int LevelAnalytics::CLEAR_BUCKETS;
+const uint32_t LevelAnalytics::RANK_SCALE;
+
+static const char ANALYTICS_MAGIC[4] = {'P', 'M', 'R', 'A'};
+static const uint8_t ANALYTICS_VERSION = 1;
+static const char* const GHOST_NAMES[LevelAnalytics::GHOST_TYPES] = {"blinky", "pinky", "inky", "clyde"};
+
+// ---------------------------------------------------------------------------
+// Level aggregates
+// ---------------------------------------------------------------------------
+
+LevelAnalytics::LevelAnalytics() : level(0), height(0), width(0), games(0), clears(0), ticks(0) {
+    fill(clearTimes, clearTimes + CLEAR_BUCKETS, 0);
+}
+
+void LevelAnalytics::reset(int levelId, int levelHeight, int levelWidth) {
+    level = levelId;
+    height = levelHeight;
+    width = levelWidth;
+    games = clears = ticks = 0;
+    size_t cells = static_cast<size_t>(height) * width;
+    pacmanVisits.assign(cells, 0);
+    for (int g = 0; g < GHOST_TYPES; ++g) ghostVisits[g].assign(cells, 0);
+    deaths.assign(cells, 0);
+    clearRankSum.assign(cells, 0);
+    clearCount.assign(cells, 0);
+    fill(clearTimes, clearTimes + CLEAR_BUCKETS, 0);
+}
+
+static void addCells(vector<uint64_t>& into, const vector<uint64_t>& from) {
+    for (size_t i = 0; i < into.size() && i < from.size(); ++i) into[i] += from[i];
+}
+
+void LevelAnalytics::merge(const LevelAnalytics& other) {
+    if (other.height != height || other.width != width) return;   // a redesigned level starts over
+    games += other.games;
+    clears += other.clears;
+    ticks += other.ticks;
+    addCells(pacmanVisits, other.pacmanVisits);
+    for (int g = 0; g < GHOST_TYPES; ++g) addCells(ghostVisits[g], other.ghostVisits[g]);
+    addCells(deaths, other.deaths);
+    addCells(clearRankSum, other.clearRankSum);
+    addCells(clearCount, other.clearCount);
+    for (int b = 0; b < CLEAR_BUCKETS; ++b) clearTimes[b] += other.clearTimes[b];
+}
+
+int LevelAnalytics::clearTimePercentile(double p) const {
+    if (clears == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(p * (clears - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < CLEAR_BUCKETS; ++b) {
+        seen += clearTimes[b];
+        if (seen > target) return (b + 1) * CLEAR_BUCKET_TICKS;
+    }
+    return CLEAR_BUCKETS * CLEAR_BUCKET_TICKS;
+}
+
+static void putCells(vector<uint8_t>& out, const vector<uint64_t>& cells) {
+    for (size_t i = 0; i < cells.size(); ++i) putVarint(out, cells[i]);
+}
+
+static void getCells(ByteReader& in, vector<uint64_t>& cells) {
+    for (size_t i = 0; i < cells.size(); ++i) cells[i] = in.getVarint();
+}
+
+void LevelAnalytics::serialize(vector<uint8_t>& out) const {
+    putVarint(out, static_cast<uint64_t>(level));
+    putVarint(out, static_cast<uint64_t>(height));
+    putVarint(out, static_cast<uint64_t>(width));
+    putVarint(out, games);
+    putVarint(out, clears);
+    putVarint(out, ticks);
+    putCells(out, pacmanVisits);
+    for (int g = 0; g < GHOST_TYPES; ++g) putCells(out, ghostVisits[g]);
+    putCells(out, deaths);
+    putCells(out, clearRankSum);
+    putCells(out, clearCount);
+    for (int b = 0; b < CLEAR_BUCKETS; ++b) putVarint(out, clearTimes[b]);
+}
+
+bool LevelAnalytics::deserialize(ByteReader& in) {
+    int id = static_cast<int>(in.getVarint());
+    int h = static_cast<int>(in.getVarint());
+    int w = static_cast<int>(in.getVarint());
+    if (!in.ok() || h <= 0 || w <= 0 || static_cast<uint64_t>(h) * w > in.remaining()) return false;
+    reset(id, h, w);
+    games = in.getVarint();
+    clears = in.getVarint();
+    ticks = in.getVarint();
+    getCells(in, pacmanVisits);
+    for (int g = 0; g < GHOST_TYPES; ++g) getCells(in, ghostVisits[g]);
+    getCells(in, deaths);
+    getCells(in, clearRankSum);
+    getCells(in, clearCount);
+    for (int b = 0; b < CLEAR_BUCKETS; ++b) clearTimes[b] = in.getVarint();
+    return in.ok();
+}
+
+// ---------------------------------------------------------------------------
+// Replay aggregates
+// ---------------------------------------------------------------------------
+
+LevelAnalytics& ReplayAnalytics::forLevel(int level, int height, int width) {
+    LevelAnalytics& stats = levels[level];
+    if (stats.height != height || stats.width != width) stats.reset(level, height, width);
+    return stats;
+}
+
+bool ReplayAnalytics::addReplay(Game& game, const string& path, string& error) {
+    TRACE_SCOPE("analytics.replay");
+    ReplayPlayer player(game);
+    if (!player.load(path, error)) return false;
+
+    const Map& map = game.getMap();
+    int w = map.getWidth();
+    LevelAnalytics& stats = forLevel(game.getLevel(), map.getHeight(), w);
+    EventBus::Cursor cursor = game.getEventBus().subscribe();
+    GameEvent batch[16];
+    uint64_t dotsSeen = 0;
+    uint64_t maxDots = static_cast<uint64_t>(max(1, game.getMaxDots()));
+
+    ReplayOp op;
+    while (player.step(op)) {
+        size_t n;
+        while ((n = game.getEventBus().drain(cursor, batch, 16)) > 0) {
+            for (size_t i = 0; i < n; ++i) {
+                const GameEvent& e = batch[i];
+                size_t cell = static_cast<size_t>(e.y) * w + e.x;
+                if (cell >= stats.deaths.size()) continue;
+                switch (e.type) {
+                    case GameEventType::DOT_EATEN:
+                    case GameEventType::PELLET_EATEN:
+                        stats.clearRankSum[cell] += dotsSeen * LevelAnalytics::RANK_SCALE / maxDots;
+                        ++stats.clearCount[cell];
+                        ++dotsSeen;
+                        break;
+                    case GameEventType::PACMAN_DIED:
+                        ++stats.deaths[cell];
+                        break;
+                    case GameEventType::LEVEL_CLEARED:
+                        ++stats.clears;
+                        ++stats.clearTimes[min<uint32_t>(e.tick / LevelAnalytics::CLEAR_BUCKET_TICKS,
+                                                         LevelAnalytics::CLEAR_BUCKETS - 1)];
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        if (op != ReplayOp::TICKS) continue;
+
+        // Positions are sampled once per Pacman tick, so every heatmap is in ticks
+        const Pacman& pacman = game.getPacman();
+        if (map.isValidPosition(pacman.getY(), pacman.getX())) {
+            ++stats.pacmanVisits[static_cast<size_t>(pacman.getY()) * w + pacman.getX()];
+        }
+        for (size_t g = 0; g < game.getGhostCount(); ++g) {
+            const Ghost& ghost = game.getGhost(g);
+            int type = static_cast<int>(ghost.getType());
+            if (!ghost.isAlive() || type >= LevelAnalytics::GHOST_TYPES) continue;
+            if (!map.isValidPosition(ghost.getY(), ghost.getX())) continue;
+            ++stats.ghostVisits[type][static_cast<size_t>(ghost.getY()) * w + ghost.getX()];
+        }
+    }
+    ++stats.games;
+    stats.ticks += static_cast<uint64_t>(player.getTick());
+    return true;
+}
+
+void ReplayAnalytics::merge(const ReplayAnalytics& other) {
+    for (map<int, LevelAnalytics>::const_iterator it = other.levels.begin(); it != other.levels.end(); ++it) {
+        forLevel(it->first, it->second.height, it->second.width).merge(it->second);
+    }
+    for (map<string, FileStamp>::const_iterator it = other.seen.begin(); it != other.seen.end(); ++it) {
+        seen[it->first] = it->second;
+    }
+}
+
+bool ReplayAnalytics::save(const string& path) const {
+    vector<uint8_t> out;
+    putBytes(out, ANALYTICS_MAGIC, sizeof(ANALYTICS_MAGIC));
+    putU8(out, ANALYTICS_VERSION);
+    putVarint(out, seen.size());
+    for (map<string, FileStamp>::const_iterator it = seen.begin(); it != seen.end(); ++it) {
+        putString(out, it->first);
+        putU64(out, it->second.size);
+        putSignedVarint(out, it->second.mtime);
+    }
+    putVarint(out, levels.size());
+    for (map<int, LevelAnalytics>::const_iterator it = levels.begin(); it != levels.end(); ++it) {
+        it->second.serialize(out);
+    }
+
+    // A crash mid-write leaves the old state intact
+    string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    written = (fclose(file) == 0) && written;
+    return written && rename(temp.c_str(), path.c_str()) == 0;
+}
+
+bool ReplayAnalytics::load(const string& path, string& error) {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) return true;   // nothing aggregated yet
+    vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    ByteReader in(bytes.data(), bytes.size());
+    char magic[4];
+    if (!in.getBytes(magic, sizeof(magic)) || memcmp(magic, ANALYTICS_MAGIC, sizeof(magic)) != 0 ||
+        in.getU8() != ANALYTICS_VERSION) {
+        error = path + " is not an analytics state file";
+        return false;
+    }
+    uint64_t files = in.getVarint();
+    for (uint64_t i = 0; i < files && in.ok(); ++i) {
+        string name = in.getString();
+        FileStamp stamp;
+        stamp.size = in.getU64();
+        stamp.mtime = in.getSignedVarint();
+        seen[name] = stamp;
+    }
+    uint64_t count = in.getVarint();
+    for (uint64_t i = 0; i < count && in.ok(); ++i) {
+        LevelAnalytics stats;
+        if (!stats.deserialize(in)) break;
+        levels[stats.level] = stats;
+    }
+    if (!in.ok()) {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+static void writeCells(ostream& out, const vector<uint64_t>& cells) {
+    out << "[";
+    for (size_t i = 0; i < cells.size(); ++i) out << (i ? "," : "") << cells[i];
+    out << "]";
+}
+
+void ReplayAnalytics::writeJson(ostream& out) const {
+    out << "{\"replays\": " << seen.size() << ", \"levels\": [";
+    bool first = true;
+    for (map<int, LevelAnalytics>::const_iterator it = levels.begin(); it != levels.end(); ++it) {
+        const LevelAnalytics& s = it->second;
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "  {\"level\": " << s.level << ", \"height\": " << s.height << ", \"width\": " << s.width
+            << ", \"games\": " << s.games << ", \"clears\": " << s.clears << ", \"ticks\": " << s.ticks;
+        out << ",\n   \"pacman_visits\": ";
+        writeCells(out, s.pacmanVisits);
+        out << ",\n   \"ghost_visits\": {";
+        for (int g = 0; g < LevelAnalytics::GHOST_TYPES; ++g) {
+            out << (g ? ", " : "") << "\"" << GHOST_NAMES[g] << "\": ";
+            writeCells(out, s.ghostVisits[g]);
+        }
+        out << "},\n   \"deaths\": ";
+        writeCells(out, s.deaths);
+        // Mean position in the eating order, 0 = first dot eaten, 1 = last; -1 = never eaten
+        out << ",\n   \"dot_clear_order\": [";
+        for (size_t i = 0; i < s.clearCount.size(); ++i) {
+            out << (i ? "," : "");
+            if (s.clearCount[i] == 0) {
+                out << "-1";
+            } else {
+                out << fixed << setprecision(3)
+                    << static_cast<double>(s.clearRankSum[i]) / s.clearCount[i] / LevelAnalytics::RANK_SCALE;
+            }
+        }
+        out << "],\n   \"time_to_clear\": {\"bucket_ticks\": " << LevelAnalytics::CLEAR_BUCKET_TICKS
+            << ", \"counts\": [";
+        for (int b = 0; b < LevelAnalytics::CLEAR_BUCKETS; ++b) out << (b ? "," : "") << s.clearTimes[b];
+        out << "]}}";
+    }
+    out << "\n]}\n";
+}
+
+void ReplayAnalytics::printReport(ostream& out) const {
+    static const char SHADES[] = " .:-=+*%@";
+    for (map<int, LevelAnalytics>::const_iterator it = levels.begin(); it != levels.end(); ++it) {
+        const LevelAnalytics& s = it->second;
+        uint64_t deathTotal = 0;
+        for (size_t i = 0; i < s.deaths.size(); ++i) deathTotal += s.deaths[i];
+        out << "Level " << s.level << ": " << s.games << " games, " << s.ticks << " ticks, " << s.clears
+            << " cleared, " << deathTotal << " deaths" << endl;
+        if (s.clears > 0) {
+            out << "  Time to clear: p50 <= " << s.clearTimePercentile(0.5) << " ticks, p90 <= "
+                << s.clearTimePercentile(0.9) << " ticks" << endl;
+        }
+
+        vector<size_t> deadliest;
+        for (size_t i = 0; i < s.deaths.size(); ++i) {
+            if (s.deaths[i] > 0) deadliest.push_back(i);
+        }
+        sort(deadliest.begin(), deadliest.end(), [&s](size_t a, size_t b) { return s.deaths[a] > s.deaths[b]; });
+        if (!deadliest.empty()) {
+            out << "  Deadliest cells (y,x):";
+            for (size_t i = 0; i < deadliest.size() && i < 5; ++i) {
+                out << " (" << deadliest[i] / s.width << "," << deadliest[i] % s.width << ") x"
+                    << s.deaths[deadliest[i]];
+            }
+            out << endl;
+        }
+
+        // Pacman's heatmap over the level's walls, shaded relative to the busiest cell
+        shared_ptr<const LevelData> data = LevelData::acquire(s.level);
+        bool drawable = data && data->getHeight() == s.height && data->getWidth() == s.width;
+        uint64_t busiest = *max_element(s.pacmanVisits.begin(), s.pacmanVisits.end());
+        if (!drawable || busiest == 0) continue;
+        out << "  Where Pacman spends his time:" << endl;
+        for (int y = 0; y < s.height; ++y) {
+            string row = "  ";
+            for (int x = 0; x < s.width; ++x) {
+                uint64_t visits = s.pacmanVisits[static_cast<size_t>(y) * s.width + x];
+                if (data->terrainAt(y, x) == LevelData::WALL) {
+                    row += '#';
+                } else if (visits == 0) {
+                    row += ' ';
+                } else {
+                    // Log scale: a few corridors would otherwise hold all the contrast
+                    double share = log(static_cast<double>(visits)) / log(static_cast<double>(busiest) + 1);
+                    row += SHADES[1 + static_cast<int>(share * (sizeof(SHADES) - 2))];
+                }
+            }
+            out << row << endl;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Driver
+// ---------------------------------------------------------------------------
+
+int runReplayAnalytics(const string& directory, size_t threads) {
+    string statePath = directory + "/analytics.pma";
+    string jsonPath = directory + "/analytics.json";
+    ReplayAnalytics total;
+    string error;
+    if (!total.load(statePath, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        cerr << "Error: cannot open directory " << directory << endl;
+        return 1;
+    }
+    // Replays touched in the last few seconds may still be recording; they wait for the next run
+    const int64_t SETTLE_SECONDS = 5;
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    vector<string> paths;
+    vector<ReplayAnalytics::FileStamp> stamps;
+    size_t recording = 0;
+    while (dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() < 5 || name.compare(name.size() - 4, 4, ".pmr") != 0) continue;
+        string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || total.hasSeen(path)) continue;
+        if (now - static_cast<int64_t>(info.st_mtime) < SETTLE_SECONDS) {
+            ++recording;
+            continue;
+        }
+        ReplayAnalytics::FileStamp stamp;
+        stamp.size = static_cast<uint64_t>(info.st_size);
+        stamp.mtime = static_cast<int64_t>(info.st_mtime);
+        paths.push_back(path);
+        stamps.push_back(stamp);
+    }
+    closedir(dir);
+
+    size_t threadCount = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, paths.size()));
+    cout << "Analyzing " << paths.size() << " new replays in " << directory << " (" << total.seenCount()
+         << " already counted";
+    if (recording > 0) cout << ", " << recording << " still being written";
+    cout << ") on " << threadCount << " threads" << endl;
+
+    // Map: each worker folds its share into a private ReplayAnalytics.
+    // Reduce: the partials are merged into the saved totals.
+    vector<ReplayAnalytics> partials(threadCount);
+    atomic<size_t> next(0);
+    atomic<size_t> failed(0);
+    atomic<uint64_t> bytes(0);
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount && !paths.empty(); ++t) {
+        workers.push_back(thread([&, t]() {
+            TRACE_THREAD_NAME("analytics");
+            Game game;
+            game.setHeadless(true);
+            game.setReplayDirectory("");
+            size_t i;
+            while ((i = next.fetch_add(1)) < paths.size()) {
+                string replayError;
+                if (partials[t].addReplay(game, paths[i], replayError)) {
+                    bytes += stamps[i].size;
+                } else {
+                    ++failed;
+                    cerr << "  skipped " << paths[i] << ": " << replayError << endl;
+                }
+                partials[t].markSeen(paths[i], stamps[i]);   // a bad file is not retried every run
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    for (size_t t = 0; t < partials.size(); ++t) total.merge(partials[t]);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    if (!paths.empty()) {
+        cout << "  " << paths.size() - failed.load() << " replays (" << bytes.load() / 1024 << " KiB) in " << fixed
+             << setprecision(2) << seconds << " s: " << setprecision(0)
+             << (seconds > 0 ? paths.size() / seconds : 0.0) << " replays/s" << endl;
+    }
+    if (!total.save(statePath)) {
+        cerr << "Error: cannot write " << statePath << endl;
+        return 1;
+    }
+    total.printReport(cout);
+
+    ofstream json(jsonPath.c_str());
+    if (!json) {
+        cerr << "Error: cannot write " << jsonPath << endl;
+        return 1;
+    }
+    total.writeJson(json);
+    cout << "  State: " << statePath << ", report: " << jsonPath << endl;
+    return 0;
+}
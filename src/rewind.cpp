@@ -0,0 +1,136 @@
+#include "rewind.hpp"
+
+using namespace std;
+
+RewindBuffer::RewindBuffer() : ghostsPerEntry(0), newest(0), count(0), cellEnd(0), hasHead(false) {
+}
+
+void RewindBuffer::allocate(size_t capacityTicks, size_t ghostCount) {
+    entries.assign(capacityTicks, Entry());
+    messages.assign(capacityTicks, MessageId::ROUND_START);
+    ghostPool.assign(capacityTicks * ghostCount, EntitySnapshot());
+    cellPool.assign(capacityTicks * 32, CellChange());
+    ghostsPerEntry = ghostCount;
+    newest = 0;
+    count = 0;
+    cellEnd = 0;
+    hasHead = false;
+
+    head.cells.reserve(64 * 64);
+    head.ghosts.reserve(ghostCount);
+}
+
+void RewindBuffer::clear() {
+    count = 0;
+    hasHead = false;
+}
+
+size_t RewindBuffer::oldestIndex() const {
+    return (newest + entries.size() - (count - 1)) % entries.size();
+}
+
+void RewindBuffer::dropOldest() {
+    if (count > 0) --count;
+}
+
+void RewindBuffer::capture(const GameSnapshot& state) {
+    if (entries.empty()) return;
+
+    if (!hasHead || state.cells.size() != head.cells.size() || state.ghosts.size() != ghostsPerEntry) {
+        // Different level or actor set: history no longer applies
+        count = 0;
+        head = state;
+        hasHead = true;
+        return;
+    }
+
+    // Count changed cells first so a burst larger than the pool resets history
+    // instead of leaving a partial undo record behind
+    uint32_t changed = 0;
+    for (size_t i = 0; i < state.cells.size(); ++i) {
+        if (state.cells[i] != head.cells[i]) ++changed;
+    }
+    if (changed > cellPool.size()) {
+        count = 0;
+        head = state;
+        return;
+    }
+
+    // Make room: the ring slot and the cell pool range must both be free
+    if (count == entries.size()) dropOldest();
+    while (count > 0 && entries[oldestIndex()].cellStart + cellPool.size() < cellEnd + changed) {
+        dropOldest();
+    }
+
+    newest = (count == 0) ? newest : (newest + 1) % entries.size();
+    Entry& e = entries[newest];
+    e.time = head.time;
+    e.SMtime = head.SMtime;
+    e.score = head.score;
+    e.lives = head.lives;
+    e.dotsEaten = head.dotsEaten;
+    e.superMode = head.superMode;
+    e.rngState = head.rngState;
+    e.pacman = head.pacman;
+    e.cellStart = cellEnd;
+    e.cellCount = changed;
+    messages[newest] = head.message;
+
+    for (size_t g = 0; g < ghostsPerEntry; ++g) {
+        ghostPool[newest * ghostsPerEntry + g] = head.ghosts[g];
+    }
+
+    for (size_t i = 0; i < state.cells.size(); ++i) {
+        if (state.cells[i] != head.cells[i]) {
+            CellChange& c = cellPool[cellEnd % cellPool.size()];
+            c.index = static_cast<uint32_t>(i);
+            c.previous = head.cells[i];
+            head.cells[i] = state.cells[i];
+            ++cellEnd;
+        }
+    }
+    ++count;
+
+    head.level = state.level;
+    head.time = state.time;
+    head.SMtime = state.SMtime;
+    head.score = state.score;
+    head.lives = state.lives;
+    head.dotsEaten = state.dotsEaten;
+    head.maxDots = state.maxDots;
+    head.superMode = state.superMode;
+    head.rngState = state.rngState;
+    head.message = state.message;
+    head.pacman = state.pacman;
+    for (size_t g = 0; g < ghostsPerEntry; ++g) {
+        head.ghosts[g] = state.ghosts[g];
+    }
+}
+
+bool RewindBuffer::stepBack() {
+    if (count == 0) return false;
+
+    const Entry& e = entries[newest];
+    head.time = e.time;
+    head.SMtime = e.SMtime;
+    head.score = e.score;
+    head.lives = e.lives;
+    head.dotsEaten = e.dotsEaten;
+    head.superMode = e.superMode;
+    head.rngState = e.rngState;
+    head.message = messages[newest];
+    head.pacman = e.pacman;
+    for (size_t g = 0; g < ghostsPerEntry; ++g) {
+        head.ghosts[g] = ghostPool[newest * ghostsPerEntry + g];
+    }
+
+    for (uint64_t i = e.cellStart + e.cellCount; i > e.cellStart; --i) {
+        const CellChange& c = cellPool[(i - 1) % cellPool.size()];
+        head.cells[c.index] = c.previous;
+    }
+    cellEnd = e.cellStart;
+
+    --count;
+    newest = (newest + entries.size() - 1) % entries.size();
+    return true;
+}
@@ -0,0 +1,151 @@
+#include "save_game.hpp"
+#include "level.hpp"
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const size_t SaveImage::HEADER_SIZE;
+
+static const char SAVE_MAGIC[4] = {'P', 'M', 'S', 'V'};
+static const uint8_t SAVE_VERSION = 2;
+static const size_t MAX_SAVE_PATH = 4096;
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+
+static uint64_t checksum(const uint8_t* data, size_t size, uint64_t hash = FNV_OFFSET) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void storeLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint64_t loadLittleEndian(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+SaveImage::SaveImage() : layoutHash(FNV_OFFSET) {
+}
+
+void SaveImage::encode(const GameSnapshot& snapshot) {
+    if (snapshot.layout != layout) {
+        layout = snapshot.layout;
+        layoutBytes.clear();
+        if (layout) layout->write(layoutBytes);
+        layoutHash = checksum(layoutBytes.data(), layoutBytes.size());
+    }
+
+    bytes.resize(HEADER_SIZE);
+    snapshot.serializeState(bytes);
+
+    uint8_t* header = bytes.data();
+    size_t state = bytes.size() - HEADER_SIZE;
+    memcpy(header, SAVE_MAGIC, sizeof(SAVE_MAGIC));
+    header[4] = SAVE_VERSION;
+    header[5] = header[6] = header[7] = 0;
+    storeLittleEndian(header + 8, state + layoutBytes.size(), 4);
+    storeLittleEndian(header + 12, layoutBytes.size(), 4);
+    storeLittleEndian(header + 16, checksum(header + HEADER_SIZE, state, layoutHash), 8);
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeSaveFile(const char* path, const SaveImage& image) {
+    size_t length = strlen(path);
+    char temp[MAX_SAVE_PATH];
+    if (image.bytes.empty() || length + 5 > sizeof(temp)) return false;
+    memcpy(temp, path, length);
+    memcpy(temp + length, ".tmp", 5);
+
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, image.bytes.data(), image.bytes.size()) &&
+              writeAll(fd, image.layoutBytes.data(), image.layoutBytes.size());
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return false;
+    }
+    return true;
+}
+
+bool loadSaveFile(const string& path, GameSnapshot& snapshot, string& error) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    size_t size = 0;
+    if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(SaveImage::HEADER_SIZE)) {
+        size = static_cast<size_t>(info.st_size);
+        mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = path + " is not a save file";
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(mapped);
+    size_t payload = static_cast<size_t>(loadLittleEndian(bytes + 8, 4));
+    size_t layoutSize = static_cast<size_t>(loadLittleEndian(bytes + 12, 4));
+    bool valid = false;
+    if (memcmp(bytes, SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0) {
+        error = path + " is not a save file";
+    } else if (bytes[4] != SAVE_VERSION) {
+        error = "unsupported save version";
+    } else if (payload != size - SaveImage::HEADER_SIZE || layoutSize > payload) {
+        error = "save file is truncated";
+    } else if (loadLittleEndian(bytes + 16, 8) !=
+               checksum(bytes + SaveImage::HEADER_SIZE, payload - layoutSize,
+                        checksum(bytes + size - layoutSize, layoutSize))) {
+        error = "save file is corrupt (checksum mismatch)";
+    } else if (!snapshot.deserialize(bytes + SaveImage::HEADER_SIZE, payload)) {
+        error = "save file is corrupt";
+    } else {
+        valid = true;
+    }
+    munmap(mapped, size);
+    if (!valid) return false;
+
+    // A well-formed save can still name a level whose map changed since it was
+    // written; a --level-file level is checked against the layout it carries
+    shared_ptr<const LevelData> level = snapshot.layout ? snapshot.layout : LevelData::acquire(snapshot.level);
+    if (!level || level->getHeight() != snapshot.height || level->getWidth() != snapshot.width) {
+        error = "save does not match level " + to_string(snapshot.level);
+        return false;
+    }
+    bool onGrid = level->contains(snapshot.pacman.y, snapshot.pacman.x);
+    for (size_t i = 0; i < snapshot.ghosts.size(); ++i) {
+        onGrid = onGrid && level->contains(snapshot.ghosts[i].y, snapshot.ghosts[i].x);
+    }
+    if (!onGrid) {
+        error = "save has an actor off the grid";
+        return false;
+    }
+    return true;
+}
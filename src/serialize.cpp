@@ -0,0 +1,138 @@
+#include "serialize.hpp"
+#include <cstring>
+
+using namespace std;
+
+void putU8(vector<uint8_t>& out, uint8_t v) {
+    out.push_back(v);
+}
+
+void putU32(vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+void putU64(vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+void putVarint(vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putSignedVarint(vector<uint8_t>& out, int64_t v) {
+    // zigzag so small negative deltas stay small
+    putVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+void putBytes(vector<uint8_t>& out, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), p, p + size);
+}
+
+void putString(vector<uint8_t>& out, const string& s) {
+    putVarint(out, s.size());
+    putBytes(out, s.data(), s.size());
+}
+
+void putString(vector<uint8_t>& out, const char* s) {
+    size_t size = strlen(s);
+    putVarint(out, size);
+    putBytes(out, s, size);
+}
+
+uint8_t ByteReader::getU8() {
+    if (cur >= end) {
+        failed = true;
+        return 0;
+    }
+    return *cur++;
+}
+
+uint32_t ByteReader::getU32() {
+    if (remaining() < 4) {
+        failed = true;
+        cur = end;
+        return 0;
+    }
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<uint32_t>(cur[i]) << (8 * i);
+    }
+    cur += 4;
+    return v;
+}
+
+uint64_t ByteReader::getU64() {
+    if (remaining() < 8) {
+        failed = true;
+        cur = end;
+        return 0;
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(cur[i]) << (8 * i);
+    }
+    cur += 8;
+    return v;
+}
+
+uint64_t ByteReader::getVarint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cur >= end) {
+            failed = true;
+            return 0;
+        }
+        uint8_t b = *cur++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    failed = true; // over-long encoding
+    return 0;
+}
+
+int64_t ByteReader::getSignedVarint() {
+    uint64_t v = getVarint();
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+bool ByteReader::getBytes(void* dst, size_t size) {
+    if (remaining() < size) {
+        failed = true;
+        cur = end;
+        return false;
+    }
+    memcpy(dst, cur, size);
+    cur += size;
+    return true;
+}
+
+string ByteReader::getString() {
+    uint64_t size = getVarint();
+    if (!ok() || remaining() < size) {
+        failed = true;
+        cur = end;
+        return string();
+    }
+    string s(reinterpret_cast<const char*>(cur), static_cast<size_t>(size));
+    cur += size;
+    return s;
+}
+
+bool ByteReader::skip(size_t size) {
+    if (remaining() < size) {
+        failed = true;
+        cur = end;
+        return false;
+    }
+    cur += size;
+    return true;
+}
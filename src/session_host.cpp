@@ -0,0 +1,245 @@
+#include "session_host.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <iomanip>
+
+using namespace std;
+
+// ---------------------------------------------------------------------------
+// Jitter statistics
+// ---------------------------------------------------------------------------
+
+JitterStats::JitterStats() : samples(0), totalMicros(0), maxMicros(0) {
+    for (int i = 0; i < BUCKETS; ++i) buckets[i] = 0;
+}
+
+void JitterStats::add(int64_t micros) {
+    if (micros < 0) micros = 0;
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && (int64_t(1) << bucket) <= micros) ++bucket;
+    ++buckets[bucket];
+    ++samples;
+    totalMicros += micros;
+    maxMicros = max(maxMicros, micros);
+}
+
+void JitterStats::merge(const JitterStats& other) {
+    for (int i = 0; i < BUCKETS; ++i) buckets[i] += other.buckets[i];
+    samples += other.samples;
+    totalMicros += other.totalMicros;
+    maxMicros = max(maxMicros, other.maxMicros);
+}
+
+int64_t JitterStats::percentile(double p) const {
+    if (samples == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(p * samples);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > target) return int64_t(1) << i;
+    }
+    return maxMicros;
+}
+
+// ---------------------------------------------------------------------------
+// Session host
+// ---------------------------------------------------------------------------
+
+SessionHost::SessionHost(size_t sessionCount, size_t threadCount, uint64_t seed)
+    : pool(threadCount), stopping(false), inFlight(0), elapsed(0) {
+    Rng seeds(seed);
+    for (size_t i = 0; i < sessionCount; ++i) {
+        unique_ptr<Session> s(new Session());
+        s->game.setHeadless(true);
+        s->game.setReplayDirectory("");
+        s->game.newGame(1 + static_cast<int>(i % 2), seeds.next());
+        s->input.seed(seeds.next());
+        s->nextGhost.resize(s->game.getGhostCount());
+        s->ticks = 0;
+        s->gamesFinished = 0;
+        sessions.push_back(std::move(s));
+    }
+}
+
+SessionHost::~SessionHost() {
+    {
+        lock_guard<mutex> lock(timerMutex);
+        stopping = true;
+    }
+    timerCv.notify_all();
+    while (inFlight.load() > 0) {
+        this_thread::yield();
+    }
+}
+
+void SessionHost::schedule(size_t index, Clock::time_point when) {
+    {
+        lock_guard<mutex> lock(timerMutex);
+        if (stopping) return;
+        Due d;
+        d.when = when;
+        d.session = index;
+        timers.push(d);
+    }
+    timerCv.notify_one();
+}
+
+void SessionHost::runSession(size_t index, Clock::time_point due) {
+    TRACE_SCOPE_ARG("session", index);
+    Session& s = *sessions[index];
+    Clock::time_point now = Clock::now();
+    s.jitter.add(chrono::duration_cast<chrono::microseconds>(now - due).count());
+
+    const Clock::duration tickPeriod = chrono::milliseconds(Game::TICK_MS);
+    const Clock::duration ghostPeriod = chrono::milliseconds(Game::GHOST_STEP_MS);
+
+    // Run every step that is due, earliest first, exactly like the lock order
+    // the threaded game would produce
+    while (true) {
+        Clock::time_point next = s.nextPacman;
+        size_t ghost = s.nextGhost.size();
+        for (size_t g = 0; g < s.nextGhost.size(); ++g) {
+            if (s.nextGhost[g] < next) {
+                next = s.nextGhost[g];
+                ghost = g;
+            }
+        }
+        if (next > now) {
+            schedule(index, next);
+            break;
+        }
+
+        if (ghost == s.nextGhost.size()) {
+            s.game.tickPacman();
+            ++s.ticks;
+            // Stand-in for a player: occasionally turn
+            if (s.input.nextInt(8) == 0) {
+                static const char keys[4] = {'w', 'a', 's', 'd'};
+                s.game.applyInput(keys[s.input.nextInt(4)]);
+            }
+            s.nextPacman += tickPeriod;
+        } else {
+            s.game.stepGhost(ghost);
+            s.nextGhost[ghost] += ghostPeriod;
+        }
+
+        if (s.game.isOver()) {
+            ++s.gamesFinished;
+            s.game.newGame(s.game.getLevel(), s.input.next());
+        }
+    }
+    inFlight.fetch_sub(1);
+}
+
+void SessionHost::timerLoop() {
+    unique_lock<mutex> lock(timerMutex);
+    while (!stopping) {
+        if (timers.empty()) {
+            timerCv.wait(lock);
+            continue;
+        }
+        Due d = timers.top();
+        if (d.when > Clock::now()) {
+            timerCv.wait_until(lock, d.when);
+            continue;
+        }
+        timers.pop();
+        inFlight.fetch_add(1);
+        lock.unlock();
+        pool.submit([this, d]() { runSession(d.session, d.when); });
+        lock.lock();
+    }
+}
+
+void SessionHost::run(chrono::milliseconds duration) {
+    Clock::time_point start = Clock::now();
+    Rng offsets(sessions.size());
+
+    // Stagger sessions across a tick so they don't all fire together
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        Session& s = *sessions[i];
+        s.nextPacman = start + chrono::microseconds(offsets.nextInt(Game::TICK_MS * 1000));
+        for (auto& g : s.nextGhost) {
+            g = start + chrono::microseconds(offsets.nextInt(Game::GHOST_STEP_MS * 1000));
+        }
+        Clock::time_point first = s.nextPacman;
+        for (auto& g : s.nextGhost) first = min(first, g);
+        schedule(i, first);
+    }
+
+    thread timer(&SessionHost::timerLoop, this);
+    this_thread::sleep_for(duration);
+    {
+        lock_guard<mutex> lock(timerMutex);
+        stopping = true;
+    }
+    timerCv.notify_all();
+    timer.join();
+    while (inFlight.load() > 0) {
+        this_thread::yield();
+    }
+    elapsed = Clock::now() - start;
+}
+
+bool SessionHost::sustained() const {
+    JitterStats all;
+    for (const auto& s : sessions) all.merge(s->jitter);
+    return all.count() > 0 && all.percentile(0.99) <= Game::TICK_MS * 100;
+}
+
+void SessionHost::printReport(ostream& out) const {
+    JitterStats all;
+    uint64_t ticks = 0, games = 0;
+    int64_t worstSessionP99 = 0;
+    size_t mapBytes = 0;
+    for (const auto& s : sessions) {
+        all.merge(s->jitter);
+        mapBytes += s->game.getMapOwnedBytes();
+        ticks += s->ticks;
+        games += s->gamesFinished;
+        worstSessionP99 = max(worstSessionP99, s->jitter.percentile(0.99));
+    }
+    double seconds = chrono::duration<double>(elapsed).count();
+
+    out << "Sessions: " << sessions.size() << " on " << pool.size() << " worker thread(s) ("
+        << fixed << setprecision(1) << static_cast<double>(sessions.size()) / pool.size()
+        << " per core)" << endl;
+    out << "  Ran " << seconds << " s: " << ticks << " Pacman ticks ("
+        << static_cast<long>(seconds > 0 ? ticks / seconds : 0) << "/s), " << games << " games finished, "
+        << pool.getTaskCount() << " tasks, " << pool.getStealCount() << " steals" << endl;
+    out << "  Step lateness: mean " << all.mean() << " us, p50 <= " << all.percentile(0.50)
+        << " us, p99 <= " << all.percentile(0.99) << " us, max " << all.getMax() << " us" << endl;
+    out << "  Worst per-session p99: <= " << worstSessionP99 << " us" << endl;
+    if (!sessions.empty()) {
+        out << "  Map memory: " << mapBytes / sessions.size() << " B owned per session, "
+            << LevelData::acquire(1)->memoryBytes() << " B level data shared" << endl;
+    }
+    out << "  " << (sustained() ? "Sustained" : "NOT sustained") << " (p99 lateness budget "
+        << Game::TICK_MS * 100 << " us = 10% of a tick)" << endl;
+}
+
+int runSessionHost(size_t sessions, int seconds, size_t threads) {
+    chrono::milliseconds duration(seconds * 1000);
+
+    if (sessions > 0) {
+        SessionHost host(sessions, threads, 1);
+        host.run(duration);
+        host.printReport(cout);
+        return 0;
+    }
+
+    // Ramp: double the session count until the jitter budget is blown
+    size_t best = 0;
+    size_t workerCount = 0;
+    for (size_t n = 16; n <= (1u << 20); n *= 2) {
+        SessionHost host(n, threads, n);
+        host.run(duration);
+        host.printReport(cout);
+        workerCount = host.getThreadCount();
+        if (!host.sustained()) break;
+        best = n;
+    }
+    cout << "Max sustained: " << best << " sessions = "
+         << (workerCount ? best / workerCount : 0) << " per core" << endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "snapshot.hpp"
+#include "serialize.hpp"
+#include "level.hpp"
+
+using namespace std;
+
+GameSnapshot::GameSnapshot() : level(1), time(0), SMtime(0), score(0), lives(0), dotsEaten(0),
+                               maxDots(0), superMode(false), rngState(0), message(MessageId::ROUND_START),
+                               height(0), width(0) {
+    pacman.y = pacman.x = 0;
+    pacman.direction = '<';
+    pacman.alive = true;
+    pacman.under = ' ';
+}
+
+static void putEntity(vector<uint8_t>& out, const EntitySnapshot& e) {
+    putSignedVarint(out, e.y);
+    putSignedVarint(out, e.x);
+    putU8(out, static_cast<uint8_t>(e.direction));
+    putU8(out, e.alive ? 1 : 0);
+}
+
+static EntitySnapshot getEntity(ByteReader& in) {
+    EntitySnapshot e;
+    e.y = static_cast<int>(in.getSignedVarint());
+    e.x = static_cast<int>(in.getSignedVarint());
+    e.direction = static_cast<char>(in.getU8());
+    e.alive = in.getU8() != 0;
+    e.under = ' ';
+    return e;
+}
+
+void GameSnapshot::serialize(vector<uint8_t>& out) const {
+    serializeState(out);
+    if (layout) {
+        layout->write(out);
+    }
+}
+
+void GameSnapshot::serializeState(vector<uint8_t>& out) const {
+    putVarint(out, level);
+    putVarint(out, time);
+    putVarint(out, SMtime);
+    putSignedVarint(out, score);
+    putSignedVarint(out, lives);
+    putVarint(out, dotsEaten);
+    putVarint(out, maxDots);
+    putU8(out, superMode ? 1 : 0);
+    putU64(out, rngState);
+    putString(out, messageText(message));
+
+    putVarint(out, height);
+    putVarint(out, width);
+    putBytes(out, cells.data(), cells.size());
+
+    putEntity(out, pacman);
+    putVarint(out, ghosts.size());
+    for (const auto& g : ghosts) {
+        putEntity(out, g);
+    }
+    // Appended last: recordings made before ghosts kept the cell beneath them end here
+    for (const auto& g : ghosts) {
+        putU8(out, static_cast<uint8_t>(g.under));
+    }
+}
+
+bool GameSnapshot::deserialize(const uint8_t* data, size_t size) {
+    ByteReader in(data, size);
+    level = static_cast<int>(in.getVarint());
+    time = static_cast<int>(in.getVarint());
+    SMtime = static_cast<int>(in.getVarint());
+    score = static_cast<int>(in.getSignedVarint());
+    lives = static_cast<int>(in.getSignedVarint());
+    dotsEaten = static_cast<int>(in.getVarint());
+    maxDots = static_cast<int>(in.getVarint());
+    superMode = in.getU8() != 0;
+    rngState = in.getU64();
+    if (!messageFromText(in.getString(), message)) message = MessageId::ROUND_START;
+
+    height = static_cast<int>(in.getVarint());
+    width = static_cast<int>(in.getVarint());
+    if (!in.ok() || height < 0 || width < 0 ||
+        static_cast<size_t>(height) * static_cast<size_t>(width) > in.remaining()) {
+        return false;
+    }
+    cells.resize(static_cast<size_t>(height) * width);
+    in.getBytes(cells.data(), cells.size());
+
+    pacman = getEntity(in);
+    uint64_t ghostCount = in.getVarint();
+    if (!in.ok() || ghostCount > in.remaining()) return false;
+    ghosts.resize(static_cast<size_t>(ghostCount));
+    for (auto& g : ghosts) {
+        g = getEntity(in);
+    }
+    if (in.ok() && in.remaining() >= ghosts.size()) {
+        for (auto& g : ghosts) {
+            g.under = static_cast<char>(in.getU8());
+        }
+    }
+    // The build this snapshot held before (or the installed one) is reused
+    // when it matches, so keyframe after keyframe of one level shares a build
+    if (in.ok() && in.remaining() > 0) {
+        layout = LevelData::read(level, in, layout ? layout : LevelData::acquire(level));
+        if (!layout) return false;
+    } else {
+        layout.reset();
+    }
+    return in.ok();
+}
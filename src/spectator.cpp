@@ -0,0 +1,352 @@
+#include "spectator.hpp"
+#include "cursor_input.hpp"
+#include "ultils.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace std;
+
+const size_t SpectatorBroadcaster::RING_SLOTS;
+const int SpectatorBroadcaster::KEYFRAME_INTERVAL;
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+SpectatorBroadcaster::SpectatorBroadcaster()
+    : ring(RING_SLOTS), nextSeq(0), slotReserve(4096), ticksSinceKeyframe(0), keyframeRequested(true), listenFd(-1),
+      running(false), spectatorCount(0), droppedFrames(0) {
+    wakeFds[0] = wakeFds[1] = -1;
+    for (auto& slot : ring) {
+        slot.seq = 0;
+        slot.keyframe = false;
+        slot.bytes.reserve(slotReserve);
+    }
+    encoded.reserve(slotReserve);
+}
+
+SpectatorBroadcaster::~SpectatorBroadcaster() {
+    stop();
+}
+
+bool SpectatorBroadcaster::start(const string& socketPath) {
+    if (running) return true;
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) return false;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    unlink(socketPath.c_str());   // stale socket from a previous run
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listenFd, 16) != 0 || !setNonBlocking(listenFd) || pipe(wakeFds) != 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    setNonBlocking(wakeFds[0]);
+    setNonBlocking(wakeFds[1]);
+
+    path = socketPath;
+    running = true;
+    server = thread(&SpectatorBroadcaster::serverLoop, this);
+    return true;
+}
+
+void SpectatorBroadcaster::stop() {
+    if (!running) return;
+    running = false;
+    char c = 0;
+    if (write(wakeFds[1], &c, 1) < 0) {
+        // pipe full: the server is already awake
+    }
+    server.join();
+    ::close(listenFd);
+    ::close(wakeFds[0]);
+    ::close(wakeFds[1]);
+    listenFd = wakeFds[0] = wakeFds[1] = -1;
+    unlink(path.c_str());
+}
+
+void SpectatorBroadcaster::publish(const vector<string>& lines) {
+    bool keyframe = keyframeRequested.exchange(false) || ticksSinceKeyframe >= KEYFRAME_INTERVAL ||
+                    previous.size() != lines.size();
+
+    // Encode once, whatever the number of spectators
+    encoded.clear();
+    if (keyframe) {
+        encoded += "\033[?25l\033[2J";
+        ticksSinceKeyframe = 0;
+    } else {
+        ++ticksSinceKeyframe;
+    }
+    if (previous.size() != lines.size()) {
+        previous.resize(lines.size());
+    }
+    char cursor[24];
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (!keyframe && lines[i] == previous[i]) continue;
+        int length = snprintf(cursor, sizeof(cursor), "\033[%zu;1H", i + 1);
+        encoded.append(cursor, static_cast<size_t>(length));
+        encoded += lines[i];
+        encoded += "\033[0m\033[K";
+        if (previous[i].capacity() < lines[i].size()) {
+            previous[i].reserve(lines[i].size() * 2);   // room for the row to grow (HUD, messages)
+        }
+        previous[i].assign(lines[i]);
+    }
+    if (encoded.empty()) return;
+
+    {
+        lock_guard<mutex> lock(ringMutex);
+        if (encoded.size() > slotReserve) {
+            // Every slot takes a keyframe sooner or later, so size them all at once
+            slotReserve = encoded.size() * 2;
+            for (auto& s : ring) s.bytes.reserve(slotReserve);
+        }
+        Slot& slot = ring[nextSeq % RING_SLOTS];
+        slot.seq = nextSeq;
+        slot.keyframe = keyframe;
+        slot.bytes.assign(encoded);
+        ++nextSeq;
+    }
+    char c = 1;
+    if (write(wakeFds[1], &c, 1) < 0) {
+        // pipe full: the server has wakeups pending already
+    }
+}
+
+// Load the client's next message into its pending buffer. Returns false if
+// there is nothing new to send.
+bool SpectatorBroadcaster::fillPending(Client& client) {
+    lock_guard<mutex> lock(ringMutex);
+    uint64_t oldest = nextSeq > RING_SLOTS ? nextSeq - RING_SLOTS : 0;
+    if (client.nextSeq == UINT64_MAX || client.nextSeq < oldest) {
+        // Just connected or lapped: resume at the newest keyframe still in the ring
+        uint64_t resume = UINT64_MAX;
+        for (uint64_t seq = nextSeq; seq > oldest; --seq) {
+            const Slot& slot = ring[(seq - 1) % RING_SLOTS];
+            if (slot.keyframe && slot.seq == seq - 1) {
+                resume = seq - 1;
+                break;
+            }
+        }
+        if (resume == UINT64_MAX) {
+            keyframeRequested = true;
+            client.nextSeq = UINT64_MAX;
+            return false;
+        }
+        if (client.nextSeq != UINT64_MAX) {
+            droppedFrames += resume - client.nextSeq;
+        }
+        client.nextSeq = resume;
+    }
+    if (client.nextSeq >= nextSeq) return false;
+
+    const Slot& slot = ring[client.nextSeq % RING_SLOTS];
+    client.pending.assign(slot.bytes);
+    client.offset = 0;
+    ++client.nextSeq;
+    return true;
+}
+
+// Write as much as the socket takes. Returns false if the client went away.
+bool SpectatorBroadcaster::flushClient(Client& client) {
+    while (true) {
+        if (client.offset >= client.pending.size()) {
+            if (!fillPending(client)) return true;
+        }
+        ssize_t n = send(client.fd, client.pending.data() + client.offset,
+                         client.pending.size() - client.offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            client.offset += static_cast<size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+}
+
+// Rounds of one send per client that has bytes to go, each round one
+// io_uring_enter. A client the socket turned away (EAGAIN) waits for POLLOUT
+// like in flushClient; the rounds stop once nobody made progress.
+void SpectatorBroadcaster::flushClientsRing(vector<Client>& clients, IoRing& sender,
+                                            vector<IoRing::Completion>& completions) {
+    vector<size_t> stalled;   // client indices turned away this flush
+    while (true) {
+        size_t queued = 0;
+        for (size_t i = 0; i < clients.size(); ++i) {
+            Client& c = clients[i];
+            if (c.fd < 0 || find(stalled.begin(), stalled.end(), i) != stalled.end()) continue;
+            if (c.offset >= c.pending.size() && !fillPending(c)) continue;
+            if (!sender.queueSend(c.fd, c.pending.data() + c.offset, c.pending.size() - c.offset, i)) break;
+            ++queued;
+        }
+        if (queued == 0) return;
+        if (!sender.submitAndWait(completions)) {
+            sender.close();   // the next iteration uses send(2)
+            return;
+        }
+
+        bool progressed = false;
+        for (size_t i = 0; i < completions.size(); ++i) {
+            Client& c = clients[completions[i].tag];
+            int n = completions[i].result;
+            if (n > 0) {
+                c.offset += static_cast<size_t>(n);
+                progressed = true;
+            } else if (n == -EAGAIN) {
+                stalled.push_back(completions[i].tag);
+            } else if (n != -EINTR) {
+                ::close(c.fd);
+                c.fd = -1;
+            }
+        }
+        if (!progressed) return;
+    }
+}
+
+void SpectatorBroadcaster::serverLoop() {
+    vector<Client> clients;
+    vector<pollfd> fds;
+    IoRing sender;
+    vector<IoRing::Completion> completions;
+    if (getIoBackend() == IoBackend::URING) {
+        string error;
+        sender.open(64, error);   // stays closed (send(2)) if io_uring is unavailable
+    }
+
+    while (running) {
+        fds.clear();
+        pollfd p;
+        p.fd = wakeFds[0];
+        p.events = POLLIN;
+        fds.push_back(p);
+        p.fd = listenFd;
+        fds.push_back(p);
+        for (const auto& c : clients) {
+            p.fd = c.fd;
+            // Only ask for POLLOUT while a partial write is waiting on the socket
+            p.events = POLLIN | (c.offset < c.pending.size() ? POLLOUT : 0);
+            fds.push_back(p);
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+        if (!running) break;
+
+        if (fds[0].revents & POLLIN) {
+            char drain[256];
+            while (read(wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+
+        size_t polled = clients.size();
+        if (fds[1].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+                setNonBlocking(fd);
+                Client c;
+                c.fd = fd;
+                c.nextSeq = UINT64_MAX;   // start at a keyframe
+                c.offset = 0;
+                clients.push_back(c);
+                keyframeRequested = true;
+            }
+        }
+
+        // Spectators are read-only: input is discarded, EOF/error closes them
+        for (size_t i = 0; i < polled; ++i) {
+            short revents = fds[i + 2].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                char discard[256];
+                ssize_t n = recv(clients[i].fd, discard, sizeof(discard), 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    ::close(clients[i].fd);
+                    clients[i].fd = -1;
+                }
+            }
+        }
+
+        if (sender.isOpen()) {
+            flushClientsRing(clients, sender, completions);
+        } else {
+            for (auto& c : clients) {
+                if (c.fd >= 0 && !flushClient(c)) {
+                    ::close(c.fd);
+                    c.fd = -1;
+                }
+            }
+        }
+
+        size_t alive = 0;
+        for (size_t i = 0; i < clients.size(); ++i) {
+            if (clients[i].fd >= 0) clients[alive++] = clients[i];
+        }
+        clients.resize(alive);
+        spectatorCount = alive;
+    }
+
+    for (auto& c : clients) {
+        ::close(c.fd);
+    }
+    spectatorCount = 0;
+}
+
+int runSpectator(const string& socketPath) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        cerr << "Error: cannot connect to " << socketPath << endl;
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    clearScreen();
+    hideCursor();
+    cout.flush();
+
+    char buf[8192];
+    while (true) {
+        pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = STDIN_FILENO;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) break;
+
+        if (fds[1].revents & POLLIN) {
+            InputKey key = getInputKey();
+            if (key == InputKey::Q || key == InputKey::ESC) break;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            if (write(STDOUT_FILENO, buf, static_cast<size_t>(n)) < 0) break;
+        }
+    }
+    ::close(fd);
+
+    cout << "\033[0m" << endl;
+    showCursor();
+    cout << "Spectating ended." << endl;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "strategy_plugin.hpp"
+#include <dlfcn.h>
+
+using namespace std;
+
+StrategyPlugin::StrategyPlugin() : library(nullptr), strategy(nullptr), state(nullptr), calls(0) {}
+
+StrategyPlugin::~StrategyPlugin() {
+    unload();
+}
+
+void StrategyPlugin::unload() {
+    if (strategy && strategy->destroy) {
+        strategy->destroy(state);
+    }
+    strategy = nullptr;
+    state = nullptr;
+    if (library) {
+        dlclose(library);
+        library = nullptr;
+    }
+}
+
+bool StrategyPlugin::load(const string& path, string& error) {
+    unload();
+    // A bare name would be searched for on the library path, not in the current directory
+    string file = path.find('/') == string::npos ? "./" + path : path;
+    library = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        error = dlerror();
+        return false;
+    }
+
+    PacmanStrategyEntry entry = reinterpret_cast<PacmanStrategyEntry>(dlsym(library, PACMAN_STRATEGY_ENTRY));
+    const PacmanGhostStrategy* found = entry ? entry() : nullptr;
+    if (!found || !found->decide) {
+        error = "no " PACMAN_STRATEGY_ENTRY " strategy in " + path;
+        unload();
+        return false;
+    }
+    if (found->abiVersion != PACMAN_STRATEGY_ABI_VERSION) {
+        error = "strategy ABI version " + to_string(found->abiVersion) + ", expected " +
+                to_string(PACMAN_STRATEGY_ABI_VERSION);
+        unload();
+        return false;
+    }
+
+    strategy = found;
+    state = strategy->create ? strategy->create() : nullptr;
+    return true;
+}
+
+void StrategyPlugin::decide(const PacmanGameView& view, uint8_t* directions) {
+    ++calls;
+    strategy->decide(state, &view, directions);
+}
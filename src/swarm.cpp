@@ -0,0 +1,233 @@
+#include "swarm.hpp"
+#include "game.hpp"
+#include "thread_pool.hpp"
+#include "tournament.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// Cells a ghost can step to from 'cell'
+static int openNeighbours(const LevelData& level, int cell, int out[4]) {
+    int w = level.getWidth();
+    int y = cell / w;
+    int x = cell % w;
+    uint8_t nav = level.navAt(y, x);
+    int count = 0;
+    if (nav & LevelData::NAV_UP) out[count++] = cell - w;
+    if (nav & LevelData::NAV_DOWN) out[count++] = cell + w;
+    if (nav & LevelData::NAV_LEFT) out[count++] = cell - 1;
+    if (nav & LevelData::NAV_RIGHT) out[count++] = cell + 1;
+
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (level.terrainAt(out[i] / w, out[i] % w) == LevelData::FLOOR) out[kept++] = out[i];
+    }
+    return kept;
+}
+
+// ---------------------------------------------------------------------------
+// Flow field
+// ---------------------------------------------------------------------------
+
+FlowField::FlowField(shared_ptr<const LevelData> data) : level(data), target(-1) {
+    size_t cells = static_cast<size_t>(level->getHeight()) * level->getWidth();
+    nextCell.resize(cells);
+    queue.resize(cells);
+}
+
+void FlowField::compute(int targetCell) {
+    TRACE_SCOPE("swarm.field");
+    target = targetCell;
+    for (size_t i = 0; i < nextCell.size(); ++i) {
+        nextCell[i] = static_cast<int32_t>(i);
+    }
+    // A cell is reached once it points at a neighbour; the target keeps
+    // pointing at itself and is only ever seeded
+    size_t head = 0, tail = 0;
+    queue[tail++] = targetCell;
+    int around[4];
+    while (head < tail) {
+        int cell = queue[head++];
+        int count = openNeighbours(*level, cell, around);
+        for (int i = 0; i < count; ++i) {
+            int n = around[i];
+            if (n == targetCell || nextCell[n] != n) continue;
+            nextCell[n] = cell;
+            queue[tail++] = n;
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const int ARENA_SIZE = LevelData::MAX_SIDE;
+
+struct SwarmRun {
+    size_t ghosts;
+    size_t threads;
+    double seconds;
+    uint64_t ticks;
+    uint64_t fieldBuilds;
+    double fieldMicros;     // wall time of the field updates
+    double ghostMicros;     // wall time of every stepGhost, field updates included
+    uint64_t captures;      // lives Pacman lost
+};
+
+// Open ground for the stress run: a wall round the edge, a pillar on every
+// other cell of every other row, dots on the rest and a ghost spawn in each
+// corner. Wide open floor is the worst case for a field's BFS.
+shared_ptr<const LevelData> buildArena() {
+    vector<string> rows(ARENA_SIZE, string(ARENA_SIZE, '.'));
+    for (int y = 0; y < ARENA_SIZE; ++y) {
+        for (int x = 0; x < ARENA_SIZE; ++x) {
+            bool edge = y == 0 || x == 0 || y == ARENA_SIZE - 1 || x == ARENA_SIZE - 1;
+            if (edge || (y % 2 == 0 && x % 2 == 0)) rows[y][x] = '#';
+        }
+    }
+    vector<LevelData::Spawn> spawns;
+    const int far = ARENA_SIZE - 2;
+    const int corners[4][2] = {{1, 1}, {1, far}, {far, 1}, {far, far}};
+    for (const auto& corner : corners) {
+        LevelData::Spawn spawn;
+        spawn.y = corner[0];
+        spawn.x = corner[1];
+        rows[spawn.y][spawn.x] = ' ';
+        spawns.push_back(spawn);
+    }
+    rows[ARENA_SIZE / 2 | 1][ARENA_SIZE / 2 | 1] = '<';
+    return LevelData::fromRows(LevelData::FILE_LEVEL, rows, -1, spawns);
+}
+
+// The evasive autopilot plays Pacman; every ghost steps every tick
+SwarmRun runEngine(size_t ghosts, size_t threads, chrono::milliseconds duration, const string& strategyPath) {
+    typedef chrono::steady_clock Clock;
+    unique_ptr<WorkStealingPool> pool;
+    if (threads > 1) pool.reset(new WorkStealingPool(threads - 1));
+
+    Game game;
+    game.setHeadless(true);
+    game.setReplayDirectory("");
+    game.setSwarm(ghosts, pool.get());
+    string error;
+    if (!strategyPath.empty()) game.loadStrategy(strategyPath, error);
+    game.newGame(LevelData::FILE_LEVEL, 1);
+    PacmanBot bot;
+    bot.reset(PacmanPolicy::EVASIVE, 1);
+
+    SwarmRun run;
+    run.ghosts = ghosts;
+    run.threads = threads;
+    run.ticks = 0;
+    run.captures = 0;
+    run.ghostMicros = 0;
+    uint64_t buildsBefore = game.getFlowBuilds();
+    Clock::duration fieldBefore = game.getFlowTime();
+    Clock::time_point start = Clock::now();
+    Clock::time_point stop = start + duration;
+    do {
+        if (game.isOver()) game.newGame(LevelData::FILE_LEVEL, run.ticks + 1);
+        int lives = game.getLives();
+        char key = bot.decide(game);
+        if (key) game.applyInput(key);
+        game.tickPacman();
+        Clock::time_point ghostStart = Clock::now();
+        for (size_t g = 0; g < game.getGhostCount(); ++g) game.stepGhost(g);
+        run.ghostMicros += chrono::duration<double, micro>(Clock::now() - ghostStart).count();
+        if (game.getLives() < lives) ++run.captures;
+        ++run.ticks;
+    } while (Clock::now() < stop);
+    run.seconds = chrono::duration<double>(Clock::now() - start).count();
+    run.fieldBuilds = game.getFlowBuilds() - buildsBefore;
+    run.fieldMicros = chrono::duration<double, micro>(game.getFlowTime() - fieldBefore).count();
+    return run;
+}
+
+void printHeader() {
+    cout << setw(9) << "ghosts" << setw(9) << "threads" << setw(11) << "ticks/s" << setw(12) << "Msteps/s"
+         << setw(10) << "speedup" << setw(10) << "fields/s" << setw(11) << "us/field" << setw(10) << "field %"
+         << setw(10) << "us/step" << setw(10) << "captures" << endl;
+}
+
+void printRow(const SwarmRun& run, double baselineTicksPerSecond) {
+    double tps = run.ticks / run.seconds;
+    double steps = static_cast<double>(run.ticks) * run.ghosts;
+    double tickMicros = run.seconds * 1e6;
+    cout << fixed << setw(9) << run.ghosts << setw(9) << run.threads
+         << setw(11) << setprecision(1) << tps
+         << setw(12) << setprecision(2) << tps * run.ghosts / 1e6
+         << setw(9) << setprecision(2) << (baselineTicksPerSecond > 0 ? tps / baselineTicksPerSecond : 0.0) << "x"
+         << setw(10) << setprecision(1) << run.fieldBuilds / run.seconds
+         << setw(11) << setprecision(1) << (run.fieldBuilds ? run.fieldMicros / run.fieldBuilds : 0.0)
+         << setw(9) << setprecision(1) << 100.0 * run.fieldMicros / tickMicros << "%"
+         << setw(10) << setprecision(3) << (run.ghostMicros - run.fieldMicros) / max(steps, 1.0)
+         << setw(10) << run.captures << endl;
+}
+
+} // namespace
+
+int runSwarmBenchmark(size_t ghosts, int seconds, size_t threads, const string& strategyPath) {
+    shared_ptr<const LevelData> arena = buildArena();
+    LevelData::install(arena);
+    size_t floorCells = 0;
+    for (int y = 0; y < ARENA_SIZE; ++y) {
+        for (int x = 0; x < ARENA_SIZE; ++x) {
+            floorCells += arena->terrainAt(y, x) == LevelData::FLOOR;
+        }
+    }
+    // Ghosts block each other, so leave half the floor free to move into
+    const size_t maxGhosts = floorCells / 2;
+    if (!strategyPath.empty()) {
+        StrategyPlugin plugin;
+        string error;
+        if (!plugin.load(strategyPath, error)) {
+            cerr << "Error: cannot load strategy " << strategyPath << ": " << error << endl;
+            return 1;
+        }
+    }
+    chrono::milliseconds duration(seconds * 1000);
+
+    vector<size_t> ghostCounts;
+    if (ghosts > 0) {
+        ghostCounts.push_back(min(ghosts, maxGhosts));
+    } else {
+        for (size_t n = 16; n < maxGhosts; n *= 8) ghostCounts.push_back(n);
+        ghostCounts.push_back(maxGhosts);
+    }
+    vector<size_t> threadCounts;
+    if (threads > 0) {
+        if (threads > 1) threadCounts.push_back(1);   // baseline for the speedup column
+        threadCounts.push_back(threads);
+    } else {
+        size_t cores = max(1u, thread::hardware_concurrency());
+        for (size_t t = 1; t < cores; t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(cores);
+    }
+
+    cout << "Ghost swarm in the game engine on a " << ARENA_SIZE << "x" << ARENA_SIZE << " arena (" << floorCells
+         << " floor cells, at most " << maxGhosts << " ghosts), " << seconds << " s per run";
+    if (!strategyPath.empty()) cout << ", strategy " << strategyPath;
+    cout << endl;
+    if (ghosts > maxGhosts) cout << "  " << ghosts << " ghosts don't fit; running " << maxGhosts << endl;
+    printHeader();
+    for (size_t n : ghostCounts) {
+        double baseline = 0;
+        for (size_t t : threadCounts) {
+            SwarmRun run = runEngine(n, t, duration, strategyPath);
+            if (baseline == 0) baseline = run.ticks / run.seconds;
+            printRow(run, baseline);
+        }
+    }
+    cout << "  Real time needs " << 1000.0 / Game::TICK_MS << " ticks/s. Fields build side by side on the pool;"
+         << " ghost steps share the map and run one at a time under the game lock." << endl;
+    return 0;
+}
@@ -0,0 +1,35 @@
+#include "terminal_geometry.hpp"
+#include "cursor_input.hpp"
+#include <atomic>
+#include <csignal>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static atomic<uint64_t> generation(1);
+
+static void onResize(int) {
+    generation.fetch_add(1, memory_order_relaxed);
+    wakeInputWait();
+}
+
+void installResizeHandler() {
+    signal(SIGWINCH, onResize);
+}
+
+uint64_t resizeGeneration() {
+    return generation.load(memory_order_relaxed);
+}
+
+TerminalGeometry queryTerminalGeometry() {
+    TerminalGeometry geometry;
+    geometry.rows = 0;
+    geometry.cols = 0;
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) {
+        geometry.rows = size.ws_row;
+        geometry.cols = size.ws_col;
+    }
+    return geometry;
+}
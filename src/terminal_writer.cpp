@@ -0,0 +1,146 @@
+#include "terminal_writer.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+
+using namespace std;
+
+TerminalWriter::TerminalWriter(int outFd) : fd(outFd), hasQueued(false), busy(false), stopping(false),
+                                            bytesWritten(0), writeCalls(0), framesWritten(0),
+                                            framesDropped(0), usingRing(false) {
+}
+
+static const unsigned RING_ENTRIES = 4;
+static const size_t RING_BUFFER_BYTES = 64 * 1024;   // larger frames go out in pieces
+
+TerminalWriter::~TerminalWriter() {
+    if (!writer.joinable()) return;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work.notify_all();
+    writer.join();
+}
+
+void TerminalWriter::submit(string& frame) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!writer.joinable()) {
+            writer = thread(&TerminalWriter::writerLoop, this);
+        }
+        if (hasQueued) {
+            framesDropped.fetch_add(1, memory_order_relaxed);
+        }
+        queued.swap(frame);
+        hasQueued = true;
+    }
+    work.notify_one();
+}
+
+void TerminalWriter::drain() {
+    unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !hasQueued && !busy; });
+}
+
+void TerminalWriter::reserve(size_t bytes) {
+    unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return !hasQueued && !busy; });
+    queued.reserve(bytes);
+    writing.reserve(bytes);   // idle: the writer thread only touches it after taking a frame
+}
+
+void TerminalWriter::writerLoop() {
+    TRACE_THREAD_NAME("terminal writer");
+    if (getIoBackend() == IoBackend::URING) {
+        string error;
+        if (ring.open(RING_ENTRIES, error) && ring.registerBuffers(1, RING_BUFFER_BYTES, error)) {
+            completions.reserve(RING_ENTRIES);
+            usingRing = true;
+        } else {
+            ring.close();   // stay on write(2)
+        }
+    }
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work.wait(lock, [this]() { return hasQueued || stopping; });
+        if (!hasQueued) break;    // stopping with nothing left to write
+
+        writing.swap(queued);
+        hasQueued = false;
+        busy = true;
+        lock.unlock();
+
+        {
+            TRACE_SCOPE("terminal.write");
+            if (writeAll(writing)) {
+                framesWritten.fetch_add(1, memory_order_relaxed);
+                if (onFrameWritten) onFrameWritten();
+            }
+        }
+
+        lock.lock();
+        busy = false;
+        if (!hasQueued) idle.notify_all();
+    }
+}
+
+bool TerminalWriter::writeAll(const string& bytes) {
+    if (ring.isOpen()) return writeAllRing(bytes);
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + offset, bytes.size() - offset);
+        writeCalls.fetch_add(1, memory_order_relaxed);
+        if (n > 0) {
+            offset += static_cast<size_t>(n);
+            bytesWritten.fetch_add(static_cast<uint64_t>(n), memory_order_relaxed);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            waitWritable();
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TerminalWriter::writeAllRing(const string& bytes) {
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        size_t chunk = min(bytes.size() - offset, ring.bufferSize());
+        memcpy(ring.buffer(0), bytes.data() + offset, chunk);
+        size_t sent = 0;
+        while (sent < chunk) {
+            ring.queueWrite(fd, 0, sent, chunk - sent, 0);
+            writeCalls.fetch_add(1, memory_order_relaxed);
+            if (!ring.submitAndWait(completions) || completions.empty()) {
+                ring.close();
+                usingRing = false;
+                return writeAll(bytes.substr(offset + sent));
+            }
+            int n = completions[0].result;
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+                bytesWritten.fetch_add(static_cast<uint64_t>(n), memory_order_relaxed);
+            } else if (n == -EAGAIN) {
+                waitWritable();
+            } else if (n != -EINTR) {
+                return false;
+            }
+        }
+        offset += chunk;
+    }
+    return true;
+}
+
+// stdout is non-blocking (it shares its file description with stdin); only
+// this thread waits for the terminal to drain
+void TerminalWriter::waitWritable() {
+    pollfd p;
+    p.fd = fd;
+    p.events = POLLOUT;
+    poll(&p, 1, -1);
+}
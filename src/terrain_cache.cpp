@@ -0,0 +1,93 @@
+#include "terrain_cache.hpp"
+#include "ultils.hpp"
+
+using namespace std;
+
+TerrainCache::TerrainCache() : width(0) {}
+
+void TerrainCache::build(const shared_ptr<const LevelData>& data) {
+    level = data;
+    width = data->getWidth();
+    int height = data->getHeight();
+    size_t cells = static_cast<size_t>(height) * width;
+
+    bytes.clear();
+    offsets.resize(static_cast<size_t>(height) * (width + 1));
+    baseCells.resize(cells);
+    colours.resize(cells);
+    runStarts.resize(cells);
+
+    for (int y = 0; y < height; ++y) {
+        bakeRow(*data, y, bytes, 0);
+    }
+}
+
+void TerrainCache::update(const shared_ptr<const LevelData>& data, const LevelData::Region& changed) {
+    if (!level || data->getWidth() != width || data->getHeight() != level->getHeight()) {
+        build(data);
+        return;
+    }
+    level = data;
+    if (changed.empty()) return;
+
+    // Rows are baked back to back, so re-baked rows are spliced in and the
+    // offsets of every row below them move by the change in length
+    uint32_t begin = offsets[static_cast<size_t>(changed.top) * (width + 1)];
+    uint32_t end = offsets[static_cast<size_t>(changed.bottom) * (width + 1) + width];
+    string rebaked;
+    for (int y = changed.top; y <= changed.bottom; ++y) {
+        bakeRow(*data, y, rebaked, begin);
+    }
+    bytes.replace(begin, end - begin, rebaked);
+    uint32_t shift = static_cast<uint32_t>(rebaked.size()) - (end - begin);   // wraps when shorter; sums stay exact
+    for (size_t i = static_cast<size_t>(changed.bottom + 1) * (width + 1); i < offsets.size(); ++i) {
+        offsets[i] += shift;
+    }
+}
+
+// Appends row y to 'out', recording each cell's offset as base + its position in 'out'
+void TerrainCache::bakeRow(const LevelData& data, int y, string& out, uint32_t base) {
+    uint32_t* rowOffsets = &offsets[static_cast<size_t>(y) * (width + 1)];
+    for (int x = 0; x < width; ++x) {
+        char cell = ' ';
+        TextColor colour = WHITE;
+        switch (data.terrainAt(y, x)) {
+            case LevelData::WALL:
+                cell = '#';
+                colour = BLUE;
+                break;
+            case LevelData::PORTAL:
+                cell = data.initialRow(y)[x];
+                colour = CYAN;
+                break;
+            default:
+                break;
+        }
+
+        size_t i = index(y, x);
+        baseCells[i] = cell;
+        colours[i] = static_cast<uint8_t>(colour);
+        runStarts[i] = (x == 0 || colours[i - 1] != colours[i]) ? 1 : 0;
+
+        rowOffsets[x] = base + static_cast<uint32_t>(out.size());
+        if (runStarts[i]) {
+            appendTextColor(out, colour);
+        }
+        if (cell == '#') {
+            out += BLOCK_FULL;
+        } else {
+            out += cell;
+        }
+    }
+    rowOffsets[width] = base + static_cast<uint32_t>(out.size());
+}
+
+void TerrainCache::appendSpan(string& out, int y, int x0, int x1) const {
+    if (x0 >= x1) return;
+    // Starting mid-run: the escape that set this colour isn't in the span
+    if (!runStarts[index(y, x0)]) {
+        appendTextColor(out, static_cast<TextColor>(colours[index(y, x0)]));
+    }
+    const uint32_t* rowOffsets = &offsets[static_cast<size_t>(y) * (width + 1)];
+    out.append(bytes, rowOffsets[x0], rowOffsets[x1] - rowOffsets[x0]);
+}
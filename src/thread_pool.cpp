@@ -0,0 +1,97 @@
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+using namespace std;
+
+// Index of the pool worker running on this thread, or -1 outside the pool
+static thread_local long currentWorker = -1;
+static thread_local const WorkStealingPool* currentPool = nullptr;
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+    : stopping(false), nextWorker(0), queued(0), steals(0), executed(0) {
+    if (threadCount == 0) {
+        threadCount = thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1;
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.push_back(unique_ptr<Worker>(new Worker()));
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCv.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void WorkStealingPool::submit(function<void()> task) {
+    size_t target;
+    if (currentPool == this && currentWorker >= 0) {
+        target = static_cast<size_t>(currentWorker);   // keep follow-up work local
+    } else {
+        target = nextWorker.fetch_add(1) % workers.size();
+    }
+    {
+        lock_guard<mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+    {
+        // Taking the lock orders this notify after a worker's empty check
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    sleepCv.notify_one();
+}
+
+bool WorkStealingPool::popLocal(size_t index, function<void()>& task) {
+    Worker& w = *workers[index];
+    lock_guard<mutex> lock(w.mutex);
+    if (w.tasks.empty()) return false;
+    task = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, function<void()>& task) {
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker& victim = *workers[(thief + i) % workers.size()];
+        unique_lock<mutex> lock(victim.mutex, try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        steals.fetch_add(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    currentWorker = static_cast<long>(index);
+    currentPool = this;
+    TRACE_THREAD_NAME("pool worker");
+
+    function<void()> task;
+    while (true) {
+        if (popLocal(index, task) || steal(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            task = nullptr;
+            executed.fetch_add(1);
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepMutex);
+        if (stopping) break;
+        if (queued.load() > 0) continue;   // work arrived (or a steal raced) - retry
+        sleepCv.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping) break;
+    }
+}
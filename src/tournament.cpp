@@ -0,0 +1,644 @@
+#include "tournament.hpp"
+#include "level.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+struct Move {
+    int dy;
+    int dx;
+    char key;
+};
+
+// Keys as Pacman::move reads them
+const Move MOVES[4] = {{-1, 0, 'w'}, {1, 0, 's'}, {0, -1, 'a'}, {0, 1, 'd'}};
+
+const char* const POLICY_NAMES[] = {"random", "greedy", "evasive"};
+
+const size_t NEAR_FOOD_CELLS = 4096;   // BFS reach on large levels; food farther off is routed to
+
+const char* const CSV_HEADER = "strategy,policy,level,seed,won,ticks,dots,max_dots,deaths,ghosts_eaten,score";
+const size_t CSV_FIELDS = 11;
+
+bool isGhostCell(char cell) {
+    return cell == 'M' || cell == 'W' || cell == 'Y' || cell == 'U';
+}
+
+} // namespace
+
+const char* policyName(PacmanPolicy policy) {
+    return POLICY_NAMES[static_cast<int>(policy)];
+}
+
+bool parsePolicy(const string& name, PacmanPolicy& policy) {
+    for (int i = 0; i < 3; ++i) {
+        if (name == POLICY_NAMES[i]) {
+            policy = static_cast<PacmanPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Pacman bot
+// ---------------------------------------------------------------------------
+
+PacmanBot::PacmanBot() : policy(PacmanPolicy::RANDOM), width(0), stamp(0), farFood(-1) {
+}
+
+void PacmanBot::reset(PacmanPolicy p, uint64_t seed) {
+    policy = p;
+    rng.seed(seed ^ 0x9e3779b97f4a7c15ULL);
+}
+
+char PacmanBot::decide(const Game& game) {
+    switch (policy) {
+        case PacmanPolicy::RANDOM:
+            return rng.nextInt(4) == 0 ? MOVES[rng.nextInt(4)].key : 0;
+        case PacmanPolicy::GREEDY:
+            return nearestFood(game, false, false);
+        case PacmanPolicy::EVASIVE: {
+            // Frightened ghosts are food too; otherwise keep clear of them
+            if (game.isSuperMode()) return nearestFood(game, false, true);
+            char key = nearestFood(game, true, false);
+            return key ? key : safestStep(game);
+        }
+    }
+    return 0;
+}
+
+bool PacmanBot::passable(const Map& map, int y, int x) const {
+    char cell = map.getCell(y, x);
+    return cell != '#' && cell != '[' && cell != ']';
+}
+
+// BFS from Pacman to the closest dot or pellet (or ghost, when hunting);
+// returns the key for its first step
+char PacmanBot::nearestFood(const Game& game, bool avoidGhosts, bool huntGhosts) {
+    const Map& map = game.getMap();
+    int w = map.getWidth();
+    size_t cells = static_cast<size_t>(map.getHeight()) * w;
+    if (w != width || queue.size() != cells) {
+        width = w;
+        queue.assign(cells, 0);
+        seen.assign(cells, 0);
+        firstMove.assign(cells, 0);
+        danger.assign(cells, 0);
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        fill(seen.begin(), seen.end(), 0u);
+        fill(danger.begin(), danger.end(), 0u);
+        stamp = 1;
+    }
+    if (map.shareLevelData() != routesLevel) {
+        routesLevel = map.shareLevelData();
+        if (HierarchicalPathfinder::suits(*routesLevel)) {
+            routes.reset(new HierarchicalPathfinder(*routesLevel));
+        } else {
+            routes.reset();
+        }
+        farFood = -1;
+    }
+    size_t reach = routes ? NEAR_FOOD_CELLS : cells;
+
+    if (avoidGhosts) {
+        for (size_t i = 0; i < game.getGhostCount(); ++i) {
+            const Ghost& ghost = game.getGhost(i);
+            if (!ghost.isAlive()) continue;
+            int gy = ghost.getY();
+            int gx = ghost.getX();
+            if (map.isValidPosition(gy, gx)) danger[gy * w + gx] = stamp;
+            for (int m = 0; m < 4; ++m) {
+                int y = gy + MOVES[m].dy;
+                int x = gx + MOVES[m].dx;
+                if (map.isValidPosition(y, x)) danger[y * w + x] = stamp;
+            }
+        }
+    }
+
+    const Pacman& pacman = game.getPacman();
+    int start = pacman.getY() * w + pacman.getX();
+    seen[start] = stamp;
+    size_t head = 0, tail = 0;
+    for (int m = 0; m < 4; ++m) {
+        int y = pacman.getY() + MOVES[m].dy;
+        int x = pacman.getX() + MOVES[m].dx;
+        if (!passable(map, y, x)) continue;
+        int cell = y * w + x;
+        if (danger[cell] == stamp || seen[cell] == stamp) continue;
+        seen[cell] = stamp;
+        firstMove[cell] = static_cast<uint8_t>(m);
+        queue[tail++] = cell;
+    }
+    while (head < tail) {
+        if (head == reach) return routeToFood(game, avoidGhosts);
+        int cell = queue[head++];
+        int cy = cell / w;
+        int cx = cell % w;
+        char contents = map.getCell(cy, cx);
+        if (contents == '.' || contents == 'O' || (huntGhosts && isGhostCell(contents))) {
+            return MOVES[firstMove[cell]].key;
+        }
+        for (int m = 0; m < 4; ++m) {
+            int y = cy + MOVES[m].dy;
+            int x = cx + MOVES[m].dx;
+            if (!passable(map, y, x)) continue;
+            int next = y * w + x;
+            if (danger[next] == stamp || seen[next] == stamp) continue;
+            seen[next] = stamp;
+            firstMove[next] = firstMove[cell];
+            queue[tail++] = next;
+        }
+    }
+    return 0;
+}
+
+// Nothing to eat within the BFS reach of a large level: route to the food
+// nearest Pacman as the crow flies, kept as the goal until it's gone
+char PacmanBot::routeToFood(const Game& game, bool avoidGhosts) {
+    const Map& map = game.getMap();
+    if (farFood < 0 || !LevelData::countsTowardClear(map.getCell(farFood / width, farFood % width))) {
+        farFood = -1;
+        int best = INT_MAX;
+        for (int y = 0; y < map.getHeight(); ++y) {
+            const char* row = map.getRow(y);
+            for (int x = 0; x < width; ++x) {
+                int distance = abs(y - game.getPacman().getY()) + abs(x - game.getPacman().getX());
+                if (LevelData::countsTowardClear(row[x]) && distance < best && routes->isWalkable(y * width + x)) {
+                    best = distance;
+                    farFood = y * width + x;
+                }
+            }
+        }
+        if (farFood < 0) return 0;
+    }
+    int here = game.getPacman().getY() * width + game.getPacman().getX();
+    int next = routes->nextStep(here, farFood, false);
+    if (next == here || (avoidGhosts && danger[next] == stamp)) return 0;
+    for (int m = 0; m < 4; ++m) {
+        if (next == here + MOVES[m].dy * width + MOVES[m].dx) return MOVES[m].key;
+    }
+    return 0;
+}
+
+// No food is safely reachable: step to the open neighbour farthest from the closest ghost
+char PacmanBot::safestStep(const Game& game) const {
+    const Map& map = game.getMap();
+    const Pacman& pacman = game.getPacman();
+    char best = 0;
+    int bestDistance = -1;
+    for (int m = 0; m < 4; ++m) {
+        int y = pacman.getY() + MOVES[m].dy;
+        int x = pacman.getX() + MOVES[m].dx;
+        if (!passable(map, y, x) || isGhostCell(map.getCell(y, x))) continue;
+        int closest = 1 << 30;
+        for (size_t i = 0; i < game.getGhostCount(); ++i) {
+            const Ghost& ghost = game.getGhost(i);
+            if (!ghost.isAlive()) continue;
+            closest = min(closest, abs(ghost.getY() - y) + abs(ghost.getX() - x));
+        }
+        if (closest > bestDistance) {
+            bestDistance = closest;
+            best = MOVES[m].key;
+        }
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Tournament
+// ---------------------------------------------------------------------------
+
+TournamentConfig::TournamentConfig() : seeds(20), threads(0), maxTicks(5000) {
+}
+
+namespace {
+
+struct Match {
+    size_t strategy;
+    PacmanPolicy policy;
+    int level;
+    int seed;
+
+    bool done;
+    bool won;
+    int ticks;
+    int dots;
+    int maxDots;
+    int deaths;          // times a ghost caught Pacman
+    int ghostsEaten;
+    int score;
+};
+
+// Running mean with a normal-approximation 95% interval
+struct Mean {
+    uint64_t n;
+    double sum;
+    double sumSquares;
+
+    Mean() : n(0), sum(0), sumSquares(0) {}
+    void add(double x) {
+        ++n;
+        sum += x;
+        sumSquares += x * x;
+    }
+    double mean() const { return n ? sum / n : 0.0; }
+    double halfWidth() const {
+        if (n < 2) return 0.0;
+        double variance = (sumSquares - sum * sum / n) / (n - 1);
+        return 1.96 * sqrt(max(variance, 0.0) / n);
+    }
+};
+
+// Wilson score interval for a win rate, 95%
+void wilsonInterval(uint64_t wins, uint64_t n, double& low, double& high) {
+    if (n == 0) {
+        low = high = 0;
+        return;
+    }
+    const double z = 1.96;
+    double p = static_cast<double>(wins) / n;
+    double denominator = 1 + z * z / n;
+    double centre = (p + z * z / (2 * n)) / denominator;
+    double margin = z * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / denominator;
+    low = max(0.0, centre - margin);
+    high = min(1.0, centre + margin);
+}
+
+struct Pairing {
+    size_t strategy;
+    PacmanPolicy policy;
+    uint64_t wins;
+    Mean ticks;
+    Mean dots;
+    Mean deaths;
+    Mean ghostsEaten;
+
+    Pairing() : strategy(0), policy(PacmanPolicy::RANDOM), wins(0) {}
+};
+
+string matchKey(const string& strategy, const string& policy, int level, int seed) {
+    ostringstream key;
+    key << strategy << ',' << policy << ',' << level << ',' << seed;
+    return key.str();
+}
+
+string summaryPath(const string& csvPath) {
+    if (csvPath.size() > 4 && csvPath.compare(csvPath.size() - 4, 4, ".csv") == 0) {
+        return csvPath.substr(0, csvPath.size() - 4) + ".json";
+    }
+    return csvPath + ".json";
+}
+
+string jsonString(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Marks the matches already in the CSV as done. Drops a half-written last line
+// (the run was killed mid-write) so appending starts on a fresh line.
+bool loadFinished(const string& path, vector<Match>& matches,
+                  const unordered_map<string, size_t>& index, size_t& resumed, string& error) {
+    resumed = 0;
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) return true;
+    string contents((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    if (contents.empty()) return true;
+
+    size_t complete = contents.rfind('\n');
+    complete = (complete == string::npos) ? 0 : complete + 1;
+    if (complete < contents.size()) {
+        if (truncate(path.c_str(), static_cast<off_t>(complete)) != 0) {
+            error = "cannot drop the unfinished last line";
+            return false;
+        }
+        contents.resize(complete);
+    }
+
+    istringstream lines(contents);
+    string line;
+    if (!getline(lines, line) || line != CSV_HEADER) {
+        error = "not a tournament CSV (header mismatch)";
+        return false;
+    }
+    while (getline(lines, line)) {
+        vector<string> fields;
+        size_t begin = 0;
+        while (true) {
+            size_t comma = line.find(',', begin);
+            fields.push_back(line.substr(begin, comma - begin));
+            if (comma == string::npos) break;
+            begin = comma + 1;
+        }
+        if (fields.size() != CSV_FIELDS) continue;
+
+        unordered_map<string, size_t>::const_iterator found =
+            index.find(matchKey(fields[0], fields[1], atoi(fields[2].c_str()), atoi(fields[3].c_str())));
+        if (found == index.end()) continue;   // from a run with other settings; kept but not counted
+        Match& match = matches[found->second];
+        if (match.done) continue;
+        match.done = true;
+        match.won = fields[4] == "1";
+        match.ticks = atoi(fields[5].c_str());
+        match.dots = atoi(fields[6].c_str());
+        match.maxDots = atoi(fields[7].c_str());
+        match.deaths = atoi(fields[8].c_str());
+        match.ghostsEaten = atoi(fields[9].c_str());
+        match.score = atoi(fields[10].c_str());
+        ++resumed;
+    }
+    return true;
+}
+
+// One game, run the way runAllocationCheck drives the engine: a Pacman tick
+// every TICK_MS of game time and every ghost stepped each GHOST_STEP_MS
+void playMatch(Game& game, PacmanBot& bot, int maxTicks, Match& match) {
+    TRACE_SCOPE("tournament.match");
+    game.newGame(match.level, static_cast<uint64_t>(match.seed));
+    bot.reset(match.policy, static_cast<uint64_t>(match.seed));
+    EventBus::Cursor cursor = game.getEventBus().subscribe();
+    GameEvent batch[16];
+
+    int deaths = 0;
+    int ghostsEaten = 0;
+    int ticks = 0;
+    long elapsedMs = 0;
+    long nextGhostMs = 0;
+    while (!game.isOver() && ticks < maxTicks) {
+        char key = bot.decide(game);
+        if (key) game.applyInput(key);
+        game.tickPacman();
+        ++ticks;
+        elapsedMs += Game::TICK_MS;
+        while (nextGhostMs <= elapsedMs && !game.isOver()) {
+            for (size_t g = 0; g < game.getGhostCount(); ++g) game.stepGhost(g);
+            nextGhostMs += Game::GHOST_STEP_MS;
+        }
+
+        size_t n;
+        while ((n = game.getEventBus().drain(cursor, batch, 16)) > 0) {
+            for (size_t i = 0; i < n; ++i) {
+                if (batch[i].type == GameEventType::PACMAN_DIED) ++deaths;
+                if (batch[i].type == GameEventType::GHOST_EATEN) ++ghostsEaten;
+            }
+        }
+    }
+
+    match.won = game.getDotsEaten() >= game.getMaxDots();
+    match.ticks = ticks;
+    match.dots = game.getDotsEaten();
+    match.maxDots = game.getMaxDots();
+    match.deaths = deaths;
+    match.ghostsEaten = ghostsEaten;
+    match.score = game.getScore();
+    match.done = true;
+}
+
+void writeSummary(ostream& out, const TournamentConfig& config, const vector<Pairing>& pairings,
+                  size_t games, size_t played, size_t threads, double seconds, uint64_t ticks) {
+    out << fixed << setprecision(4);
+    out << "{\n";
+    out << "  \"games\": " << games << ",\n";
+    out << "  \"played_this_run\": " << played << ",\n";
+    out << "  \"threads\": " << threads << ",\n";
+    out << "  \"seconds\": " << seconds << ",\n";
+    out << "  \"games_per_second\": " << (seconds > 0 ? played / seconds : 0.0) << ",\n";
+    out << "  \"ticks_per_second\": " << (seconds > 0 ? ticks / seconds : 0.0) << ",\n";
+    out << "  \"max_ticks\": " << config.maxTicks << ",\n";
+    out << "  \"pairings\": [";
+    for (size_t i = 0; i < pairings.size(); ++i) {
+        const Pairing& p = pairings[i];
+        double low, high;
+        wilsonInterval(p.wins, p.ticks.n, low, high);
+        out << (i ? ",\n" : "\n");
+        out << "    {\"strategy\": " << jsonString(config.strategies[p.strategy])
+            << ", \"policy\": " << jsonString(policyName(p.policy))
+            << ", \"games\": " << p.ticks.n
+            << ", \"wins\": " << p.wins
+            << ", \"win_rate\": " << (p.ticks.n ? static_cast<double>(p.wins) / p.ticks.n : 0.0)
+            << ", \"win_rate_ci95\": [" << low << ", " << high << "]";
+        const Mean* means[] = {&p.ticks, &p.dots, &p.deaths, &p.ghostsEaten};
+        const char* names[] = {"survival_ticks", "dots_eaten", "captures", "ghosts_eaten"};
+        for (int m = 0; m < 4; ++m) {
+            out << ", \"" << names[m] << "\": {\"mean\": " << means[m]->mean()
+                << ", \"ci95\": " << means[m]->halfWidth() << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+string meanCell(const Mean& mean, int precision) {
+    ostringstream cell;
+    cell << fixed << setprecision(precision) << mean.mean() << "±" << mean.halfWidth();
+    return cell.str();
+}
+
+} // namespace
+
+int runTournament(const TournamentConfig& config) {
+    for (size_t i = 0; i < config.strategies.size(); ++i) {
+        const string& spec = config.strategies[i];
+        if (spec.find_first_of(",\"\n") != string::npos) {
+            cerr << "Error: strategy names can't contain commas or quotes: " << spec << endl;
+            return 1;
+        }
+        if (spec == "builtin") continue;
+        StrategyPlugin probe;
+        string error;
+        if (!probe.load(spec, error)) {
+            cerr << "Error: cannot load strategy " << spec << ": " << error << endl;
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < config.levels.size(); ++i) {
+        if (!LevelData::acquire(config.levels[i])) {
+            cerr << "Error: no level " << config.levels[i] << endl;
+            return 1;
+        }
+    }
+    if (config.strategies.empty() || config.policies.empty() || config.levels.empty() || config.seeds <= 0) {
+        cerr << "Error: empty tournament" << endl;
+        return 1;
+    }
+
+    // Every strategy/policy pairing plays the same (level, seed) games
+    vector<Match> matches;
+    unordered_map<string, size_t> index;
+    for (size_t s = 0; s < config.strategies.size(); ++s) {
+        for (PacmanPolicy policy : config.policies) {
+            for (int level : config.levels) {
+                for (int seed = 1; seed <= config.seeds; ++seed) {
+                    Match match = Match();
+                    match.strategy = s;
+                    match.policy = policy;
+                    match.level = level;
+                    match.seed = seed;
+                    index[matchKey(config.strategies[s], policyName(policy), level, seed)] = matches.size();
+                    matches.push_back(match);
+                }
+            }
+        }
+    }
+
+    size_t resumed = 0;
+    string error;
+    if (!loadFinished(config.outPath, matches, index, resumed, error)) {
+        cerr << "Error: " << config.outPath << ": " << error << endl;
+        return 1;
+    }
+    FILE* csv = fopen(config.outPath.c_str(), "a");
+    if (!csv) {
+        cerr << "Error: cannot write " << config.outPath << endl;
+        return 1;
+    }
+    if (ftell(csv) == 0) {
+        fprintf(csv, "%s\n", CSV_HEADER);
+        fflush(csv);
+    }
+
+    vector<size_t> pending;
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (!matches[i].done) pending.push_back(i);
+    }
+    size_t threadCount = config.threads > 0 ? config.threads : max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, pending.size()));
+
+    cout << "Tournament: " << config.strategies.size() << " ghost strategies x " << config.policies.size()
+         << " Pacman policies x " << config.levels.size() << " levels x " << config.seeds << " seeds = "
+         << matches.size() << " games";
+    if (resumed > 0) cout << " (" << resumed << " already in " << config.outPath << ")";
+    cout << ", " << threadCount << " threads" << endl;
+
+    // Workers pull match indices from a shared counter; each keeps one Game per
+    // strategy so a plugin is loaded once per thread, not once per game
+    atomic<size_t> nextPending(0);
+    atomic<uint64_t> ticksPlayed(0);
+    size_t finished = 0;
+    mutex csvMutex;
+    condition_variable progress;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount && !pending.empty(); ++t) {
+        workers.push_back(thread([&]() {
+            TRACE_THREAD_NAME("tournament");
+            vector<unique_ptr<Game> > games(config.strategies.size());
+            PacmanBot bot;
+            size_t i;
+            while ((i = nextPending.fetch_add(1)) < pending.size()) {
+                Match& match = matches[pending[i]];
+                unique_ptr<Game>& game = games[match.strategy];
+                if (!game) {
+                    game.reset(new Game());
+                    game->setHeadless(true);
+                    game->setReplayDirectory("");
+                    string loadError;
+                    const string& spec = config.strategies[match.strategy];
+                    if (spec != "builtin") game->loadStrategy(spec, loadError);
+                }
+                playMatch(*game, bot, config.maxTicks, match);
+                ticksPlayed += static_cast<uint64_t>(match.ticks);
+
+                lock_guard<mutex> lock(csvMutex);
+                fprintf(csv, "%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", config.strategies[match.strategy].c_str(),
+                        policyName(match.policy), match.level, match.seed, match.won ? 1 : 0, match.ticks,
+                        match.dots, match.maxDots, match.deaths, match.ghostsEaten, match.score);
+                fflush(csv);   // a finished game survives the run being killed
+                ++finished;
+                progress.notify_one();
+            }
+        }));
+    }
+
+    bool interactive = isatty(STDERR_FILENO);
+    {
+        unique_lock<mutex> lock(csvMutex);
+        while (finished < pending.size()) {
+            progress.wait_for(lock, chrono::seconds(1));
+            if (interactive) {
+                cerr << "\r  " << finished << "/" << pending.size() << " games" << flush;
+            }
+        }
+    }
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    if (interactive && !pending.empty()) cerr << endl;
+    fclose(csv);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    vector<Pairing> pairings;
+    for (size_t s = 0; s < config.strategies.size(); ++s) {
+        for (PacmanPolicy policy : config.policies) {
+            Pairing pairing;
+            pairing.strategy = s;
+            pairing.policy = policy;
+            pairings.push_back(pairing);
+        }
+    }
+    for (size_t i = 0; i < matches.size(); ++i) {
+        const Match& match = matches[i];
+        size_t p = match.strategy * config.policies.size() +
+                   (find(config.policies.begin(), config.policies.end(), match.policy) - config.policies.begin());
+        Pairing& pairing = pairings[p];
+        if (match.won) ++pairing.wins;
+        pairing.ticks.add(match.ticks);
+        pairing.dots.add(match.dots);
+        pairing.deaths.add(match.deaths);
+        pairing.ghostsEaten.add(match.ghostsEaten);
+    }
+
+    uint64_t ticks = ticksPlayed.load();
+    cout << "  Played " << pending.size() << " games (" << ticks << " ticks) in " << fixed << setprecision(2)
+         << seconds << " s: " << setprecision(1) << (seconds > 0 ? pending.size() / seconds : 0.0)
+         << " games/s, " << setprecision(0) << (seconds > 0 ? ticks / seconds : 0.0) << " ticks/s ("
+         << (seconds > 0 ? ticks / seconds / threadCount : 0.0) << " per thread)" << endl;
+    cout << left << setw(28) << "strategy" << setw(9) << "policy" << right << setw(7) << "games"
+         << setw(22) << "win % [95% CI]" << setw(18) << "survival ticks" << setw(16) << "dots"
+         << setw(14) << "captures" << setw(14) << "ghosts eaten" << endl;
+    for (size_t i = 0; i < pairings.size(); ++i) {
+        const Pairing& p = pairings[i];
+        double low, high;
+        wilsonInterval(p.wins, p.ticks.n, low, high);
+        ostringstream winRate;
+        winRate << fixed << setprecision(1) << 100.0 * p.wins / max<uint64_t>(p.ticks.n, 1) << " [" << 100 * low
+                << ", " << 100 * high << "]";
+        cout << left << setw(28) << config.strategies[p.strategy] << setw(9) << policyName(p.policy) << right
+             << setw(7) << p.ticks.n << setw(22) << winRate.str() << setw(19) << meanCell(p.ticks, 0)
+             << setw(17) << meanCell(p.dots, 1) << setw(15) << meanCell(p.deaths, 2)
+             << setw(15) << meanCell(p.ghostsEaten, 2) << endl;
+    }
+
+    string jsonPath = summaryPath(config.outPath);
+    ofstream json(jsonPath.c_str());
+    if (!json) {
+        cerr << "Error: cannot write " << jsonPath << endl;
+        return 1;
+    }
+    writeSummary(json, config, pairings, matches.size(), pending.size(), threadCount, seconds, ticks);
+    cout << "  Results: " << config.outPath << ", summary: " << jsonPath << endl;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "trace.hpp"
+
+#ifdef PACMAN_TRACE
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    long arg;
+    uint64_t start;
+    uint64_t duration;
+};
+
+struct ThreadBuffer {
+    static const size_t CAPACITY = 1 << 16;
+
+    TraceEvent events[CAPACITY];
+    atomic<uint64_t> written;    // total events ever written; ring index = written % CAPACITY
+    int tid;
+    const char* threadName;
+
+    ThreadBuffer(int id) : written(0), tid(id), threadName(nullptr) {}
+};
+
+mutex registryMutex;
+// Never destroyed: threads still tracing while the process winds down may
+// touch it after static destructors have run
+vector<unique_ptr<ThreadBuffer> >& registry() {
+    static vector<unique_ptr<ThreadBuffer> >* buffers = new vector<unique_ptr<ThreadBuffer> >();
+    return *buffers;
+}
+
+volatile sig_atomic_t exportRequested = 0;
+
+uint64_t nowNs() {
+    static const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count());
+}
+
+ThreadBuffer& localBuffer() {
+    // Buffers live until process exit so export can still read finished threads
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        lock_guard<mutex> lock(registryMutex);
+        registry().push_back(unique_ptr<ThreadBuffer>(new ThreadBuffer(static_cast<int>(registry().size()) + 1)));
+        buffer = registry().back().get();
+    }
+    return *buffer;
+}
+
+void writeEscaped(FILE* out, const char* s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+}
+
+} // namespace
+
+TraceScope::TraceScope(const char* n, long a) : name(n), arg(a), start(nowNs()), open(true) {
+}
+
+void TraceScope::end() {
+    if (!open) return;
+    open = false;
+    uint64_t finish = nowNs();
+
+    ThreadBuffer& buffer = localBuffer();
+    uint64_t index = buffer.written.load(memory_order_relaxed);
+    TraceEvent& e = buffer.events[index % ThreadBuffer::CAPACITY];
+    e.name = name;
+    e.arg = arg;
+    e.start = start;
+    e.duration = finish - start;
+    buffer.written.store(index + 1, memory_order_release);
+}
+
+void traceSetThreadName(const char* name) {
+    localBuffer().threadName = name;
+}
+
+bool traceExport(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    lock_guard<mutex> lock(registryMutex);
+    for (const auto& buffer : registry()) {
+        if (buffer->threadName) {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                    first ? "" : ",\n", buffer->tid);
+            writeEscaped(out, buffer->threadName);
+            fprintf(out, "\"}}");
+            first = false;
+        }
+
+        uint64_t written = buffer->written.load(memory_order_acquire);
+        uint64_t begin = written > ThreadBuffer::CAPACITY ? written - ThreadBuffer::CAPACITY : 0;
+        for (uint64_t i = begin; i < written; ++i) {
+            const TraceEvent& e = buffer->events[i % ThreadBuffer::CAPACITY];
+            fprintf(out, "%s{\"name\":\"", first ? "" : ",\n");
+            writeEscaped(out, e.name);
+            fprintf(out, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->tid,
+                    e.start / 1000.0, e.duration / 1000.0);
+            if (e.arg >= 0) {
+                fprintf(out, ",\"args\":{\"index\":%ld}", e.arg);
+            }
+            fprintf(out, "}");
+            first = false;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    return true;
+}
+
+void traceRequestExport() {
+    exportRequested = 1;
+}
+
+void traceServiceRequests(const char* path) {
+    if (exportRequested) {
+        exportRequested = 0;
+        traceExport(path);
+    }
+}
+
+#endif
@@ -0,0 +1,78 @@
+// pacman-logdump: decode binary game logs written with --log.
+//
+//   pacman-logdump [--json] FILE...
+//
+// Pass rotated files oldest first (pacman.log.2 pacman.log.1 pacman.log).
+#include "event_bus.hpp"
+#include "game_log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void printRecord(const LogRecord& r, bool json) {
+    const char* name = r.type < static_cast<uint8_t>(GameEventType::COUNT)
+                           ? eventTypeName(static_cast<GameEventType>(r.type)) : "Unknown";
+    char entity[8];
+    if (r.entity >= 32 && r.entity < 127) {
+        snprintf(entity, sizeof(entity), "%c", r.entity);
+    } else {
+        entity[0] = '\0';
+    }
+
+    if (json) {
+        printf("{\"tick\":%u,\"event\":\"%s\",\"entity\":\"%s\",\"y\":%u,\"x\":%u,"
+               "\"score\":%d,\"lives\":%u,\"level\":%u}\n",
+               r.tick, name, entity, r.y, r.x, r.score, r.lives, r.level);
+    } else {
+        printf("tick %6u  %-12s %-2s (%2u,%2u)  score %5d  lives %u  level %u\n",
+               r.tick, name, entity, r.y, r.x, r.score, r.lives, r.level);
+    }
+}
+
+static bool dumpFile(const char* path, bool json) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        cerr << "Error: cannot open " << path << endl;
+        return false;
+    }
+    if (!GameLog::readHeader(in)) {
+        cerr << "Error: " << path << " is not a game log" << endl;
+        fclose(in);
+        return false;
+    }
+    uint8_t buffer[LogRecord::SIZE * 256];
+    size_t n;
+    while ((n = fread(buffer, LogRecord::SIZE, 256, in)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            printRecord(LogRecord::decode(buffer + i * LogRecord::SIZE), json);
+        }
+    }
+    fclose(in);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    int files = 0;
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            files = 0;
+            break;
+        } else {
+            ok = dumpFile(argv[i], json) && ok;
+            ++files;
+        }
+    }
+    if (files == 0) {
+        cout << "Usage: " << argv[0] << " [--json] FILE..." << endl;
+        cout << "Decode game logs written with 'Pacman --log FILE'. Give rotated files oldest first." << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}